@@ -30,6 +30,8 @@
 #include "app_entry.h"
 #include "uart.h"
 #include "flash.h"
+#include "fd.h"
+#include "kv.h"
 #include "usb_cdc.h"
 #include "bsp.h"
 #include "sd_spi.h"
@@ -38,6 +40,7 @@
 #include "app_fatfs.h"
 #include "fs.h"
 #include "vi.h"
+#include "fpu.h"
 
 /* USER CODE END Includes */
 
@@ -85,11 +88,14 @@ void MX_FREERTOS_Init(void); /* (MISRA C 2004 rule 8.1) */
   */
 void MX_FREERTOS_Init(void) {
   /* USER CODE BEGIN Init */
+	FPU_init();
 	BSP_init();
 	APPE_Init();
 	UART_init();
 	CDC_init();
 	FLASH_init();
+	FD_init();
+	KV_init();
 	SDSPI_init();
 	SD_init();
 	BLOCK_init();
@@ -16,7 +16,7 @@
  *      128 KiB Flash Dictionary
  *
  *      FLASH_DRIVE (rx)           : ORIGIN = 0x08060000, LENGTH = 384K
- *      384 KiB future use for built in flash drive
+ *      384 KiB built in flash drive (FAT volume 1:, see fd.c)
 
  *      FLASH_BLESTACK (rx)        : ORIGIN = 0x080C0000, LENGTH = 256K
 
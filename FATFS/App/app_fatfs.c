@@ -54,6 +54,7 @@ FATFS USERFatFs;    /* File system object for USER logical drive */
 FIL USERFile;       /* File  object for USER */
 char USERPath[4];   /* USER logical drive path */
 /* USER CODE BEGIN PV */
+char FLASHDRIVEPath[4];   /* internal flash logical drive path */
 FS_FileOperationsTypeDef Appli_state = APPLICATION_IDLE;
 
 // Hardware resources
@@ -67,7 +68,10 @@ extern RTC_HandleTypeDef hrtc;
 /* Volume - Partition resolution table should be user defined in case of Multiple partition */
 /* When multi-partition feature is enabled (1), each logical drive number is bound to arbitrary physical drive and partition
 listed in the VolToPart[] */
-PARTITION VolToPart[];
+PARTITION VolToPart[] = {
+		{0, 0},		/* "0:" SD card, auto detect partition */
+		{1, 0}		/* "1:" internal flash drive */
+};
 /* USER CODE END VolToPart */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -88,6 +92,10 @@ int32_t MX_FATFS_Init(void)
   {
     return APP_ERROR;
   }
+  else if (FATFS_LinkDriver(&FLASHDRIVE_Driver, FLASHDRIVEPath) != 0)
+  {
+    return APP_ERROR;
+  }
   else
   {
     Appli_state = APPLICATION_INIT;
@@ -29,7 +29,7 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "flash_diskio.h" /* defines FLASHDRIVE_Driver as external */
 /* USER CODE END Includes */
 
 /* Exported types ------------------------------------------------------------*/
@@ -51,7 +51,7 @@
 int32_t MX_FATFS_Init(void);
 int32_t MX_FATFS_Process(void);
 /* USER CODE BEGIN EFP */
-
+extern char FLASHDRIVEPath[4];   /* internal flash logical drive path */
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
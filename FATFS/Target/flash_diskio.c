@@ -0,0 +1,187 @@
+/* USER CODE BEGIN Header */
+/**
+ ******************************************************************************
+  * @file    flash_diskio.c
+  * @brief   This file includes a diskio driver skeleton to be completed by the user.
+  *          Internal flash drive (FLASH_DRIVE region), see Forth/Src/fd.c
+  ******************************************************************************
+  */
+ /* USER CODE END Header */
+
+/* USER CODE BEGIN DECL */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "ff_gen_drv.h"
+
+#include "fd.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+
+/* Private variables ---------------------------------------------------------*/
+/* Disk status */
+static volatile DSTATUS Stat = STA_NOINIT;
+
+/* USER CODE END DECL */
+
+/* Private function prototypes -----------------------------------------------*/
+DSTATUS FLASHDRIVE_initialize (BYTE pdrv);
+DSTATUS FLASHDRIVE_status (BYTE pdrv);
+DRESULT FLASHDRIVE_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count);
+#if _USE_WRITE == 1
+  DRESULT FLASHDRIVE_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT count);
+#endif /* _USE_WRITE == 1 */
+#if _USE_IOCTL == 1
+  DRESULT FLASHDRIVE_ioctl (BYTE pdrv, BYTE cmd, void *buff);
+#endif /* _USE_IOCTL == 1 */
+
+Diskio_drvTypeDef  FLASHDRIVE_Driver =
+{
+  FLASHDRIVE_initialize,
+  FLASHDRIVE_status,
+  FLASHDRIVE_read,
+#if  _USE_WRITE
+  FLASHDRIVE_write,
+#endif  /* _USE_WRITE == 1 */
+#if  _USE_IOCTL == 1
+  FLASHDRIVE_ioctl,
+#endif /* _USE_IOCTL == 1 */
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  Initializes a Drive
+  * @param  pdrv: Physical drive number (0..)
+  * @retval DSTATUS: Operation status
+  */
+DSTATUS FLASHDRIVE_initialize (
+	BYTE pdrv           /* Physical drive nmuber to identify the drive */
+)
+{
+  /* USER CODE BEGIN INIT */
+	Stat = STA_NOINIT;
+	if (FD_mount() == FD_OK) {
+		Stat = 0;
+	}
+	return Stat;
+  /* USER CODE END INIT */
+}
+
+/**
+  * @brief  Gets Disk Status
+  * @param  pdrv: Physical drive number (0..)
+  * @retval DSTATUS: Operation status
+  */
+DSTATUS FLASHDRIVE_status (
+	BYTE pdrv       /* Physical drive number to identify the drive */
+)
+{
+  /* USER CODE BEGIN STATUS */
+	return Stat;
+  /* USER CODE END STATUS */
+}
+
+/**
+  * @brief  Reads Sector(s)
+  * @param  pdrv: Physical drive number (0..)
+  * @param  *buff: Data buffer to store read data
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to read (1..128)
+  * @retval DRESULT: Operation result
+  */
+DRESULT FLASHDRIVE_read (
+	BYTE pdrv,      /* Physical drive nmuber to identify the drive */
+	BYTE *buff,     /* Data buffer to store read data */
+	DWORD sector,   /* Sector address in LBA */
+	UINT count      /* Number of sectors to read */
+)
+{
+  /* USER CODE BEGIN READ */
+	DRESULT res = RES_ERROR;
+	if (FD_ReadBlocks((uint8_t*)buff, (uint32_t) (sector), count) == FD_OK) {
+		res = RES_OK;
+	}
+	return res;
+  /* USER CODE END READ */
+}
+
+/**
+  * @brief  Writes Sector(s)
+  * @param  pdrv: Physical drive number (0..)
+  * @param  *buff: Data to be written
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to write (1..128)
+  * @retval DRESULT: Operation result
+  */
+#if _USE_WRITE == 1
+DRESULT FLASHDRIVE_write (
+	BYTE pdrv,          /* Physical drive nmuber to identify the drive */
+	const BYTE *buff,   /* Data to be written */
+	DWORD sector,       /* Sector address in LBA */
+	UINT count          /* Number of sectors to write */
+)
+{
+  /* USER CODE BEGIN WRITE */
+	DRESULT res = RES_ERROR;
+	if (FD_WriteBlocks((const uint8_t*)buff, (uint32_t) (sector), count) == FD_OK) {
+		res = RES_OK;
+	}
+	return res;
+  /* USER CODE END WRITE */
+}
+#endif /* _USE_WRITE == 1 */
+
+/**
+  * @brief  I/O control operation
+  * @param  pdrv: Physical drive number (0..)
+  * @param  cmd: Control code
+  * @param  *buff: Buffer to send/receive control data
+  * @retval DRESULT: Operation result
+  */
+#if _USE_IOCTL == 1
+DRESULT FLASHDRIVE_ioctl (
+	BYTE pdrv,      /* Physical drive nmuber (0..) */
+	BYTE cmd,       /* Control code */
+	void *buff      /* Buffer to send/receive control data */
+)
+{
+  /* USER CODE BEGIN IOCTL */
+	DRESULT res = RES_ERROR;
+
+	if (Stat & STA_NOINIT) return RES_NOTRDY;
+
+	switch (cmd) {
+	/* Make sure that no pending write process */
+	case CTRL_SYNC :
+		res = RES_OK;
+		break;
+
+		/* Get number of sectors on the disk (DWORD) */
+	case GET_SECTOR_COUNT :
+		*(DWORD*)buff = FD_getSectors();
+		res = RES_OK;
+		break;
+
+		/* Get R/W sector size (WORD) */
+	case GET_SECTOR_SIZE :
+		*(WORD*)buff = FD_SECTOR_SIZE;
+		res = RES_OK;
+		break;
+
+		/* Get erase block size in unit of sector (DWORD) */
+	case GET_BLOCK_SIZE :
+		// sectors are remapped, no erase block alignment
+		*(DWORD*)buff = 1;
+		res = RES_OK;
+		break;
+
+	default:
+		res = RES_PARERR;
+	}
+
+	return res;
+  /* USER CODE END IOCTL */
+}
+#endif /* _USE_IOCTL == 1 */
@@ -0,0 +1,33 @@
+/* USER CODE BEGIN Header */
+/**
+ ******************************************************************************
+  * @file    flash_diskio.h
+  * @brief   This file contains the common defines and functions prototypes for
+  *          the flash_diskio driver (internal flash drive).
+  ******************************************************************************
+  */
+ /* USER CODE END Header */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FLASH_DISKIO_H
+#define __FLASH_DISKIO_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* USER CODE BEGIN 0 */
+
+/* Includes ------------------------------------------------------------------*/
+/* Exported types ------------------------------------------------------------*/
+/* Exported constants --------------------------------------------------------*/
+/* Exported functions ------------------------------------------------------- */
+extern Diskio_drvTypeDef  FLASHDRIVE_Driver;
+
+/* USER CODE END 0 */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FLASH_DISKIO_H */
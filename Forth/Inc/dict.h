@@ -0,0 +1,56 @@
+/**
+ *  @brief
+ *      Hash index for the Forth dictionary (find).
+ *  @file
+ *      dict.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef INC_DICT_H_
+#define INC_DICT_H_
+
+#define DICT_RAM_START		0x20000000	// Backlinkgrenze, see mecrisp.s
+
+// slots, power of 2. The index is full at 3/4.
+#define DICT_FLASH_SLOTS	2048
+#define DICT_RAM_SLOTS		512
+
+#define DICT_UNKNOWN		((const uint8_t *) -1)	// index full, search the dictionary
+
+// dictionary tail journal, the page after FlashDictionaryEnde (mecrisp.s)
+extern uint8_t FlashDictionaryEnde[];
+#define DICT_TAIL_ADDRESS	((uint32_t) FlashDictionaryEnde)
+#define DICT_TAIL_SIZE		4096			// DictTailEnde - FlashDictionaryEnde
+#define DICT_TAIL_SLOTS		(DICT_TAIL_SIZE / 16)
+#define DICT_TAIL_MAGIC		0x4C494154		// "TAIL"
+#define DICT_TAIL_CHECK		16				// at least erased after the dictionary pointer
+#define DICT_TAIL_PAGE		4096			// checked up to the page end
+
+void DICT_init(void);
+void DICT_insert(const uint8_t *header);
+void DICT_forgetRam(void);
+const uint8_t *DICT_find(const char *name, int length, int ram);
+void DICT_saveTail(uint32_t dp, uint32_t latest);
+uint32_t DICT_loadTail(uint32_t latest);
+
+#endif /* INC_DICT_H_ */
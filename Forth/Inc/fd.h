@@ -0,0 +1,39 @@
+/*
+ * fd.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: psi
+ */
+
+#ifndef INC_FD_H_
+#define INC_FD_H_
+
+// FLASH_DRIVE region see STM32WB55RGVX_FLASH.ld
+#define FD_START_ADDRESS	0x08060000
+#define FD_END_ADDRESS		0x080BE000	// last 2 pages for the key-value store (kv.h)
+
+#define FD_PAGE_SIZE		4096
+#define FD_SECTOR_SIZE		512
+
+#define FD_PAGES			((FD_END_ADDRESS - FD_START_ADDRESS) / FD_PAGE_SIZE)
+
+// 7 data sectors per page, the last 512 bytes are used for the page header
+// and the sector tags
+#define FD_SLOTS			((FD_PAGE_SIZE / FD_SECTOR_SIZE) - 1)
+
+// pages not visible to the file system, needed for the garbage collection
+#define FD_SPARE_PAGES		4
+#define FD_SECTORS			((FD_PAGES - FD_SPARE_PAGES) * FD_SLOTS)
+
+enum {
+	FD_OK = 0x00,
+	FD_ERROR = 0x01
+};
+
+void    FD_init(void);
+int     FD_mount(void);
+int     FD_getSectors(void);
+uint8_t FD_ReadBlocks(uint8_t *pData, uint32_t ReadAddr, uint32_t NumOfBlocks);
+uint8_t FD_WriteBlocks(const uint8_t *pData, uint32_t WriteAddr, uint32_t NumOfBlocks);
+
+#endif /* INC_FD_H_ */
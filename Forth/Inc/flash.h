@@ -8,7 +8,19 @@
 #ifndef INC_FLASH_H_
 #define INC_FLASH_H_
 
+#define FLASH_ROW_SIZE		512		// fast programming row, 64 doublewords
+#define FLASH_ROW_SLOTS		4
+
 void FLASH_init(void);
+int FLASH_programDouble(uint32_t Address, uint32_t word1, uint32_t word2);
+int FLASH_erasePage(uint32_t Address);
+int FLASH_programBuffer(uint32_t Address, const void *data, int length);
+int FLASH_eraseRange(uint32_t start, uint32_t end);
+int FLASH_programRow(uint32_t Address, const uint64_t *data);
+int FLASH_rowStore(uint32_t Address, uint16_t value);
+int FLASH_rowRewind(uint32_t Start, uint32_t End);
+void FLASH_rowFlush(void);
+void FLASH_rowInit(void);
 
 
 #endif /* INC_FLASH_H_ */
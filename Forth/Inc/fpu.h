@@ -0,0 +1,39 @@
+/**
+ *  @brief
+ *      Floating point unit, single precision (IEEE 754 binary32).
+ *  @file
+ *      fpu.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef INC_FPU_H_
+#define INC_FPU_H_
+
+#define FPU_DIGITS			7		// significant digits for f.
+#define FPU_STRING_SIZE		32		// longest literal and f. output
+
+void FPU_init(void);
+int FPU_str2f(const char *str, int length, float *f);
+int FPU_f2str(float f, char *buffer);
+
+#endif /* INC_FPU_H_ */
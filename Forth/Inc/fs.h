@@ -10,6 +10,9 @@
 
 #include "ff.h"
 
+#define FS_SD_DRIVE		"0:"		// SD card
+#define FS_FLASH_DRIVE	"1:"		// internal flash drive
+
 extern const char FS_Version[];
 extern	uint32_t **ZweitDictionaryPointer;
 
@@ -32,6 +35,12 @@ int FS_FILINFO_altname(void);
 int FS_f_eof(FIL* fp);
 FSIZE_t FS_f_size(FIL* fp);
 int FS_f_error(FIL* fp);
+FRESULT FS_f_lseek(FIL* fp, DWORD ofs);
+FRESULT FS_f_expand(FIL* fp, DWORD fsz, BYTE opt);
+
+FRESULT FS_sinkOpen(uint8_t *str, int count);
+void    FS_sinkEmit(char c);
+FRESULT FS_sinkClose(void);
 
 uint64_t FS_include  (uint64_t forth_stack, uint8_t *str, int count);
 uint64_t FS_cat      (uint64_t forth_stack);
@@ -48,6 +57,11 @@ uint64_t FS_chmod    (uint64_t forth_stack);
 uint64_t FS_touch    (uint64_t forth_stack);
 uint64_t FS_mount    (uint64_t forth_stack);
 uint64_t FS_umount   (uint64_t forth_stack);
+uint64_t FS_df       (uint64_t forth_stack);
+uint64_t FS_mkfs     (uint64_t forth_stack);
+uint64_t FS_date     (uint64_t forth_stack);
+uint64_t FS_rz       (uint64_t forth_stack);
+uint64_t FS_sz       (uint64_t forth_stack);
 
 uint64_t FS_evaluate (uint64_t forth_stack, uint8_t *str, int count);
 uint64_t FS_catch_evaluate (uint64_t forth_stack, uint8_t *str, int count);
@@ -0,0 +1,33 @@
+/*
+ * kv.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: psi
+ */
+
+#ifndef INC_KV_H_
+#define INC_KV_H_
+
+// 2 flash pages at the end of the FLASH_DRIVE region, see fd.h
+#define KV_START_ADDRESS	0x080BE000
+#define KV_PAGE_SIZE		4096
+#define KV_PAGES			2
+
+#define KV_MAX_KEY			64
+#define KV_MAX_VALUE		256
+#define KV_INDEX_SIZE		128		// max. 127 keys, power of 2
+
+enum {
+	KV_OK = 0x00,
+	KV_ERROR = 0x01,
+	KV_NOT_FOUND = 0x02
+};
+
+void KV_init(void);
+int  KV_put(const char *key, int key_len, const void *value, int value_len);
+int  KV_get(const char *key, int key_len, void *value, int max_len);
+int  KV_delete(const char *key, int key_len);
+int  KV_putCell(const char *key, int key_len, int value);
+int  KV_getCell(const char *key, int key_len, int *value);
+
+#endif /* INC_KV_H_ */
@@ -0,0 +1,41 @@
+/**
+ *  @brief
+ *      Console tee, the terminal output goes to several terminals.
+ *  @file
+ *      tee.h
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+#ifndef INC_TEE_H_
+#define INC_TEE_H_
+
+#define TEE_UART	0x01
+#define TEE_CDC		0x02
+#define TEE_CRS		0x04
+
+void TEE_set(int sinks, int drop);
+int TEE_write(const char *buffer, int length);
+int TEE_putc(int c);
+int TEE_TxReady(void);
+
+#endif /* INC_TEE_H_ */
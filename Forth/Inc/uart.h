@@ -43,11 +43,17 @@ int UART_gets(char *str, int length);
 int UART_RxReady(void);
 int UART_putc(int c);
 int UART_puts(const char *s);
+int UART_write(const char *buffer, int length);
 int UART_TxReady(void);
+int UART_TxFree(void);
 int UART_putkey(const char c);
 void UART_setBaudrate(const int baudrate);
 void UART_setWordLength(const int wordlength);
 void UART_setParityBit(const int paritybit);
 void UART_setStopBits(const int stopbits);
+void UART_setHwFlowCtl(const int flowctl);
+void UART_setXonXoff(const int xonxoff);
+void UART_RxIdleCallback(void);
+void UART_RxMatchCallback(void);
 
 #endif /* INC_UART_H_ */
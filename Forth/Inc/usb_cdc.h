@@ -10,15 +10,18 @@
 
 #define CDC_CONNECTED	0x01
 #define CDC_TX_READY	0x02
+#define CDC_DTR			0x04	// terminal program opened the port
 
-extern osMessageQueueId_t CDC_RxQueueId;
 extern osEventFlagsId_t CDC_EvtFlagsID;
 
 void CDC_init(void);
 int CDC_getc(void);
 int CDC_RxReady(void);
 int CDC_putc(int c);
+int CDC_write(const char *buffer, int length);
 int CDC_TxReady(void);
+int CDC_TxFree(void);
 int CDC_putkey(const char c);
+int CDC_receive(const uint8_t *buffer, uint32_t length);
 
 #endif /* INC_USB_CDC_H_ */
@@ -0,0 +1,435 @@
+/**
+ *  @brief
+ *      Hash index for the Forth dictionary (find).
+ *
+ *      The linear find walks the whole flash dictionary for every token,
+ *      because the flash definitions are linked from old to new and a newer
+ *      definition with the same name could follow. The index maps the name
+ *      (case insensitive) to the newest visible header, one open addressing
+ *      table for the flash and one for the RAM dictionary.
+ *
+ *      The flash table is built at startup (hashfind_init in
+ *      compiler-flash.s), smudge and setflags add the headers when they
+ *      become visible, forgetram clears the RAM table. A full table is not
+ *      used any more, find falls back to the linear search (see hash_find).
+ *      Flash definitions are only erased by eraseflash followed by a reset.
+ *
+ *      Header: link (4 bytes), flags (2 bytes), counted name, code.
+ *
+ *      Dictionary tail: smudge appends the flash dictionary pointer and the
+ *      latest flash header to a journal page after the flash dictionary.
+ *      At startup catchflashpointers takes the dictionary pointer from the
+ *      last record instead of scanning the free flash backwards. A record
+ *      is only used if the CRC is valid, the latest header matches the
+ *      dictionary walk and the flash after the pointer is erased.
+ *      The journal page was the last page of the flash dictionary before.
+ *      If it holds anything else than tail records (dictionary code of an
+ *      older installation), the journal is not used and never erased.
+ *      eraseflash frees the page.
+ *  @file
+ *      dict.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include <stdint.h>
+#include <string.h>
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "dict.h"
+#include "flash.h"
+
+
+// Private typedefs
+// ****************
+typedef struct {
+	const uint8_t **slot;
+	uint32_t mask;		// slots - 1
+	int count;
+	int full;
+} dict_table_t;
+
+typedef struct {
+	uint32_t magic;
+	uint32_t dp;		// dictionary pointer
+	uint32_t latest;	// latest header (Fadenende)
+	uint32_t crc;		// CRC-32 of magic, dp and latest
+} dict_tail_t;
+
+
+// Private function prototypes
+// ***************************
+static uint32_t dict_hash(const uint8_t *name, int length);
+static int dict_equal(const uint8_t *header, const uint8_t *name, int length);
+static const uint8_t *dict_lookup(const dict_table_t *table, const uint8_t *name, int length);
+static void dict_clear(dict_table_t *table);
+static int dict_tailFree(void);
+static int dict_tailValid(void);
+static uint32_t dict_crc32(const uint8_t *data, int length);
+
+// Private Variables
+// *****************
+static const uint8_t *dict_flashSlots[DICT_FLASH_SLOTS];
+static const uint8_t *dict_ramSlots[DICT_RAM_SLOTS];
+
+static dict_table_t dict_flash = { dict_flashSlots, DICT_FLASH_SLOTS - 1, 0, FALSE };
+static dict_table_t dict_ram   = { dict_ramSlots,   DICT_RAM_SLOTS - 1,   0, FALSE };
+
+static int dict_tailState = -1;		// journal page checked, -1 not yet
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Clears the index.
+ *  @return
+ *      None
+ */
+void DICT_init(void) {
+	dict_clear(&dict_flash);
+	dict_clear(&dict_ram);
+}
+
+
+/**
+ *  @brief
+ *      Adds a visible header to the index. A newer header (higher address)
+ *      replaces an older one with the same name.
+ *  @param[in]
+ *      header  dictionary header
+ *  @return
+ *      None
+ */
+void DICT_insert(const uint8_t *header) {
+	dict_table_t *table;
+	const uint8_t *name = header + 6;
+	uint32_t i;
+
+	if ((uint32_t)header >= DICT_RAM_START) {
+		table = &dict_ram;
+	} else {
+		table = &dict_flash;
+	}
+	if (table->full) {
+		return;
+	}
+
+	i = dict_hash(name + 1, name[0]) & table->mask;
+	while (table->slot[i] != NULL) {
+		if (dict_equal(table->slot[i], name + 1, name[0])) {
+			if (header > table->slot[i]) {
+				table->slot[i] = header;
+			}
+			return;
+		}
+		i = (i + 1) & table->mask;
+	}
+
+	if (table->count >= (int)(table->mask + 1) / 4 * 3) {
+		// not enough free slots for short probe sequences
+		table->full = TRUE;
+		return;
+	}
+	table->slot[i] = header;
+	table->count++;
+}
+
+
+/**
+ *  @brief
+ *      The RAM dictionary is empty (forgetram).
+ *  @return
+ *      None
+ */
+void DICT_forgetRam(void) {
+	dict_clear(&dict_ram);
+}
+
+
+/**
+ *  @brief
+ *      Searches the newest visible header for the name.
+ *  @param[in]
+ *      name    name of the definition
+ *  @param[in]
+ *      length  name length
+ *  @param[in]
+ *      ram     compiling into RAM, the RAM definitions are searched first.
+ *              Compiling into flash only flash definitions are visible.
+ *  @return
+ *      Header, NULL if not found or DICT_UNKNOWN if the index is full.
+ */
+const uint8_t *DICT_find(const char *name, int length, int ram) {
+	const uint8_t *header;
+
+	if (ram) {
+		if (dict_ram.full) {
+			return DICT_UNKNOWN;
+		}
+		header = dict_lookup(&dict_ram, (const uint8_t *)name, length);
+		if (header != NULL) {
+			return header;
+		}
+	}
+
+	if (dict_flash.full) {
+		return DICT_UNKNOWN;
+	}
+	return dict_lookup(&dict_flash, (const uint8_t *)name, length);
+}
+
+
+/**
+ *  @brief
+ *      Appends a dictionary tail record to the journal page. The page is
+ *      erased if it is full.
+ *  @param[in]
+ *      dp      flash dictionary pointer
+ *  @param[in]
+ *      latest  latest flash header
+ *  @return
+ *      None
+ */
+void DICT_saveTail(uint32_t dp, uint32_t latest) {
+	dict_tail_t record;
+	int slot;
+
+	if (! dict_tailValid()) {
+		// the page belongs to the dictionary
+		return;
+	}
+	slot = dict_tailFree();
+	if (slot >= DICT_TAIL_SLOTS) {
+		FLASH_erasePage(DICT_TAIL_ADDRESS);
+		slot = 0;
+	}
+
+	record.magic = DICT_TAIL_MAGIC;
+	record.dp = dp;
+	record.latest = latest;
+	record.crc = dict_crc32((uint8_t *)&record, 3 * sizeof(uint32_t));
+
+	// the CRC is written last, an interrupted write gives an invalid record
+	FLASH_programBuffer(DICT_TAIL_ADDRESS + slot * sizeof(dict_tail_t),
+			&record, sizeof(record));
+}
+
+
+/**
+ *  @brief
+ *      Gets the flash dictionary pointer from the last tail record.
+ *  @param[in]
+ *      latest  latest flash header found by the dictionary walk
+ *  @return
+ *      Dictionary pointer or 0 if there is no valid record.
+ */
+uint32_t DICT_loadTail(uint32_t latest) {
+	const dict_tail_t *record;
+	const uint32_t *p;
+	uint32_t end;
+	int slot;
+
+	if (! dict_tailValid()) {
+		return 0;
+	}
+	slot = dict_tailFree();
+	if (slot == 0) {
+		return 0;
+	}
+	record = (const dict_tail_t *)DICT_TAIL_ADDRESS + slot - 1;
+
+	if (record->magic != DICT_TAIL_MAGIC
+			|| record->crc != dict_crc32((const uint8_t *)record, 3 * sizeof(uint32_t))) {
+		return 0;
+	}
+	if (record->latest != latest || record->dp <= latest
+			|| record->dp > DICT_TAIL_ADDRESS - DICT_TAIL_CHECK) {
+		// there are newer definitions
+		return 0;
+	}
+
+	// allot , flash! ... after the last smudge, the whole page (at least
+	// DICT_TAIL_CHECK bytes) has to be erased
+	end = (record->dp + DICT_TAIL_CHECK + DICT_TAIL_PAGE - 1) & ~(DICT_TAIL_PAGE - 1);
+	if (end > DICT_TAIL_ADDRESS) {
+		end = DICT_TAIL_ADDRESS;
+	}
+	for (p = (const uint32_t *)record->dp; p < (const uint32_t *)end; p++) {
+		if (*p != 0xFFFFFFFF) {
+			// written after the last smudge
+			return 0;
+		}
+	}
+	return record->dp;
+}
+
+
+// Private Functions
+// *****************
+
+/**
+ *  @brief
+ *      FNV-1a hash of the lower case name.
+ */
+static uint32_t dict_hash(const uint8_t *name, int length) {
+	uint32_t hash = 2166136261u;
+	uint8_t c;
+
+	while (length-- > 0) {
+		c = *name++;
+		if (c >= 'A' && c <= 'Z') {
+			c += 'a' - 'A';
+		}
+		hash = (hash ^ c) * 16777619u;
+	}
+	return hash;
+}
+
+
+/**
+ *  @brief
+ *      Compares the header name with the name (like compare, only A-Z are
+ *      case insensitive).
+ */
+static int dict_equal(const uint8_t *header, const uint8_t *name, int length) {
+	const uint8_t *s = header + 6;
+	uint8_t a, b;
+	int i;
+
+	if (s[0] != length) {
+		return FALSE;
+	}
+	s++;
+	for (i=0; i<length; i++) {
+		a = s[i];
+		b = name[i];
+		if (a >= 'A' && a <= 'Z') {
+			a += 'a' - 'A';
+		}
+		if (b >= 'A' && b <= 'Z') {
+			b += 'a' - 'A';
+		}
+		if (a != b) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+
+static const uint8_t *dict_lookup(const dict_table_t *table, const uint8_t *name, int length) {
+	uint32_t i = dict_hash(name, length) & table->mask;
+
+	while (table->slot[i] != NULL) {
+		if (dict_equal(table->slot[i], name, length)) {
+			return table->slot[i];
+		}
+		i = (i + 1) & table->mask;
+	}
+	return NULL;
+}
+
+
+static void dict_clear(dict_table_t *table) {
+	memset(table->slot, 0, (table->mask + 1) * sizeof(table->slot[0]));
+	table->count = 0;
+	table->full = FALSE;
+}
+
+
+/**
+ *  @brief
+ *      Binary search for the first erased journal slot. The slots are
+ *      written in ascending order.
+ *  @return
+ *      Slot index, DICT_TAIL_SLOTS if the page is full.
+ */
+static int dict_tailFree(void) {
+	const dict_tail_t *journal = (const dict_tail_t *)DICT_TAIL_ADDRESS;
+	int low = 0;
+	int high = DICT_TAIL_SLOTS;
+	int mid;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (journal[mid].magic == 0xFFFFFFFF) {
+			high = mid;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return low;
+}
+
+
+/**
+ *  @brief
+ *      Checks once that the journal page holds only tail records followed
+ *      by erased flash. Other data is dictionary code from an installation
+ *      with the previous flash layout and must not be erased.
+ *  @return
+ *      TRUE if the page can be used as journal.
+ */
+static int dict_tailValid(void) {
+	const dict_tail_t *journal = (const dict_tail_t *)DICT_TAIL_ADDRESS;
+	const uint32_t *p;
+	int slot;
+
+	if (dict_tailState >= 0) {
+		return dict_tailState;
+	}
+	dict_tailState = FALSE;
+	for (slot=0; slot<DICT_TAIL_SLOTS; slot++) {
+		if (journal[slot].magic != DICT_TAIL_MAGIC) {
+			break;
+		}
+	}
+	for (p = (const uint32_t *)&journal[slot];
+			p < (const uint32_t *)(DICT_TAIL_ADDRESS + DICT_TAIL_SIZE); p++) {
+		if (*p != 0xFFFFFFFF) {
+			return FALSE;
+		}
+	}
+	dict_tailState = TRUE;
+	return TRUE;
+}
+
+
+static uint32_t dict_crc32(const uint8_t *data, int length) {
+	uint32_t crc = 0xFFFFFFFF;
+	int i;
+
+	while (length-- > 0) {
+		crc ^= *data++;
+		for (i=0; i<8; i++) {
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+		}
+	}
+	return ~crc;
+}
+
@@ -0,0 +1,567 @@
+/**
+ *  @brief
+ *      Flash drive, FAT volume in the internal flash (FLASH_DRIVE region).
+ *
+ *      A small flash translation layer (FTL) maps the 512 byte sectors of
+ *      the FAT file system to the 4 KiB flash pages. The flash can only be
+ *      programmed in 8 byte blocks (ECC) and erased in pages, therefore
+ *      sectors are never overwritten in place. A new version of a sector
+ *      is appended to the active page and the old version is invalidated.
+ *      Pages without valid sectors are reclaimed by the garbage collection.
+ *
+ *      Page layout (4 KiB):
+ *        7 sector slots   7 * 512 bytes
+ *        page header      magic, erase count (8 bytes)
+ *        7 sector tags    logical sector, sequence number (7 * 16 bytes)
+ *
+ *      Tag of a slot:
+ *        all 1            slot is free (erased)
+ *        lsn, ~lsn        slot is written, valid if the commit is set too
+ *        seq, ~seq        commit, the highest sequence number wins
+ *        all 0            slot is obsolete (zero can always be programmed)
+ *
+ *      Wear levelling: the erased page with the lowest erase count is used
+ *      next. If the erase counts drift apart, the garbage collection moves
+ *      the coldest page (static data) too.
+ *  @file
+ *      fd.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+#include <string.h>
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "fd.h"
+#include "flash.h"
+
+
+// Defines
+// *******
+#define FD_MAGIC			0x46445256	// "FDRV"
+#define FD_UNMAPPED			0xFFFF
+#define FD_ERASED			0xFFFFFFFF
+
+#define FD_META_OFFSET		(FD_SLOTS * FD_SECTOR_SIZE)
+#define FD_TAG_SIZE			16
+
+// erase count difference which triggers the static wear levelling
+#define FD_WEAR_THRESHOLD	64
+
+#define PAGE_ADDRESS(page)	(FD_START_ADDRESS + (page) * FD_PAGE_SIZE)
+#define SLOT_ADDRESS(phys)	(PAGE_ADDRESS((phys) / FD_SLOTS) + ((phys) % FD_SLOTS) * FD_SECTOR_SIZE)
+#define HEADER(page)		((uint32_t *) (PAGE_ADDRESS(page) + FD_META_OFFSET))
+#define TAG(phys)			((uint32_t *) (PAGE_ADDRESS((phys) / FD_SLOTS) + FD_META_OFFSET + 8 + \
+								((phys) % FD_SLOTS) * FD_TAG_SIZE))
+
+
+// Private function prototypes
+// ***************************
+static int format_page(int page, uint32_t erase_count);
+static int page_erased(int page);
+static int erase_unformatted(void);
+static int write_slot(uint32_t lsn, const uint8_t *data, int gc);
+static int new_page(int gc);
+static int collect_garbage(int wear);
+static int free_pages(void);
+
+
+// Global Variables
+// ****************
+
+// RTOS resources
+// **************
+
+static osMutexId_t FD_MutexID;
+static const osMutexAttr_t FD_MutexAttr = {
+		NULL,				// no name required
+		osMutexPrioInherit,	// attr_bits
+		NULL,				// memory for control block
+		0U					// size for control block
+};
+
+
+// Private Variables
+// *****************
+
+static uint16_t map[FD_SECTORS];		// logical sector -> physical slot
+static uint8_t  used[FD_PAGES];			// written slots per page
+static uint8_t  valid[FD_PAGES];		// valid slots per page
+static uint32_t erased[FD_PAGES];		// erase count per page
+
+static int active_page = -1;
+static uint32_t sequence = 0;
+static int mounted = FALSE;
+
+static uint8_t gc_buffer[FD_SECTOR_SIZE];
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Initializes the flash drive.
+ *  @return
+ *      None
+ */
+void FD_init(void) {
+	FD_MutexID = osMutexNew(&FD_MutexAttr);
+	if (FD_MutexID == NULL) {
+		Error_Handler();
+	}
+}
+
+
+/**
+ *  @brief
+ *      Scans the flash drive and builds the sector map in RAM.
+ *
+ *      Erased or interrupted pages are (re)formatted, incomplete sector
+ *      writes are discarded. Needs a running RTOS (flash programming).
+ *  @return
+ *      FD_OK or FD_ERROR
+ */
+int FD_mount(void) {
+	int page, slot, phys;
+	uint32_t *tag;
+	uint32_t *old;
+	uint32_t lsn;
+	int return_value = FD_OK;
+
+	// only one thread is allowed to use the flash drive
+	osMutexAcquire(FD_MutexID, osWaitForever);
+
+	if (mounted) {
+		osMutexRelease(FD_MutexID);
+		return FD_OK;
+	}
+
+	memset(map, 0xFF, sizeof(map));
+	active_page = -1;
+	sequence = 0;
+
+	// a new drive in one burst, format_page() only writes the headers
+	if (erase_unformatted() != FD_OK) {
+		return_value = FD_ERROR;
+	}
+
+	for (page=0; page<FD_PAGES; page++) {
+		used[page] = 0;
+		valid[page] = 0;
+		if (HEADER(page)[0] != FD_MAGIC) {
+			// never formatted or erase interrupted
+			if (format_page(page, 0) != FD_OK) {
+				return_value = FD_ERROR;
+			}
+			continue;
+		}
+		erased[page] = HEADER(page)[1];
+
+		for (slot=0; slot<FD_SLOTS; slot++) {
+			phys = page * FD_SLOTS + slot;
+			tag = TAG(phys);
+			if (tag[0] == FD_ERASED && tag[1] == FD_ERASED) {
+				// slots are written in ascending order, the rest is free
+				break;
+			}
+			used[page]++;
+			lsn = tag[0];
+			if (lsn != ~tag[1] || lsn >= FD_SECTORS || tag[2] != ~tag[3]) {
+				if (tag[0] != 0 || tag[1] != 0) {
+					// incomplete write -> obsolete
+					FLASH_programDouble((uint32_t) tag, 0, 0);
+				}
+				continue;
+			}
+			if (tag[2] > sequence) {
+				sequence = tag[2];
+			}
+			if (map[lsn] != FD_UNMAPPED) {
+				// two versions of the same sector, the newer one wins
+				old = TAG(map[lsn]);
+				if (old[2] > tag[2]) {
+					FLASH_programDouble((uint32_t) tag, 0, 0);
+					continue;
+				}
+				FLASH_programDouble((uint32_t) old, 0, 0);
+				valid[map[lsn] / FD_SLOTS]--;
+			}
+			map[lsn] = phys;
+			valid[page]++;
+		}
+
+		if (used[page] > 0 && used[page] < FD_SLOTS) {
+			// partially written page, continue there
+			active_page = page;
+		}
+	}
+
+	mounted = (return_value == FD_OK);
+	osMutexRelease(FD_MutexID);
+	return return_value;
+}
+
+
+/**
+ *  @brief
+ *      Gets the flash drive size.
+ *  @return
+ *      Number of 512 byte sectors
+ */
+int FD_getSectors(void) {
+	return FD_SECTORS;
+}
+
+
+/**
+ *  @brief
+ *      Reads sector(s) from the flash drive.
+ *
+ *      Sectors never written are read as erased flash (0xFF).
+ *  @param[out]
+ *      pData      buffer
+ *  @param[in]
+ *      ReadAddr   first sector
+ *  @param[in]
+ *      NumOfBlocks  number of sectors
+ *  @return
+ *      FD_OK or FD_ERROR
+ */
+uint8_t FD_ReadBlocks(uint8_t *pData, uint32_t ReadAddr, uint32_t NumOfBlocks) {
+	uint32_t i;
+
+	if (!mounted || ReadAddr + NumOfBlocks > FD_SECTORS) {
+		return FD_ERROR;
+	}
+
+	// only one thread is allowed to use the flash drive
+	osMutexAcquire(FD_MutexID, osWaitForever);
+
+	for (i=0; i<NumOfBlocks; i++) {
+		if (map[ReadAddr + i] == FD_UNMAPPED) {
+			memset(pData, 0xFF, FD_SECTOR_SIZE);
+		} else {
+			memcpy(pData, (uint8_t *) SLOT_ADDRESS(map[ReadAddr + i]), FD_SECTOR_SIZE);
+		}
+		pData += FD_SECTOR_SIZE;
+	}
+
+	osMutexRelease(FD_MutexID);
+	return FD_OK;
+}
+
+
+/**
+ *  @brief
+ *      Writes sector(s) to the flash drive.
+ *  @param[in]
+ *      pData      buffer
+ *  @param[in]
+ *      WriteAddr  first sector
+ *  @param[in]
+ *      NumOfBlocks  number of sectors
+ *  @return
+ *      FD_OK or FD_ERROR
+ */
+uint8_t FD_WriteBlocks(const uint8_t *pData, uint32_t WriteAddr, uint32_t NumOfBlocks) {
+	uint32_t i;
+	uint8_t return_value = FD_OK;
+
+	if (!mounted || WriteAddr + NumOfBlocks > FD_SECTORS) {
+		return FD_ERROR;
+	}
+
+	// only one thread is allowed to use the flash drive
+	osMutexAcquire(FD_MutexID, osWaitForever);
+
+	for (i=0; i<NumOfBlocks; i++) {
+		if (write_slot(WriteAddr + i, pData, FALSE) != FD_OK) {
+			return_value = FD_ERROR;
+			break;
+		}
+		pData += FD_SECTOR_SIZE;
+	}
+
+	osMutexRelease(FD_MutexID);
+	return return_value;
+}
+
+
+// Private Functions
+// *****************
+
+/**
+ *  @brief
+ *      Erases a page (if not already erased) and writes the page header.
+ *  @param[in]
+ *      page
+ *  @param[in]
+ *      erase_count  new erase count
+ *  @return
+ *      FD_OK or FD_ERROR
+ */
+static int format_page(int page, uint32_t erase_count) {
+	if (! page_erased(page)) {
+		if (FLASH_erasePage(PAGE_ADDRESS(page)) != HAL_OK) {
+			return FD_ERROR;
+		}
+	}
+	if (FLASH_programDouble((uint32_t) HEADER(page), FD_MAGIC, erase_count) != HAL_OK) {
+		return FD_ERROR;
+	}
+	erased[page] = erase_count;
+	used[page] = 0;
+	valid[page] = 0;
+	return FD_OK;
+}
+
+
+/**
+ *  @brief
+ *      Checks if the whole page is erased.
+ *  @param[in]
+ *      page
+ *  @return
+ *      TRUE if erased
+ */
+static int page_erased(int page) {
+	uint32_t *p;
+
+	for (p = (uint32_t *) PAGE_ADDRESS(page); p < (uint32_t *) PAGE_ADDRESS(page+1); p++) {
+		if (*p != FD_ERASED) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+
+/**
+ *  @brief
+ *      Erases the unformatted pages (no header) with FLASH_eraseRange(),
+ *      adjacent pages in one burst.
+ *  @return
+ *      FD_OK or FD_ERROR
+ */
+static int erase_unformatted(void) {
+	int page;
+	int first = -1;
+	int return_value = FD_OK;
+
+	for (page=0; page<=FD_PAGES; page++) {
+		if (page < FD_PAGES && HEADER(page)[0] != FD_MAGIC && ! page_erased(page)) {
+			if (first < 0) {
+				first = page;
+			}
+		} else if (first >= 0) {
+			if (FLASH_eraseRange(PAGE_ADDRESS(first), PAGE_ADDRESS(page)) != HAL_OK) {
+				return_value = FD_ERROR;
+			}
+			first = -1;
+		}
+	}
+	return return_value;
+}
+
+
+/**
+ *  @brief
+ *      Appends a sector to the active page and invalidates the old version.
+ *
+ *      The tag is programmed before the data, the commit after the data.
+ *  @param[in]
+ *      lsn   logical sector number
+ *  @param[in]
+ *      data  512 bytes
+ *  @param[in]
+ *      gc    TRUE if called from the garbage collection
+ *  @return
+ *      FD_OK or FD_ERROR
+ */
+static int write_slot(uint32_t lsn, const uint8_t *data, int gc) {
+	int phys;
+
+	if (active_page < 0 || used[active_page] >= FD_SLOTS) {
+		active_page = new_page(gc);
+		if (active_page < 0) {
+			return FD_ERROR;
+		}
+	}
+
+	phys = active_page * FD_SLOTS + used[active_page];
+	used[active_page]++;
+
+	if (FLASH_programDouble((uint32_t) TAG(phys), lsn, ~lsn) != HAL_OK) {
+		return FD_ERROR;
+	}
+	// the FatFs buffer is not necessarily word aligned, erased doublewords
+	// are skipped
+	if (FLASH_programBuffer(SLOT_ADDRESS(phys), data, FD_SECTOR_SIZE) != HAL_OK) {
+		return FD_ERROR;
+	}
+	sequence++;
+	if (FLASH_programDouble((uint32_t) TAG(phys) + 8, sequence, ~sequence) != HAL_OK) {
+		return FD_ERROR;
+	}
+
+	if (map[lsn] != FD_UNMAPPED) {
+		// invalidate the old version
+		FLASH_programDouble((uint32_t) TAG(map[lsn]), 0, 0);
+		valid[map[lsn] / FD_SLOTS]--;
+	}
+	map[lsn] = phys;
+	valid[active_page]++;
+
+	return FD_OK;
+}
+
+
+/**
+ *  @brief
+ *      Gets an erased page with the lowest erase count.
+ *
+ *      One erased page is kept in reserve for the garbage collection.
+ *  @param[in]
+ *      gc    TRUE if called from the garbage collection
+ *  @return
+ *      page or -1 on error
+ */
+static int new_page(int gc) {
+	int page;
+	int best = -1;
+	int tries = FD_PAGES;
+
+	if (!gc) {
+		if (free_pages() >= 2) {
+			// static wear levelling, frees one page and uses one
+			if (collect_garbage(TRUE) != FD_OK) {
+				return -1;
+			}
+		}
+		while (free_pages() < 2) {
+			if (collect_garbage(FALSE) != FD_OK || --tries == 0) {
+				return -1;
+			}
+		}
+		if (active_page >= 0 && used[active_page] < FD_SLOTS) {
+			// the garbage collection opened a new page
+			return active_page;
+		}
+	}
+
+	for (page=0; page<FD_PAGES; page++) {
+		if (used[page] == 0 && page != active_page) {
+			if (best < 0 || erased[page] < erased[best]) {
+				best = page;
+			}
+		}
+	}
+	return best;
+}
+
+
+/**
+ *  @brief
+ *      Reclaims one page.
+ *
+ *      The page with the fewest valid sectors is chosen. For the static
+ *      wear levelling the least erased page is moved, but only if the erase
+ *      counts differ too much. The move does not gain a free page, it needs
+ *      a spare page.
+ *  @param[in]
+ *      wear  TRUE for the wear levelling
+ *  @return
+ *      FD_OK or FD_ERROR
+ */
+static int collect_garbage(int wear) {
+	int page;
+	int victim = -1;
+	int coldest = -1;
+	uint32_t max_erased = 0;
+	int slot, phys;
+	uint32_t lsn;
+
+	for (page=0; page<FD_PAGES; page++) {
+		if (erased[page] > max_erased) {
+			max_erased = erased[page];
+		}
+		if (used[page] == 0 || page == active_page) {
+			continue;
+		}
+		if (victim < 0 || valid[page] < valid[victim] ||
+				(valid[page] == valid[victim] && erased[page] < erased[victim])) {
+			victim = page;
+		}
+		if (coldest < 0 || erased[page] < erased[coldest]) {
+			coldest = page;
+		}
+	}
+	if (wear) {
+		if (coldest < 0 || max_erased - erased[coldest] <= FD_WEAR_THRESHOLD) {
+			// nothing to do
+			return FD_OK;
+		}
+		victim = coldest;
+	} else if (victim < 0) {
+		return FD_ERROR;
+	}
+
+	// move the valid sectors
+	for (slot=0; slot<used[victim]; slot++) {
+		phys = victim * FD_SLOTS + slot;
+		lsn = TAG(phys)[0];
+		if (lsn < FD_SECTORS && map[lsn] == phys) {
+			memcpy(gc_buffer, (uint8_t *) SLOT_ADDRESS(phys), FD_SECTOR_SIZE);
+			if (write_slot(lsn, gc_buffer, TRUE) != FD_OK) {
+				return FD_ERROR;
+			}
+		}
+	}
+
+	return format_page(victim, erased[victim] + 1);
+}
+
+
+/**
+ *  @brief
+ *      Counts the erased pages.
+ *  @return
+ *      Number of erased pages (without the active page)
+ */
+static int free_pages(void) {
+	int page;
+	int count = 0;
+
+	for (page=0; page<FD_PAGES; page++) {
+		if (used[page] == 0 && page != active_page) {
+			count++;
+		}
+	}
+	return count;
+}
@@ -6,6 +6,18 @@
  *      The STM32WB has only one flash bank and the access to the flash
  *      during program/erase is not possible.
  *      Erase takes about 20 ms, program 2 ms.
+ *
+ *      Compiling into the flash (hflash!) collects the halfwords in row
+ *      buffers (64 doublewords, direct mapped by the row address). A
+ *      complete row in erased flash is written with fast programming, the
+ *      partial rows (flushflash after each definition) as bursts with one
+ *      unlock. Fast programming only happens for definitions longer than
+ *      a row, the gain for normal words is the single round trip.
+ *
+ *      FLASH_programBuffer and FLASH_eraseRange are bursts: the mutex, the
+ *      unlock and the flash semaphore shared with CPU2 are taken once, the
+ *      next doubleword (page) is started from the end of operation
+ *      interrupt.
  *  @file
  *      flash.c
  *  @author
@@ -33,6 +45,7 @@
 
 // System include files
 // ********************
+#include <string.h>
 #include "cmsis_os.h"
 
 // Application include files
@@ -43,8 +56,27 @@
 
 
 
+// Private typedefs
+// ****************
+typedef struct {
+	uint32_t address;	// row address, 0 = free slot
+	int count;			// written halfwords
+	uint32_t written[FLASH_ROW_SIZE / 2 / 32];	// bitmap of the written halfwords
+	uint64_t data[FLASH_ROW_SIZE / 8];
+} flash_row_t;
+
+
 // Private function prototypes
 // ***************************
+static void flash_rowCommit(flash_row_t *row);
+static int flash_rowErased(uint32_t Address);
+static void flash_lockCPU2(void);
+static void flash_unlockCPU2(void);
+static void flash_acquire(void);
+static void flash_release(void);
+static int flash_programBurst(uint32_t Address, const void *data, int length);
+static int flash_burstNext(void);
+static void flash_burstProgram(void);
 
 // Global Variables
 // ****************
@@ -71,6 +103,13 @@ static FLASH_EraseInitTypeDef EraseInitStruct;
 static volatile uint32_t PageOrAddress;
 static volatile uint8_t FlashError = FALSE;
 
+static flash_row_t flash_rows[FLASH_ROW_SLOTS];
+
+// program burst, BurstEnd = 0 if there is no burst
+static const uint8_t * volatile BurstData;
+static volatile uint32_t BurstAddress;
+static volatile uint32_t BurstEnd = 0;
+
 
 // Public Functions
 // ****************
@@ -128,6 +167,7 @@ int FLASH_programDouble(uint32_t Address, uint32_t word1, uint32_t word2) {
 
 	// only one thread is allowed to use the flash
 	osMutexAcquire(FLASH_MutexID, osWaitForever);
+	flash_lockCPU2();
 
 	FlashError = FALSE;
 	if (HAL_FLASH_Unlock() == HAL_ERROR) {
@@ -157,6 +197,7 @@ int FLASH_programDouble(uint32_t Address, uint32_t word1, uint32_t word2) {
 		Error_Handler();
 	}
 
+	flash_unlockCPU2();
 	osMutexRelease(FLASH_MutexID);
 	return return_value;
 }
@@ -176,12 +217,14 @@ int FLASH_erasePage(uint32_t Address) {
 
 	// only one thread is allowed to use the flash
 	osMutexAcquire(FLASH_MutexID, osWaitForever);
+	flash_lockCPU2();
 
 	FlashError = FALSE;
 	HAL_FLASH_Unlock();
 	// Clear OPTVERR bit set on virgin samples
 	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_OPTVERR);
 	EraseInitStruct.Page = (Address - FLASH_BASE) / FLASH_PAGE_SIZE;
+	EraseInitStruct.NbPages = 1;
 	if (HAL_FLASHEx_IsOperationSuspended()) {
 		Error_Handler();
 	}
@@ -197,14 +240,439 @@ int FLASH_erasePage(uint32_t Address) {
 		Error_Handler();
 	}
 	HAL_FLASH_Lock();
+	flash_unlockCPU2();
+	osMutexRelease(FLASH_MutexID);
+	return return_value;
+}
+
+
+/**
+ *  @brief
+ *      Programs a buffer into the FLASH as one burst. Erased doublewords
+ *      (all bits set) are skipped, they can be programmed later.
+ *  @param[in]
+ *      Address  first byte, doubleword aligned
+ *  @param[in]
+ *      data     source, no alignment required
+ *  @param[in]
+ *      length   number of bytes, multiple of 8
+ *  @return
+ *      HAL Status
+ */
+int FLASH_programBuffer(uint32_t Address, const void *data, int length) {
+	int return_value;
+
+	if (Address < 0x08040000 || Address + length > 0x080C0000
+			|| (Address & 7) != 0 || (length & 7) != 0 || length < 0) {
+		Error_Handler();
+		return -1;
+	}
+
+	flash_acquire();
+	return_value = flash_programBurst(Address, data, length);
+	flash_release();
+	return return_value;
+}
+
+
+/**
+ *  @brief
+ *      Erases the pages from start to end as one burst.
+ *  @param[in]
+ *      start  first byte, rounded down to the page
+ *  @param[in]
+ *      end    first byte after the range, rounded up to the page
+ *  @return
+ *      HAL Status
+ */
+int FLASH_eraseRange(uint32_t start, uint32_t end) {
+	int return_value;
+	osStatus_t status;
+
+	if (start < 0x08040000 || end > 0x080C0000 || start >= end) {
+		Error_Handler();
+		return -1;
+	}
+
+	// only one thread is allowed to use the flash
+	osMutexAcquire(FLASH_MutexID, osWaitForever);
+	flash_lockCPU2();
+
+	FlashError = FALSE;
+	HAL_FLASH_Unlock();
+	// Clear OPTVERR bit set on virgin samples
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_OPTVERR);
+	EraseInitStruct.Page = (start - FLASH_BASE) / FLASH_PAGE_SIZE;
+	// the HAL starts the next page from the interrupt
+	EraseInitStruct.NbPages = (end - 1 - FLASH_BASE) / FLASH_PAGE_SIZE
+			- EraseInitStruct.Page + 1;
+	if (HAL_FLASHEx_IsOperationSuspended()) {
+		Error_Handler();
+	}
+	return_value = HAL_FLASHEx_Erase_IT(&EraseInitStruct);
+	if (return_value == HAL_OK) {
+		// blocked till the last page is erased
+		status = osSemaphoreAcquire(FLASH_SemaphoreID, osWaitForever);
+		if (FlashError || (status != osOK)) {
+			return_value = HAL_ERROR;
+			Error_Handler();
+		}
+	} else {
+		Error_Handler();
+	}
+	EraseInitStruct.NbPages = 1;
+	HAL_FLASH_Lock();
+	flash_unlockCPU2();
+	osMutexRelease(FLASH_MutexID);
+	return return_value;
+}
+
+
+/**
+ *  @brief
+ *      Programs a row (64 doublewords) in the FLASH with fast programming.
+ *      The row has to be erased.
+ *  @param[in]
+ *      Address  first byte, row aligned
+ *  @param[in]
+ *      data     64 doublewords
+ *  @return
+ *      HAL Status, HAL_ERROR if the flash refuses the fast programming
+ */
+int FLASH_programRow(uint32_t Address, const uint64_t *data) {
+	int return_value;
+	osStatus_t status;
+
+	if (Address < 0x08040000 || Address > 0x080C0000 - FLASH_ROW_SIZE
+			|| (Address & (FLASH_ROW_SIZE - 1)) != 0) {
+		Error_Handler();
+		return -1;
+	}
+
+	// only one thread is allowed to use the flash
+	osMutexAcquire(FLASH_MutexID, osWaitForever);
+	flash_lockCPU2();
+
+	FlashError = FALSE;
+	if (HAL_FLASH_Unlock() == HAL_ERROR) {
+		Error_Handler();
+	}
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_OPTVERR);
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+
+	if (HAL_FLASHEx_IsOperationSuspended()) {
+		Error_Handler();
+	}
+	return_value = HAL_FLASH_Program_IT(FLASH_TYPEPROGRAM_FAST, Address,
+			(uint32_t)data);
+	if (return_value == HAL_OK) {
+		// blocked till programming is finished
+		status = osSemaphoreAcquire(FLASH_SemaphoreID, osWaitForever);
+		if (FlashError || (status != osOK)) {
+			// e.g. PGSERR, nothing written. The caller falls back to doublewords
+			return_value = HAL_ERROR;
+		}
+	}
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+	if (HAL_FLASH_Lock() == HAL_ERROR) {
+		Error_Handler();
+	}
+
+	flash_unlockCPU2();
 	osMutexRelease(FLASH_MutexID);
 	return return_value;
 }
 
 
+/**
+ *  @brief
+ *      Collects a halfword in the row buffer. A complete row is programmed.
+ *  @param[in]
+ *      Address  even address
+ *  @param[in]
+ *      value    halfword
+ *  @return
+ *      FALSE if the slot is used by another row, TRUE otherwise.
+ */
+int FLASH_rowStore(uint32_t Address, uint16_t value) {
+	uint32_t row_address = Address & ~(FLASH_ROW_SIZE - 1);
+	flash_row_t *row = &flash_rows[(row_address / FLASH_ROW_SIZE) % FLASH_ROW_SLOTS];
+	int i;
+
+	if (row->address != row_address) {
+		if (row->address != 0) {
+			return FALSE;
+		}
+		row->address = row_address;
+		row->count = 0;
+		memset(row->written, 0, sizeof(row->written));
+		memset(row->data, 0xFF, sizeof(row->data));
+	}
+
+	i = (Address - row_address) / 2;
+	((uint16_t *)row->data)[i] = value;
+	if ((row->written[i / 32] & (1u << (i % 32))) == 0) {
+		row->written[i / 32] |= 1u << (i % 32);
+		row->count++;
+	}
+
+	if (row->count == FLASH_ROW_SIZE / 2) {
+		flash_rowCommit(row);
+	}
+	return TRUE;
+}
+
+
+/**
+ *  @brief
+ *      Takes back the halfwords from Start to End out of the row buffer,
+ *      e.g. the last opcodes for the peephole optimiser.
+ *  @param[in]
+ *      Start  even address
+ *  @param[in]
+ *      End    end address (exclusive)
+ *  @return
+ *      TRUE if all halfwords were in the row buffer and are removed. FALSE
+ *      if some are programmed or in the collection table, nothing changed.
+ */
+int FLASH_rowRewind(uint32_t Start, uint32_t End) {
+	uint32_t row_address;
+	flash_row_t *row;
+	uint32_t a;
+	int i;
+
+	for (a=Start; a<End; a+=2) {
+		row_address = a & ~(FLASH_ROW_SIZE - 1);
+		row = &flash_rows[(row_address / FLASH_ROW_SIZE) % FLASH_ROW_SLOTS];
+		i = (a - row_address) / 2;
+		if (row->address != row_address
+				|| (row->written[i / 32] & (1u << (i % 32))) == 0) {
+			return FALSE;
+		}
+	}
+
+	for (a=Start; a<End; a+=2) {
+		row_address = a & ~(FLASH_ROW_SIZE - 1);
+		row = &flash_rows[(row_address / FLASH_ROW_SIZE) % FLASH_ROW_SLOTS];
+		i = (a - row_address) / 2;
+		((uint16_t *)row->data)[i] = 0xFFFF;
+		row->written[i / 32] &= ~(1u << (i % 32));
+		row->count--;
+		if (row->count == 0) {
+			row->address = 0;
+		}
+	}
+	return TRUE;
+}
+
+
+/**
+ *  @brief
+ *      Programs all partial rows (one burst per row, but one unlock and
+ *      CPU2 semaphore round trip for all) and frees the slots.
+ *  @return
+ *      None
+ */
+void FLASH_rowFlush(void) {
+	int i;
+	int used = FALSE;
+
+	for (i=0; i<FLASH_ROW_SLOTS; i++) {
+		if (flash_rows[i].address != 0) {
+			used = TRUE;
+		}
+	}
+	if (! used) {
+		return;
+	}
+
+	// complete rows are already programmed, all rows with one unlock
+	flash_acquire();
+	for (i=0; i<FLASH_ROW_SLOTS; i++) {
+		if (flash_rows[i].address != 0) {
+			flash_programBurst(flash_rows[i].address, flash_rows[i].data, FLASH_ROW_SIZE);
+			flash_rows[i].address = 0;
+		}
+	}
+	flash_release();
+}
+
+
+/**
+ *  @brief
+ *      Discards the row buffers (initflash).
+ *  @return
+ *      None
+ */
+void FLASH_rowInit(void) {
+	int i;
+
+	for (i=0; i<FLASH_ROW_SLOTS; i++) {
+		flash_rows[i].address = 0;
+	}
+}
+
+
 // Private Functions
 // *****************
 
+/**
+ *  @brief
+ *      Programs a row buffer and frees the slot. A row which is not complete
+ *      is programmed as one burst, the doublewords without written halfwords
+ *      are still erased (all bits set) in the buffer and skipped.
+ *  @param[in]
+ *      row  row buffer
+ *  @return
+ *      None
+ */
+static void flash_rowCommit(flash_row_t *row) {
+	if (row->count == FLASH_ROW_SIZE / 2 && flash_rowErased(row->address)) {
+		if (FLASH_programRow(row->address, row->data) == HAL_OK) {
+			row->address = 0;
+			return;
+		}
+	}
+
+	FLASH_programBuffer(row->address, row->data, FLASH_ROW_SIZE);
+	row->address = 0;
+}
+
+
+static int flash_rowErased(uint32_t Address) {
+	const uint32_t *p = (const uint32_t *)Address;
+	int i;
+
+	for (i=0; i<FLASH_ROW_SIZE/4; i++) {
+		if (p[i] != 0xFFFFFFFF) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+
+/**
+ *  @brief
+ *      Takes the flash semaphore shared with CPU2 (wireless stack).
+ */
+static void flash_lockCPU2(void) {
+	while (LL_HSEM_1StepLock(HSEM, CFG_HW_FLASH_SEMID)) {
+		osDelay(1);
+	}
+}
+
+
+static void flash_unlockCPU2(void) {
+	LL_HSEM_ReleaseLock(HSEM, CFG_HW_FLASH_SEMID, 0);
+}
+
+
+/**
+ *  @brief
+ *      Takes the mutex and the CPU2 semaphore and unlocks the flash for
+ *      programming.
+ */
+static void flash_acquire(void) {
+	// only one thread is allowed to use the flash
+	osMutexAcquire(FLASH_MutexID, osWaitForever);
+	flash_lockCPU2();
+
+	FlashError = FALSE;
+	if (HAL_FLASH_Unlock() == HAL_ERROR) {
+		Error_Handler();
+	}
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_OPTVERR);
+	__HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+}
+
+
+static void flash_release(void) {
+	if (HAL_FLASH_Lock() == HAL_ERROR) {
+		Error_Handler();
+	}
+
+	flash_unlockCPU2();
+	osMutexRelease(FLASH_MutexID);
+}
+
+
+/**
+ *  @brief
+ *      Programs a buffer, the flash is unlocked (flash_acquire()). The
+ *      first doubleword by the HAL, the others from the callback.
+ *  @return
+ *      HAL Status
+ */
+static int flash_programBurst(uint32_t Address, const void *data, int length) {
+	int return_value = HAL_OK;
+	osStatus_t status;
+	uint64_t doubleword;
+
+	BurstData = data;
+	BurstAddress = Address;
+	BurstEnd = Address + length;
+	if (flash_burstNext()) {
+		if (HAL_FLASHEx_IsOperationSuspended()) {
+			Error_Handler();
+		}
+		memcpy(&doubleword, BurstData, 8);
+		return_value = HAL_FLASH_Program_IT(FLASH_TYPEPROGRAM_DOUBLEWORD,
+				BurstAddress, doubleword);
+		if (return_value == HAL_OK) {
+			// blocked till the whole buffer is programmed
+			status = osSemaphoreAcquire(FLASH_SemaphoreID, osWaitForever);
+			if (FlashError || (status != osOK)) {
+				return_value = HAL_ERROR;
+				Error_Handler();
+			}
+		} else {
+			Error_Handler();
+		}
+	}
+	BurstEnd = 0;
+	return return_value;
+}
+
+
+/**
+ *  @brief
+ *      Skips the erased doublewords of the burst.
+ *  @return
+ *      TRUE if there is a doubleword to program.
+ */
+static int flash_burstNext(void) {
+	uint32_t word[2];
+
+	while (BurstAddress < BurstEnd) {
+		memcpy(word, BurstData, 8);
+		if (word[0] != 0xFFFFFFFF || word[1] != 0xFFFFFFFF) {
+			return TRUE;
+		}
+		BurstAddress += 8;
+		BurstData += 8;
+	}
+	return FALSE;
+}
+
+
+/**
+ *  @brief
+ *      Starts programming the next doubleword of the burst (interrupt).
+ *      The HAL procedure stays active, the interrupts remain enabled.
+ */
+static void flash_burstProgram(void) {
+	uint32_t word[2];
+
+	memcpy(word, BurstData, 8);
+	pFlash.Address = BurstAddress;
+	pFlash.ProcedureOnGoing = FLASH_TYPEPROGRAM_DOUBLEWORD;
+	SET_BIT(FLASH->CR, FLASH_CR_PG);
+	*(__IO uint32_t *)BurstAddress = word[0];
+	__ISB();
+	*(__IO uint32_t *)(BurstAddress + 4) = word[1];
+}
+
 
 // Callbacks
 // *********
@@ -218,6 +686,21 @@ int FLASH_erasePage(uint32_t Address) {
   */
 void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue) {
 	PageOrAddress = ReturnValue;
+	if (FlashError) {
+		// released by the error callback
+		return;
+	}
+	if (BurstEnd != 0) {
+		BurstAddress += 8;
+		BurstData += 8;
+		if (flash_burstNext()) {
+			flash_burstProgram();
+			return;
+		}
+	} else if (pFlash.ProcedureOnGoing == FLASH_TYPEERASE_PAGES) {
+		// erase burst, the HAL erases the next page
+		return;
+	}
 	osSemaphoreRelease(FLASH_SemaphoreID);
 }
 
@@ -0,0 +1,261 @@
+/**
+ *  @brief
+ *      Floating point unit, single precision (IEEE 754 binary32).
+ *
+ *      The float words are in fpu.s, they use the FPU directly. Here are
+ *      the initialization and the conversions between strings and floats
+ *      for the interpreter (float literals) and f.
+ *
+ *      The FPU context (s0-s15, FPSCR) is saved by the hardware for
+ *      interrupts, the FreeRTOS port saves s16-s31 on task switches. With
+ *      lazy stacking the registers are only saved if the interrupted
+ *      context has used the FPU. Therefore every Forth thread and every
+ *      ISR written in Forth can use the float words.
+ *
+ *      Float literals need an exponent and base 10 like in ANS Forth:
+ *      1e 1.5e3 -2.5E-3 (1.5 is a double number).
+ *  @file
+ *      fpu.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "fpu.h"
+
+
+// Private function prototypes
+// ***************************
+static int fpu_isDigit(char c);
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Enables the FPU with automatic state preservation and lazy stacking.
+ *  @return
+ *      None
+ */
+void FPU_init(void) {
+	// CP10 and CP11 full access (SystemInit does it too)
+	SCB->CPACR |= (3UL << (10*2)) | (3UL << (11*2));
+
+	// extended stack frame for contexts using the FPU, the registers are
+	// stored only if the handler uses the FPU
+	FPU->FPCCR |= FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk;
+	__DSB();
+	__ISB();
+}
+
+
+/**
+ *  @brief
+ *      Converts a float literal.
+ *
+ *      [+|-]digits[.digits](e|E)[+|-][digits], at least one mantissa digit.
+ *  @param[in]
+ *      str     string (not NUL terminated)
+ *  @param[in]
+ *      length  string length
+ *  @param[out]
+ *      f       float
+ *  @return
+ *      TRUE for a valid float literal, *f is only written in this case.
+ */
+int FPU_str2f(const char *str, int length, float *f) {
+	char buffer[FPU_STRING_SIZE];
+	const char *end = str + length;
+	char *p = buffer;
+	int mantissa = 0;
+
+	if (length > FPU_STRING_SIZE - 2) {
+		// no room for the exponent 0 and the NUL
+		return FALSE;
+	}
+
+	if (str < end && (*str == '-' || *str == '+')) {
+		*p++ = *str++;
+	}
+	while (str < end && fpu_isDigit(*str)) {
+		*p++ = *str++;
+		mantissa++;
+	}
+	if (str < end && *str == '.') {
+		*p++ = *str++;
+		while (str < end && fpu_isDigit(*str)) {
+			*p++ = *str++;
+			mantissa++;
+		}
+	}
+	if (mantissa == 0 || str >= end || (*str != 'e' && *str != 'E')) {
+		return FALSE;
+	}
+
+	*p++ = *str++;
+	if (str < end && (*str == '-' || *str == '+')) {
+		*p++ = *str++;
+	}
+	if (str == end) {
+		// 1e is 1e0
+		*p++ = '0';
+	}
+	while (str < end && fpu_isDigit(*str)) {
+		*p++ = *str++;
+	}
+	if (str != end) {
+		return FALSE;
+	}
+	*p = 0;
+
+	*f = strtof(buffer, NULL);
+	return TRUE;
+}
+
+
+/**
+ *  @brief
+ *      Converts a float to a string with FPU_DIGITS significant digits.
+ *
+ *      Fixed point notation for 1e-4 <= |f| < 1e7, otherwise with exponent.
+ *      Trailing zeros are removed, fixed point numbers always have a
+ *      decimal point (1. 0.25 1.5e-9 1e38).
+ *  @param[in]
+ *      f       float
+ *  @param[out]
+ *      buffer  at least FPU_STRING_SIZE bytes, NUL terminated
+ *  @return
+ *      string length
+ */
+int FPU_f2str(float f, char *buffer) {
+	char digits[FPU_DIGITS];
+	char *p = buffer;
+	double d = f;
+	uint32_t m;
+	uint32_t scale = 1;
+	int exponent = 0;
+	int last;
+	int i;
+
+	if (f != f) {
+		strcpy(buffer, "nan");
+		return 3;
+	}
+	if (d < 0) {
+		*p++ = '-';
+		d = -d;
+	}
+	if (d > FLT_MAX) {
+		strcpy(p, "inf");
+		return p - buffer + 3;
+	}
+	if (d == 0) {
+		strcpy(p, "0.");
+		return p - buffer + 2;
+	}
+
+	// 1 <= d < 10, double has enough precision for the 7 digits
+	while (d >= 10.0) {
+		d /= 10.0;
+		exponent++;
+	}
+	while (d < 1.0) {
+		d *= 10.0;
+		exponent--;
+	}
+
+	for (i=1; i<FPU_DIGITS; i++) {
+		scale *= 10;
+	}
+	m = (uint32_t)(d * scale + 0.5);
+	if (m >= 10 * scale) {
+		// rounded up to 10.00000
+		m /= 10;
+		exponent++;
+	}
+	for (i=FPU_DIGITS-1; i>=0; i--) {
+		digits[i] = '0' + m % 10;
+		m /= 10;
+	}
+	last = FPU_DIGITS - 1;
+	while (last > 0 && digits[last] == '0') {
+		last--;
+	}
+
+	if (exponent >= 0 && exponent < FPU_DIGITS) {
+		for (i=0; i<=exponent; i++) {
+			*p++ = digits[i];
+		}
+		*p++ = '.';
+		for (i=exponent+1; i<=last; i++) {
+			*p++ = digits[i];
+		}
+	} else if (exponent < 0 && exponent >= -4) {
+		*p++ = '0';
+		*p++ = '.';
+		for (i=exponent+1; i<0; i++) {
+			*p++ = '0';
+		}
+		for (i=0; i<=last; i++) {
+			*p++ = digits[i];
+		}
+	} else {
+		*p++ = digits[0];
+		if (last > 0) {
+			*p++ = '.';
+		}
+		for (i=1; i<=last; i++) {
+			*p++ = digits[i];
+		}
+		*p++ = 'e';
+		if (exponent < 0) {
+			*p++ = '-';
+			exponent = -exponent;
+		}
+		if (exponent >= 10) {
+			*p++ = '0' + exponent / 10;
+		}
+		*p++ = '0' + exponent % 10;
+	}
+	*p = 0;
+	return p - buffer;
+}
+
+
+// Private Functions
+// *****************
+
+static int fpu_isDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
@@ -39,6 +39,7 @@
 #include "time.h"
 #include <string.h>
 #include <ctype.h>
+#include <stdlib.h>
 
 
 // Application include files
@@ -50,11 +51,41 @@
 #include "ff.h"
 #include "rtc.h"
 #include "block.h"
+#include "terminal.h"
 
 
 // Defines
 // *******
 #define LINE_LENGTH	256
+#define SINK_SIZE	(4 * _MIN_SS)	// >file buffer, multiple of the sector size
+
+// YMODEM
+#define YM_SOH				0x01	// 128 byte block
+#define YM_STX				0x02	// 1024 byte block
+#define YM_EOT				0x04
+#define YM_ACK				0x06
+#define YM_NAK				0x15
+#define YM_CAN				0x18
+#define YM_PAD				0x1A	// CPMEOF
+#define YM_CRC				'C'		// request CRC16 mode
+#define YM_PACKET_128		128
+#define YM_PACKET_1K		1024
+#define YM_FRAME_HEADER		3		// SOH/STX, seq, ~seq
+#define YM_FRAME_OVERHEAD	(YM_FRAME_HEADER + 2)
+#define YM_BUFFER_SIZE		(8 * _MIN_SS)	// f_write chunk, multiple of the sector size
+#define YM_RETRIES			10
+#define YM_CHAR_TIMEOUT		1000	// ms between characters
+#define YM_PACKET_TIMEOUT	10000	// ms to wait for a packet or an ACK
+#define YM_START_TIMEOUT	3000	// ms
+#define YM_START_RETRIES	20
+
+enum {
+	YM_OK = 0,
+	YM_EOT_RECEIVED,
+	YM_CANCEL,
+	YM_TIMEOUT,
+	YM_ERROR
+};
 
 // Private typedefs
 // ****************
@@ -62,6 +93,16 @@
 
 // Private function prototypes
 // ***************************
+static const char *size2str(FSIZE_t size);
+static uint16_t ym_crc16(const uint8_t *buffer, int length);
+static int ym_getc(uint64_t *stack, int timeout);
+static void ym_putc(uint64_t *stack, uint8_t c);
+static void ym_purge(uint64_t *stack);
+static void ym_cancel(uint64_t *stack);
+static int ym_receivePacket(uint64_t *stack, uint8_t *data, int *length, uint8_t *seq, int timeout);
+static int ym_sendPacket(uint64_t *stack, uint8_t *frame, uint8_t seq, int length);
+static int ym_waitStart(uint64_t *stack);
+static int ym_sendEOT(uint64_t *stack);
 
 // Global Variables
 // ****************
@@ -69,6 +110,7 @@
 const char FS_Version[] = "  * FatFs - Generic FAT file system module  R0.12c (C) 2017 ChaN\n";
 
 FATFS FatFs;	/* Work area (filesystem object) for logical drive */
+FATFS FatFsFlash;	/* Work area (filesystem object) for the internal flash drive */
 FILINFO fno;	/* File information */
 DIR dj;			/* Directory object */
 
@@ -97,6 +139,12 @@ extern RTC_HandleTypeDef hrtc;
 // Private Variables
 // *****************
 
+// >file output sink
+static FIL sink_fil;
+static uint8_t *sink_buffer = NULL;
+static int sink_count;
+static FRESULT sink_result;		// first write error
+
 
 // Public Functions
 // ****************
@@ -113,8 +161,10 @@ void FS_init(void) {
 		Error_Handler();
 	}
 
-	/* Gives a work area to the default drive */
-	f_mount(&FatFs, "", 0);
+	/* Gives a work area to the default drive (SD card) */
+	f_mount(&FatFs, FS_SD_DRIVE, 0);
+	/* and to the internal flash drive */
+	f_mount(&FatFsFlash, FS_FLASH_DRIVE, 0);
 }
 
 
@@ -216,6 +266,108 @@ uint64_t FS_coredump(uint64_t forth_stack, uint8_t *str, int count) {
 }
 
 
+/**
+ *  @brief
+ *      Opens a file as output sink (>file).
+ *
+ *      The characters are collected in a RAM buffer and written in sector
+ *      sized chunks, there is no FatFs call per character.
+ *  @param[in]
+ *      str   filename (w/ or w/o null termination)
+ *  @param[in]
+ *      count string length
+ *  @return
+ *      FR_OK or FatFs error code
+ */
+FRESULT FS_sinkOpen(uint8_t *str, int count) {
+	FRESULT fr;     /* FatFs return code */
+
+	if (sink_buffer != NULL) {
+		// only one sink
+		return FR_LOCKED;
+	}
+
+	sink_buffer = (uint8_t *) pvPortMalloc(SINK_SIZE);
+	if (sink_buffer == NULL) {
+		return FR_NOT_ENOUGH_CORE;
+	}
+
+	memcpy(path, str, count);
+	path[count] = 0;
+
+	fr = f_open(&sink_fil, path, FA_CREATE_ALWAYS | FA_WRITE);
+	if (fr != FR_OK) {
+		vPortFree(sink_buffer);
+		sink_buffer = NULL;
+		return fr;
+	}
+	sink_count = 0;
+	sink_result = FR_OK;
+	return FR_OK;
+}
+
+
+/**
+ *  @brief
+ *      Puts a character into the output sink (hook-emit for >file).
+ *
+ *      After a write error (e.g. disk full) the characters are discarded,
+ *      FS_sinkClose() returns the error.
+ *  @param[in]
+ *      c   character
+ *  @return
+ *      None
+ */
+void FS_sinkEmit(char c) {
+	FRESULT fr;
+	UINT bytes_written;
+
+	if (sink_buffer == NULL || sink_result != FR_OK) {
+		return;
+	}
+	sink_buffer[sink_count++] = c;
+	if (sink_count >= SINK_SIZE) {
+		fr = f_write(&sink_fil, sink_buffer, SINK_SIZE, &bytes_written);
+		if (fr == FR_OK && bytes_written < SINK_SIZE) {
+			// disk full
+			fr = FR_DENIED;
+		}
+		sink_result = fr;
+		sink_count = 0;
+	}
+}
+
+
+/**
+ *  @brief
+ *      Flushes and closes the output sink (file>).
+ *  @return
+ *      FR_OK or FatFs error code
+ */
+FRESULT FS_sinkClose(void) {
+	FRESULT fr = FR_OK;     /* FatFs return code */
+	UINT bytes_written;
+
+	if (sink_buffer == NULL) {
+		return FR_OK;
+	}
+	fr = sink_result;
+	if (fr == FR_OK && sink_count > 0) {
+		fr = f_write(&sink_fil, sink_buffer, sink_count, &bytes_written);
+		if (fr == FR_OK && (int) bytes_written < sink_count) {
+			// disk full
+			fr = FR_DENIED;
+		}
+	}
+	if (f_close(&sink_fil) != FR_OK) {
+		fr = FR_DISK_ERR;
+	}
+	vPortFree(sink_buffer);
+	sink_buffer = NULL;
+	return fr;
+}
+
+
 /**
  *  @brief
  *      Concatenate files and print on the standard output
@@ -238,6 +390,8 @@ uint64_t FS_cat(uint64_t forth_stack) {
 	FIL fil_out;	/* File object */
 	FRESULT fr;		/* FatFs return code */
 	BYTE mode;
+	UINT rd_count;
+	UINT wr_count;
 
 	uint64_t stack;
 	stack = forth_stack;
@@ -295,6 +449,17 @@ uint64_t FS_cat(uint64_t forth_stack) {
 				stack = FS_type(stack, (uint8_t*)line, strlen(line));
 				strcpy(line, ": file not found");
 				stack = FS_type(stack, (uint8_t*)line, strlen(line));
+			} else if (! n_flag) {
+				/* Copy the file in blocks, no line processing needed */
+				while (f_read(&fil_in, line, sizeof(line), &rd_count) == FR_OK && rd_count > 0) {
+					if (outfile_flag) {
+						f_write(&fil_out, line, rd_count, &wr_count);
+					} else {
+						stack = FS_type(stack, (uint8_t*)line, rd_count);
+					}
+				}
+				/* Close the file */
+				f_close(&fil_in);
 			} else {
 				/* Read every line and type it */
 				while (f_gets(line, sizeof(line), &fil_in)) {
@@ -437,9 +602,9 @@ uint64_t FS_ls(uint64_t forth_stack) {
 				attrib[3] = 'a';
 			}
 
-			snprintf(line, sizeof(line), "%s %9u %4u-%02u-%02uT%02u:%02u:%02u %s\n",
+			snprintf(line, sizeof(line), "%s %10s %4u-%02u-%02uT%02u:%02u:%02u %s\n",
 					attrib,
-					(unsigned int)fno.fsize,
+					size2str(fno.fsize),
 					(fno.fdate >> 9) + 1980,  (fno.fdate >> 5) & 0xF,  fno.fdate & 0x1F,
 					(fno.ftime >> 11) & 0x1F, (fno.ftime >> 5) & 0x2F, (fno.ftime & 0x1F)*2,
 					fno.fname);
@@ -871,6 +1036,9 @@ uint64_t FS_cp(uint64_t forth_stack) {
 		if (fr == FR_OK) {
 			fr = f_open(&fil_dest, line, FA_CREATE_ALWAYS | FA_WRITE);
 			if (fr == FR_OK) {
+				// prefer a contiguous cluster area (no FAT chain on exFAT),
+				// falls back to the normal allocation if the volume is fragmented
+				f_expand(&fil_dest, f_size(&fil_src), 0);
 				// copy the file
 				while (!f_eof(&fil_src)) {
 					fr = f_read(&fil_src, &BLOCK_Buffers[0].Data, BLOCK_BUFFER_SIZE, &rd_count);
@@ -1108,14 +1276,50 @@ uint64_t FS_df(uint64_t forth_stack) {
 	FRESULT fr;     /* FatFs return code */
 	FATFS *fatfs;
 	DWORD nclst;
+	const char *fs_type;
+
+	uint8_t *str = NULL;
+	int count = 1;
 
 	uint64_t stack;
 	stack = forth_stack;
 
+	// optional drive e.g. 1:
+	line[0] = 0;
+	stack = FS_token(stack, &str, &count);
+	if (count > 0) {
+		memcpy(line, str, count);
+		line[count] = 0;
+	}
+
 	stack = FS_cr(stack);
-	fr = f_getfree("", &nclst, &fatfs);  /* Get current directory path */
+	fr = f_getfree(line, &nclst, &fatfs);  /* Get free clusters */
 	if (fr == FR_OK) {
-		snprintf(line, sizeof(line), "%lu KiB (%lu SD-Blocks)", nclst/2, nclst);
+		switch (fatfs->fs_type) {
+		case FS_FAT12:
+			fs_type = "FAT12";
+			break;
+		case FS_FAT16:
+			fs_type = "FAT16";
+			break;
+		case FS_FAT32:
+			fs_type = "FAT32";
+			break;
+#if _FS_EXFAT
+		case FS_EXFAT:
+			fs_type = "exFAT";
+			break;
+#endif
+		default:
+			fs_type = "FAT";
+			break;
+		}
+		// cluster size in 512 byte sectors (_MAX_SS == 512)
+		snprintf(line, sizeof(line), "%s: %lu KiB free of %lu KiB (%u bytes per cluster)",
+				fs_type,
+				(nclst * fatfs->csize) / 2,
+				((fatfs->n_fatent - 2) * fatfs->csize) / 2,
+				fatfs->csize * 512U);
 		stack = FS_type(stack, (uint8_t*)line, strlen(line));
 	} else {
 		strcpy(line, "Err: no volume");
@@ -1126,6 +1330,51 @@ uint64_t FS_df(uint64_t forth_stack) {
 }
 
 
+/**
+ *  @brief
+ *      Creates a FAT volume on the drive e.g. mkfs 1:
+ *
+ *      The internal flash drive gets a FAT volume without partition table.
+ *  @param[in]
+ *      forth_stack   TOS (lower word) and SPS (higher word)
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+uint64_t FS_mkfs(uint64_t forth_stack) {
+	FRESULT fr;     /* FatFs return code */
+	uint8_t *str = NULL;
+	int count = 1;
+	BYTE opt = FM_ANY;
+
+	uint64_t stack;
+	stack = forth_stack;
+
+	stack = FS_token(stack, &str, &count);
+	stack = FS_cr(stack);
+	if (count == 0) {
+		strcpy(line, "Wrong number of parameters");
+		stack = FS_type(stack, (uint8_t*)line, strlen(line));
+		return stack;
+	}
+	memcpy(path, str, count);
+	path[count] = 0;
+
+	if (! strcmp(path, FS_FLASH_DRIVE)) {
+		// small drive, no partition table
+		opt = FM_FAT | FM_SFD;
+	}
+
+	fr = f_mkfs(path, opt, 0, &BLOCK_Buffers[0].Data, BLOCK_BUFFER_SIZE);
+	if (fr != FR_OK) {
+		stack = FS_type(stack, (uint8_t*)path, strlen(path));
+		strcpy(line, ": can't create file system");
+		stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	}
+
+	return stack;
+}
+
+
 /**
  *  @brief
  *      Print or set time and time
@@ -1201,11 +1450,12 @@ uint64_t FS_mount(uint64_t forth_stack) {
 
 	SD_getSize();
 	stack = FS_cr(stack);
-	fr = f_mount(&FatFs, "", 0);
+	fr = f_mount(&FatFs, FS_SD_DRIVE, 0);
 	if (fr != FR_OK) {
 		strcpy(line, "Can't mount default drive");
 		stack = FS_type(stack, (uint8_t*)line, strlen(line));
 	}
+	f_mount(&FatFsFlash, FS_FLASH_DRIVE, 0);
 
 	return stack;
 }
@@ -1226,7 +1476,7 @@ uint64_t FS_umount(uint64_t forth_stack) {
 	stack = forth_stack;
 
 	stack = FS_cr(stack);
-	fr = f_mount(0, "", 0);
+	fr = f_mount(0, FS_SD_DRIVE, 0);
 	if (fr != FR_OK) {
 		strcpy(line, "Can't unmount default drive");
 		stack = FS_type(stack, (uint8_t*)line, strlen(line));
@@ -1236,6 +1486,344 @@ uint64_t FS_umount(uint64_t forth_stack) {
 }
 
 
+/**
+ *  @brief
+ *      Receives files with the YMODEM protocol (batch, 1K blocks, CRC16).
+ *
+ *      Compatible with "sb" (lrzsz) and the YMODEM send of the common
+ *      terminal programs. The data is buffered and written with f_write()
+ *      in YM_BUFFER_SIZE chunks. The files are stored in the current
+ *      directory, a path in the file name is ignored. The file of an
+ *      aborted transfer is removed.
+ *  @param[in]
+ *      forth_stack   TOS (lower word) and SPS (higher word)
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+uint64_t FS_rz(uint64_t forth_stack) {
+	FIL fil;		/* File object */
+	FRESULT fr;		/* FatFs return code */
+	UINT wr_count;
+	uint8_t *packet;
+	uint8_t *buffer;
+	char *name;
+	int result;
+	int length;
+	uint8_t seq;
+	uint8_t expected;
+	int errors;
+	int eot;
+	int count;
+	int n;
+	long remaining;
+	int files = 0;
+	int abort = FALSE;
+	int removed = FALSE;
+
+	uint64_t stack;
+	stack = forth_stack;
+
+	packet = (uint8_t *) pvPortMalloc(YM_PACKET_1K);
+	buffer = (uint8_t *) pvPortMalloc(YM_BUFFER_SIZE);
+	if (packet == NULL || buffer == NULL) {
+		vPortFree(packet);
+		vPortFree(buffer);
+		stack = FS_cr(stack);
+		strcpy(line, "not enough memory");
+		stack = FS_type(stack, (uint8_t*)line, strlen(line));
+		return stack;
+	}
+
+	while (! abort) {
+		// header block (block 0) with file name and size
+		errors = 0;
+		for (;;) {
+			ym_putc(&stack, YM_CRC);
+			result = ym_receivePacket(&stack, packet, &length, &seq, YM_START_TIMEOUT);
+			if (result == YM_OK && seq == 0) {
+				break;
+			}
+			if (result == YM_CANCEL || ++errors > YM_START_RETRIES) {
+				abort = TRUE;
+				break;
+			}
+		}
+		if (abort) {
+			break;
+		}
+		if (packet[0] == 0) {
+			// empty file name, end of the batch
+			ym_putc(&stack, YM_ACK);
+			break;
+		}
+
+		name = strrchr((char*)packet, '/');
+		if (name == NULL) {
+			name = (char*)packet;
+		} else {
+			name++;
+		}
+		strncpy(path, name, sizeof(path)-1);
+		path[sizeof(path)-1] = 0;
+		remaining = -1;
+		name = (char*)packet + strlen((char*)packet) + 1;
+		if (*name != 0) {
+			remaining = strtol(name, NULL, 10);
+		}
+
+		fr = f_open(&fil, path, FA_CREATE_ALWAYS | FA_WRITE);
+		if (fr != FR_OK) {
+			ym_cancel(&stack);
+			abort = TRUE;
+			break;
+		}
+		ym_putc(&stack, YM_ACK);
+		ym_putc(&stack, YM_CRC);
+
+		// data blocks
+		expected = 1;
+		errors = 0;
+		eot = 0;
+		count = 0;
+		while (! abort) {
+			result = ym_receivePacket(&stack, packet, &length, &seq, YM_PACKET_TIMEOUT);
+			if (result == YM_OK) {
+				if (seq == expected) {
+					if (remaining >= 0 && length > remaining) {
+						// strip the padding of the last block
+						length = remaining;
+					}
+					n = 0;
+					while (n < length) {
+						if (length - n < YM_BUFFER_SIZE - count) {
+							memcpy(&buffer[count], &packet[n], length - n);
+							count += length - n;
+							n = length;
+						} else {
+							memcpy(&buffer[count], &packet[n], YM_BUFFER_SIZE - count);
+							n += YM_BUFFER_SIZE - count;
+							fr = f_write(&fil, buffer, YM_BUFFER_SIZE, &wr_count);
+							count = 0;
+							if (fr != FR_OK || wr_count != YM_BUFFER_SIZE) {
+								ym_cancel(&stack);
+								abort = TRUE;
+								break;
+							}
+						}
+					}
+					if (abort) {
+						break;
+					}
+					if (remaining >= 0) {
+						remaining -= length;
+					}
+					expected++;
+					errors = 0;
+					ym_putc(&stack, YM_ACK);
+				} else if (seq == (uint8_t)(expected - 1)) {
+					// ACK lost, repeated block
+					ym_putc(&stack, YM_ACK);
+				} else {
+					// out of sequence, unrecoverable
+					ym_cancel(&stack);
+					abort = TRUE;
+				}
+			} else if (result == YM_EOT_RECEIVED) {
+				if (eot++ == 0) {
+					// the first EOT could be a line error
+					ym_putc(&stack, YM_NAK);
+				} else {
+					// the rest of the buffer, the file is complete before the ACK
+					fr = FR_OK;
+					if (count > 0) {
+						fr = f_write(&fil, buffer, count, &wr_count);
+						if (fr == FR_OK && wr_count != (UINT) count) {
+							fr = FR_DENIED;		// volume full
+						}
+						count = 0;
+					}
+					if (fr == FR_OK) {
+						fr = f_sync(&fil);
+					}
+					if (fr != FR_OK) {
+						ym_cancel(&stack);
+						abort = TRUE;
+						break;
+					}
+					ym_putc(&stack, YM_ACK);
+					break;
+				}
+			} else if (result == YM_CANCEL) {
+				abort = TRUE;
+			} else if (++errors > YM_RETRIES) {
+				// tell the sender, it would retry forever
+				ym_cancel(&stack);
+				abort = TRUE;
+			} else {
+				ym_putc(&stack, YM_NAK);
+			}
+		}
+
+		f_close(&fil);
+		if (abort) {
+			// don't leave a truncated file
+			removed = (f_unlink(path) == FR_OK);
+		} else {
+			files++;
+		}
+	}
+
+	vPortFree(packet);
+	vPortFree(buffer);
+
+	stack = FS_cr(stack);
+	snprintf(line, sizeof(line), "%i file(s) received", files);
+	stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	if (abort) {
+		strcpy(line, ", transfer aborted");
+		stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	}
+	if (removed) {
+		snprintf(line, sizeof(line), ", %s removed", path);
+		stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	}
+
+	return stack;
+}
+
+
+/**
+ *  @brief
+ *      Sends files with the YMODEM protocol (batch, 1K blocks, CRC16).
+ *
+ *      Compatible with "rb" (lrzsz) and the YMODEM receive of the common
+ *      terminal programs.
+ *      The file names are taken from the command line (Forth tokens)
+ *  @param[in]
+ *      forth_stack   TOS (lower word) and SPS (higher word)
+ *  @return
+ *      TOS (lower word) and SPS (higher word)
+ */
+uint64_t FS_sz(uint64_t forth_stack) {
+	FIL fil;		/* File object */
+	FRESULT fr;		/* FatFs return code */
+	UINT rd_count;
+	uint8_t *frame;
+	uint8_t *str = NULL;
+	int count = 1;
+	uint8_t seq;
+	char *name;
+	int files = 0;
+	int abort = FALSE;
+
+	uint64_t stack;
+	stack = forth_stack;
+
+	frame = (uint8_t *) pvPortMalloc(YM_PACKET_1K + YM_FRAME_OVERHEAD);
+	if (frame == NULL) {
+		stack = FS_cr(stack);
+		strcpy(line, "not enough memory");
+		stack = FS_type(stack, (uint8_t*)line, strlen(line));
+		return stack;
+	}
+
+	while (! abort) {
+		// get tokens till end of line
+		stack = FS_token(stack, &str, &count);
+		if (count == 0) {
+			break;
+		}
+		memcpy(path, str, count);
+		path[count] = 0;
+
+		fr = f_open(&fil, path, FA_READ);
+		if (fr != FR_OK) {
+			ym_cancel(&stack);
+			stack = FS_cr(stack);
+			stack = FS_type(stack, (uint8_t*)path, strlen(path));
+			strcpy(line, ": file not found");
+			stack = FS_type(stack, (uint8_t*)line, strlen(line));
+			vPortFree(frame);
+			return stack;
+		}
+
+		// header block (block 0) with file name and size
+		name = strrchr(path, '/');
+		if (name == NULL) {
+			name = path;
+		} else {
+			name++;
+		}
+		count = strlen(name);
+		if (count > YM_PACKET_128 - 24) {
+			// room for the size
+			count = YM_PACKET_128 - 24;
+		}
+		memset(&frame[YM_FRAME_HEADER], 0, YM_PACKET_128);
+		memcpy(&frame[YM_FRAME_HEADER], name, count);
+		strcpy((char*)&frame[YM_FRAME_HEADER + count + 1], size2str(f_size(&fil)));
+		if (ym_waitStart(&stack) != YM_OK ||
+				ym_sendPacket(&stack, frame, 0, YM_PACKET_128) != YM_OK ||
+				ym_waitStart(&stack) != YM_OK) {
+			abort = TRUE;
+		}
+
+		// data blocks
+		seq = 1;
+		while (! abort) {
+			fr = f_read(&fil, &frame[YM_FRAME_HEADER], YM_PACKET_1K, &rd_count);
+			if (fr != FR_OK) {
+				ym_cancel(&stack);
+				abort = TRUE;
+				break;
+			}
+			if (rd_count == 0) {
+				break;
+			}
+			if (rd_count <= YM_PACKET_128) {
+				// short block for the last bytes
+				memset(&frame[YM_FRAME_HEADER + rd_count], YM_PAD, YM_PACKET_128 - rd_count);
+				count = YM_PACKET_128;
+			} else {
+				memset(&frame[YM_FRAME_HEADER + rd_count], YM_PAD, YM_PACKET_1K - rd_count);
+				count = YM_PACKET_1K;
+			}
+			if (ym_sendPacket(&stack, frame, seq++, count) != YM_OK) {
+				abort = TRUE;
+			}
+		}
+		f_close(&fil);
+
+		if (! abort) {
+			if (ym_sendEOT(&stack) == YM_OK) {
+				files++;
+			} else {
+				abort = TRUE;
+			}
+		}
+	}
+
+	if (! abort) {
+		// empty header block, end of the batch
+		memset(&frame[YM_FRAME_HEADER], 0, YM_PACKET_128);
+		if (ym_waitStart(&stack) == YM_OK) {
+			ym_sendPacket(&stack, frame, 0, YM_PACKET_128);
+		}
+	}
+	vPortFree(frame);
+
+	stack = FS_cr(stack);
+	snprintf(line, sizeof(line), "%i file(s) sent", files);
+	stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	if (abort) {
+		strcpy(line, ", transfer aborted");
+		stack = FS_type(stack, (uint8_t*)line, strlen(line));
+	}
+
+	return stack;
+}
+
+
 int FS_FIL_size(void) {
 	return(sizeof(FIL));
 }
@@ -1292,7 +1880,300 @@ int FS_f_error(FIL* fp) {
 	return f_error(fp);
 }
 
+// FSIZE_t is 64 bit wide with exFAT, the Forth words use single cells (32 bit)
+
+FRESULT FS_f_lseek(FIL* fp, DWORD ofs) {
+	return f_lseek(fp, ofs);
+}
+
+FRESULT FS_f_expand(FIL* fp, DWORD fsz, BYTE opt) {
+	return f_expand(fp, fsz, opt);
+}
+
 
 // Private Functions
 // *****************
 
+/**
+ *  @brief
+ *      Converts a file size to a decimal string.
+ *
+ *      newlib nano printf does not support long long (%llu), exFAT files
+ *      can be larger than 4 GiB.
+ *  @param[in]
+ *      size   file size in bytes
+ *  @return
+ *      pointer to a static string
+ */
+static const char *size2str(FSIZE_t size) {
+	static char str[24];
+
+	if (size < 1000000000UL) {
+		snprintf(str, sizeof(str), "%lu", (unsigned long) size);
+	} else {
+		snprintf(str, sizeof(str), "%lu%09lu",
+				(unsigned long) (size / 1000000000UL),
+				(unsigned long) (size % 1000000000UL));
+	}
+	return str;
+}
+
+
+/**
+ *  @brief
+ *      Calculates the CRC16 (XMODEM, polynomial 0x1021, init 0).
+ *  @param[in]
+ *      buffer  data
+ *  @param[in]
+ *      length  number of bytes
+ *  @return
+ *      CRC16
+ */
+static uint16_t ym_crc16(const uint8_t *buffer, int length) {
+	uint16_t crc = 0;
+	int i;
+
+	while (length--) {
+		crc ^= (uint16_t) *buffer++ << 8;
+		for (i=0; i<8; i++) {
+			if (crc & 0x8000) {
+				crc = (crc << 1) ^ 0x1021;
+			} else {
+				crc <<= 1;
+			}
+		}
+	}
+	return crc;
+}
+
+
+/**
+ *  @brief
+ *      Reads a byte from the terminal (key) with timeout.
+ *  @param[in,out]
+ *      stack   TOS (lower word) and SPS (higher word)
+ *  @param[in]
+ *      timeout in ms
+ *  @return
+ *      byte or -1 on timeout
+ */
+static int ym_getc(uint64_t *stack, int timeout) {
+	int c = 0;
+
+	for (;;) {
+		*stack = TERMINAL_qkey(*stack, (char*)&c);
+		if (c) {
+			*stack = TERMINAL_key(*stack, (char*)&c);
+			return c & 0xff;
+		}
+		if (timeout-- <= 0) {
+			return -1;
+		}
+		osDelay(1);
+	}
+}
+
+
+/**
+ *  @brief
+ *      Writes a byte to the terminal.
+ *  @param[in,out]
+ *      stack   TOS (lower word) and SPS (higher word)
+ *  @param[in]
+ *      c       byte
+ *  @return
+ *      None
+ */
+static void ym_putc(uint64_t *stack, uint8_t c) {
+	*stack = FS_type(*stack, &c, 1);
+}
+
+
+/**
+ *  @brief
+ *      Discards the input till the line is silent (after an error).
+ *  @param[in,out]
+ *      stack   TOS (lower word) and SPS (higher word)
+ *  @return
+ *      None
+ */
+static void ym_purge(uint64_t *stack) {
+	while (ym_getc(stack, YM_CHAR_TIMEOUT) >= 0) {
+		;
+	}
+}
+
+
+/**
+ *  @brief
+ *      Cancels the transfer (CAN CAN).
+ *  @param[in,out]
+ *      stack   TOS (lower word) and SPS (higher word)
+ *  @return
+ *      None
+ */
+static void ym_cancel(uint64_t *stack) {
+	static const uint8_t cancel[] = { YM_CAN, YM_CAN, YM_CAN };
+
+	*stack = FS_type(*stack, (uint8_t*)cancel, sizeof(cancel));
+}
+
+
+/**
+ *  @brief
+ *      Receives a YMODEM packet.
+ *  @param[in,out]
+ *      stack   TOS (lower word) and SPS (higher word)
+ *  @param[out]
+ *      data    data buffer (YM_PACKET_1K bytes)
+ *  @param[out]
+ *      length  data length (128 or 1024)
+ *  @param[out]
+ *      seq     block number
+ *  @param[in]
+ *      timeout for the start of the packet in ms
+ *  @return
+ *      YM_OK, YM_EOT_RECEIVED, YM_CANCEL, YM_TIMEOUT or YM_ERROR
+ */
+static int ym_receivePacket(uint64_t *stack, uint8_t *data, int *length, uint8_t *seq, int timeout) {
+	int c;
+	int i;
+	int seq1, seq2;
+	uint16_t crc;
+
+	c = ym_getc(stack, timeout);
+	switch (c) {
+	case YM_SOH:
+		*length = YM_PACKET_128;
+		break;
+	case YM_STX:
+		*length = YM_PACKET_1K;
+		break;
+	case YM_EOT:
+		return YM_EOT_RECEIVED;
+	case YM_CAN:
+		if (ym_getc(stack, YM_CHAR_TIMEOUT) == YM_CAN) {
+			return YM_CANCEL;
+		}
+		return YM_ERROR;
+	case -1:
+		return YM_TIMEOUT;
+	default:
+		ym_purge(stack);
+		return YM_ERROR;
+	}
+
+	seq1 = ym_getc(stack, YM_CHAR_TIMEOUT);
+	seq2 = ym_getc(stack, YM_CHAR_TIMEOUT);
+	if (seq1 < 0 || seq2 < 0) {
+		return YM_TIMEOUT;
+	}
+	for (i=0; i<*length; i++) {
+		c = ym_getc(stack, YM_CHAR_TIMEOUT);
+		if (c < 0) {
+			return YM_TIMEOUT;
+		}
+		data[i] = c;
+	}
+	c = ym_getc(stack, YM_CHAR_TIMEOUT);
+	i = ym_getc(stack, YM_CHAR_TIMEOUT);
+	if (c < 0 || i < 0) {
+		return YM_TIMEOUT;
+	}
+	crc = (c << 8) | i;
+
+	if ((seq1 ^ seq2) != 0xff || crc != ym_crc16(data, *length)) {
+		ym_purge(stack);
+		return YM_ERROR;
+	}
+	*seq = seq1;
+	return YM_OK;
+}
+
+
+/**
+ *  @brief
+ *      Sends a YMODEM packet and waits for the ACK.
+ *  @param[in,out]
+ *      stack   TOS (lower word) and SPS (higher word)
+ *  @param[in,out]
+ *      frame   data starts at YM_FRAME_HEADER, header and CRC are filled in
+ *  @param[in]
+ *      seq     block number
+ *  @param[in]
+ *      length  data length (128 or 1024)
+ *  @return
+ *      YM_OK, YM_CANCEL or YM_ERROR (too many retries)
+ */
+static int ym_sendPacket(uint64_t *stack, uint8_t *frame, uint8_t seq, int length) {
+	uint16_t crc;
+	int retries;
+	int c;
+
+	frame[0] = (length == YM_PACKET_1K) ? YM_STX : YM_SOH;
+	frame[1] = seq;
+	frame[2] = ~seq;
+	crc = ym_crc16(&frame[YM_FRAME_HEADER], length);
+	frame[YM_FRAME_HEADER + length] = crc >> 8;
+	frame[YM_FRAME_HEADER + length + 1] = crc & 0xff;
+
+	for (retries=0; retries<YM_RETRIES; retries++) {
+		*stack = FS_type(*stack, frame, length + YM_FRAME_OVERHEAD);
+		c = ym_getc(stack, YM_PACKET_TIMEOUT);
+		if (c == YM_ACK) {
+			return YM_OK;
+		}
+		if (c == YM_CAN && ym_getc(stack, YM_CHAR_TIMEOUT) == YM_CAN) {
+			return YM_CANCEL;
+		}
+	}
+	ym_cancel(stack);
+	return YM_ERROR;
+}
+
+
+/**
+ *  @brief
+ *      Waits for the receiver to request a transfer ('C' for CRC16).
+ *  @param[in,out]
+ *      stack   TOS (lower word) and SPS (higher word)
+ *  @return
+ *      YM_OK, YM_CANCEL or YM_TIMEOUT
+ */
+static int ym_waitStart(uint64_t *stack) {
+	int retries;
+	int c;
+
+	for (retries=0; retries<YM_START_RETRIES; retries++) {
+		c = ym_getc(stack, YM_START_TIMEOUT);
+		if (c == YM_CRC) {
+			return YM_OK;
+		}
+		if (c == YM_CAN && ym_getc(stack, YM_CHAR_TIMEOUT) == YM_CAN) {
+			return YM_CANCEL;
+		}
+	}
+	ym_cancel(stack);
+	return YM_TIMEOUT;
+}
+
+
+/**
+ *  @brief
+ *      Sends the end of file (EOT) and waits for the ACK.
+ *  @param[in,out]
+ *      stack   TOS (lower word) and SPS (higher word)
+ *  @return
+ *      YM_OK or YM_ERROR
+ */
+static int ym_sendEOT(uint64_t *stack) {
+	int retries;
+
+	for (retries=0; retries<YM_RETRIES; retries++) {
+		ym_putc(stack, YM_EOT);
+		if (ym_getc(stack, YM_PACKET_TIMEOUT) == YM_ACK) {
+			return YM_OK;
+		}
+	}
+	return YM_ERROR;
+}
@@ -0,0 +1,616 @@
+/**
+ *  @brief
+ *      Persistent key-value store in the internal flash.
+ *
+ *      Log-structured: every store or delete appends a record to the active
+ *      flash page, nothing is overwritten. A RAM hash index (key -> record)
+ *      is rebuilt from the log at the first access, lookups do not search
+ *      the flash. If the active page is full, the live records are copied
+ *      to the spare page (compaction) and the old page is erased.
+ *
+ *      Page layout:
+ *        page header    magic, generation (8 bytes, written last)
+ *        records        8 byte aligned (ECC programming granularity)
+ *
+ *      Record layout:
+ *        magic, key length, type      4 bytes
+ *        value length, CRC16          4 bytes
+ *        key, value                   padded to 8 bytes
+ *  @file
+ *      kv.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+#include <string.h>
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "kv.h"
+#include "flash.h"
+
+
+// Defines
+// *******
+#define KV_PAGE_MAGIC		0x4B565354	// "KVST"
+#define KV_RECORD_MAGIC		0x4B56		// "KV"
+#define KV_ERASED			0xFFFFFFFF
+
+#define KV_TYPE_VALUE		0x01
+#define KV_TYPE_DELETED		0x02
+
+#define KV_EMPTY			0x0000		// index entry never used
+#define KV_TOMBSTONE		0x0001		// index entry deleted
+
+#define PAGE_ADDRESS(page)	(KV_START_ADDRESS + (page) * KV_PAGE_SIZE)
+#define ALIGN8(n)			(((n) + 7) & ~7)
+
+// Private typedefs
+// ****************
+typedef struct {
+	uint16_t magic;
+	uint8_t  key_len;
+	uint8_t  type;
+	uint16_t value_len;
+	uint16_t crc;
+} kv_record_t;
+
+typedef struct {
+	uint16_t hash;
+	uint16_t offset;	// record offset in the active page, KV_EMPTY, KV_TOMBSTONE
+} kv_index_t;
+
+
+// Private function prototypes
+// ***************************
+static int mount(void);
+static int format(int page, uint32_t generation);
+static int compact(void);
+static int append(uint8_t type, const char *key, int key_len, const void *value, int value_len);
+static int program(uint32_t address, const uint8_t *data, int len);
+static int lookup(const char *key, int key_len, uint16_t hash);
+static void index_update(const char *key, int key_len, uint8_t type, uint16_t offset);
+static uint16_t hash_key(const char *key, int key_len);
+static uint16_t crc16(uint16_t crc, const uint8_t *data, int len);
+static uint16_t record_crc(const kv_record_t *record, const char *key, const void *value);
+
+
+// Global Variables
+// ****************
+
+// RTOS resources
+// **************
+
+static osMutexId_t KV_MutexID;
+static const osMutexAttr_t KV_MutexAttr = {
+		NULL,				// no name required
+		osMutexPrioInherit,	// attr_bits
+		NULL,				// memory for control block
+		0U					// size for control block
+};
+
+
+// Private Variables
+// *****************
+
+static kv_index_t kv_index[KV_INDEX_SIZE];
+static int index_used;			// entries incl. tombstones
+static int index_live;			// entries without tombstones
+
+static int active_page = -1;
+static uint32_t generation;
+static uint32_t write_offset;
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Initializes the key-value store.
+ *
+ *      The flash is scanned at the first access (RTOS must run).
+ *  @return
+ *      None
+ */
+void KV_init(void) {
+	KV_MutexID = osMutexNew(&KV_MutexAttr);
+	if (KV_MutexID == NULL) {
+		Error_Handler();
+	}
+}
+
+
+/**
+ *  @brief
+ *      Stores a value.
+ *  @param[in]
+ *      key, key_len      key (not null terminated)
+ *  @param[in]
+ *      value, value_len  value
+ *  @return
+ *      KV_OK or KV_ERROR
+ */
+int KV_put(const char *key, int key_len, const void *value, int value_len) {
+	int return_value;
+
+	if (key_len <= 0 || key_len > KV_MAX_KEY || value_len < 0 || value_len > KV_MAX_VALUE) {
+		return KV_ERROR;
+	}
+
+	// only one thread is allowed to use the store
+	osMutexAcquire(KV_MutexID, osWaitForever);
+	return_value = mount();
+	if (return_value == KV_OK) {
+		return_value = append(KV_TYPE_VALUE, key, key_len, value, value_len);
+	}
+	osMutexRelease(KV_MutexID);
+	return return_value;
+}
+
+
+/**
+ *  @brief
+ *      Gets a value.
+ *  @param[in]
+ *      key, key_len  key (not null terminated)
+ *  @param[out]
+ *      value         buffer
+ *  @param[in]
+ *      max_len       buffer size
+ *  @return
+ *      value length or -1 if the key is not found
+ */
+int KV_get(const char *key, int key_len, void *value, int max_len) {
+	int i;
+	int len = -1;
+	kv_record_t *record;
+
+	// only one thread is allowed to use the store
+	osMutexAcquire(KV_MutexID, osWaitForever);
+	if (mount() == KV_OK) {
+		i = lookup(key, key_len, hash_key(key, key_len));
+		if (i >= 0) {
+			record = (kv_record_t *) (PAGE_ADDRESS(active_page) + kv_index[i].offset);
+			len = record->value_len;
+			memcpy(value, (uint8_t *) record + sizeof(kv_record_t) + record->key_len,
+					len < max_len ? len : max_len);
+		}
+	}
+	osMutexRelease(KV_MutexID);
+	return len;
+}
+
+
+/**
+ *  @brief
+ *      Deletes a key.
+ *  @param[in]
+ *      key, key_len  key (not null terminated)
+ *  @return
+ *      KV_OK, KV_NOT_FOUND or KV_ERROR
+ */
+int KV_delete(const char *key, int key_len) {
+	int return_value;
+
+	// only one thread is allowed to use the store
+	osMutexAcquire(KV_MutexID, osWaitForever);
+	return_value = mount();
+	if (return_value == KV_OK) {
+		if (lookup(key, key_len, hash_key(key, key_len)) < 0) {
+			return_value = KV_NOT_FOUND;
+		} else {
+			return_value = append(KV_TYPE_DELETED, key, key_len, NULL, 0);
+		}
+	}
+	osMutexRelease(KV_MutexID);
+	return return_value;
+}
+
+
+/**
+ *  @brief
+ *      Stores a cell (kv!).
+ *  @return
+ *      KV_OK or KV_ERROR
+ */
+int KV_putCell(const char *key, int key_len, int value) {
+	return KV_put(key, key_len, &value, sizeof(value));
+}
+
+
+/**
+ *  @brief
+ *      Gets a cell (kv@).
+ *  @param[out]
+ *      value   0 if the key is not found
+ *  @return
+ *      TRUE (-1) if the key is found, FALSE otherwise
+ */
+int KV_getCell(const char *key, int key_len, int *value) {
+	*value = 0;
+	if (KV_get(key, key_len, value, sizeof(*value)) < 0) {
+		return FALSE;
+	}
+	return -1;
+}
+
+
+// Private Functions
+// *****************
+
+/**
+ *  @brief
+ *      Finds the active page and builds the RAM index.
+ *  @return
+ *      KV_OK or KV_ERROR
+ */
+static int mount(void) {
+	int page;
+	uint32_t *header;
+	kv_record_t *record;
+	const char *key;
+	uint32_t offset;
+
+	if (active_page >= 0) {
+		return KV_OK;
+	}
+
+	// the valid page with the highest generation is the active one
+	for (page=0; page<KV_PAGES; page++) {
+		header = (uint32_t *) PAGE_ADDRESS(page);
+		if (header[0] == KV_PAGE_MAGIC && (active_page < 0 || header[1] > generation)) {
+			active_page = page;
+			generation = header[1];
+		}
+	}
+	if (active_page < 0) {
+		// empty store
+		return format(0, 1);
+	}
+
+	memset(kv_index, 0, sizeof(kv_index));
+	index_used = 0;
+	index_live = 0;
+	offset = 8;
+	while (offset + sizeof(kv_record_t) <= KV_PAGE_SIZE) {
+		record = (kv_record_t *) (PAGE_ADDRESS(active_page) + offset);
+		if (*(uint32_t *) record == KV_ERASED) {
+			// end of the log
+			break;
+		}
+		if (record->magic != KV_RECORD_MAGIC ||
+				offset + sizeof(kv_record_t) + ALIGN8(record->key_len + record->value_len) > KV_PAGE_SIZE) {
+			// broken log, no more appends to this page
+			offset = KV_PAGE_SIZE;
+			break;
+		}
+		key = (char *) record + sizeof(kv_record_t);
+		if (record->crc == record_crc(record, key, key + record->key_len)) {
+			index_update(key, record->key_len, record->type, offset);
+		}
+		offset += sizeof(kv_record_t) + ALIGN8(record->key_len + record->value_len);
+	}
+	write_offset = offset;
+
+	return KV_OK;
+}
+
+
+/**
+ *  @brief
+ *      Erases a page (if needed) and makes it the empty active page.
+ *  @return
+ *      KV_OK or KV_ERROR
+ */
+static int format(int page, uint32_t gen) {
+	uint32_t *p;
+	uint32_t header[2];
+
+	for (p = (uint32_t *) PAGE_ADDRESS(page); p < (uint32_t *) PAGE_ADDRESS(page+1); p++) {
+		if (*p != KV_ERASED) {
+			if (FLASH_erasePage(PAGE_ADDRESS(page)) != HAL_OK) {
+				return KV_ERROR;
+			}
+			break;
+		}
+	}
+	header[0] = KV_PAGE_MAGIC;
+	header[1] = gen;
+	if (program(PAGE_ADDRESS(page), (uint8_t *) header, sizeof(header)) != KV_OK) {
+		return KV_ERROR;
+	}
+	memset(kv_index, 0, sizeof(kv_index));
+	index_used = 0;
+	index_live = 0;
+	active_page = page;
+	generation = gen;
+	write_offset = 8;
+	return KV_OK;
+}
+
+
+/**
+ *  @brief
+ *      Copies the live records to the spare page and erases the old page.
+ *
+ *      The page header of the new page is written after the records, an
+ *      interrupted compaction leaves the old page active.
+ *  @return
+ *      KV_OK or KV_ERROR
+ */
+static int compact(void) {
+	int i;
+	int spare;
+	uint32_t *p;
+	uint32_t offset = 8;
+	uint32_t size;
+	uint32_t header[2];
+	kv_record_t *record;
+
+	spare = (active_page + 1) % KV_PAGES;
+	for (p = (uint32_t *) PAGE_ADDRESS(spare); p < (uint32_t *) PAGE_ADDRESS(spare+1); p++) {
+		if (*p != KV_ERASED) {
+			if (FLASH_erasePage(PAGE_ADDRESS(spare)) != HAL_OK) {
+				return KV_ERROR;
+			}
+			break;
+		}
+	}
+
+	for (i=0; i<KV_INDEX_SIZE; i++) {
+		if (kv_index[i].offset == KV_EMPTY || kv_index[i].offset == KV_TOMBSTONE) {
+			continue;
+		}
+		record = (kv_record_t *) (PAGE_ADDRESS(active_page) + kv_index[i].offset);
+		size = sizeof(kv_record_t) + ALIGN8(record->key_len + record->value_len);
+		if (program(PAGE_ADDRESS(spare) + offset, (uint8_t *) record, size) != KV_OK) {
+			return KV_ERROR;
+		}
+		offset += size;
+	}
+
+	header[0] = KV_PAGE_MAGIC;
+	header[1] = generation + 1;
+	if (program(PAGE_ADDRESS(spare), (uint8_t *) header, sizeof(header)) != KV_OK) {
+		return KV_ERROR;
+	}
+	if (FLASH_erasePage(PAGE_ADDRESS(active_page)) != HAL_OK) {
+		return KV_ERROR;
+	}
+
+	// rebuild the index without tombstones
+	active_page = -1;
+	return mount();
+}
+
+
+/**
+ *  @brief
+ *      Appends a record to the log and updates the index.
+ *
+ *      The record header is programmed first, an interrupted append is
+ *      detected by the CRC.
+ *  @return
+ *      KV_OK or KV_ERROR
+ */
+static int append(uint8_t type, const char *key, int key_len, const void *value, int value_len) {
+	kv_record_t record;
+	uint8_t buffer[ALIGN8(KV_MAX_KEY + KV_MAX_VALUE)];
+	uint32_t size;
+	uint16_t offset;
+
+	if (type == KV_TYPE_VALUE && lookup(key, key_len, hash_key(key, key_len)) < 0) {
+		if (index_live >= KV_INDEX_SIZE - 1) {
+			// index is full
+			return KV_ERROR;
+		}
+		if (index_used >= KV_INDEX_SIZE - 1 && compact() != KV_OK) {
+			// the compaction rebuilds the index without tombstones
+			return KV_ERROR;
+		}
+	}
+
+	size = sizeof(kv_record_t) + ALIGN8(key_len + value_len);
+	if (write_offset + size > KV_PAGE_SIZE) {
+		if (compact() != KV_OK) {
+			return KV_ERROR;
+		}
+		if (write_offset + size > KV_PAGE_SIZE) {
+			// store is full
+			return KV_ERROR;
+		}
+	}
+
+	record.magic = KV_RECORD_MAGIC;
+	record.key_len = key_len;
+	record.type = type;
+	record.value_len = value_len;
+	record.crc = record_crc(&record, key, value);
+
+	memset(buffer, 0xFF, sizeof(buffer));
+	memcpy(buffer, key, key_len);
+	if (value_len > 0) {
+		memcpy(&buffer[key_len], value, value_len);
+	}
+
+	offset = write_offset;
+	if (program(PAGE_ADDRESS(active_page) + offset, (uint8_t *) &record, sizeof(record)) != KV_OK) {
+		return KV_ERROR;
+	}
+	write_offset += size;
+	if (program(PAGE_ADDRESS(active_page) + offset + sizeof(record), buffer,
+			ALIGN8(key_len + value_len)) != KV_OK) {
+		return KV_ERROR;
+	}
+
+	index_update((char *) (PAGE_ADDRESS(active_page) + offset + sizeof(record)),
+			key_len, type, offset);
+	return KV_OK;
+}
+
+
+/**
+ *  @brief
+ *      Programs doublewords into the flash (len multiple of 8).
+ *
+ *      Erased doublewords are skipped.
+ *  @return
+ *      KV_OK or KV_ERROR
+ */
+static int program(uint32_t address, const uint8_t *data, int len) {
+	// one burst, FLASH_programBuffer skips the erased doublewords
+	if (FLASH_programBuffer(address, data, len) != HAL_OK) {
+		return KV_ERROR;
+	}
+	return KV_OK;
+}
+
+
+/**
+ *  @brief
+ *      Looks up a key in the RAM index.
+ *  @return
+ *      index entry or -1 if not found
+ */
+static int lookup(const char *key, int key_len, uint16_t hash) {
+	int i, n;
+	kv_record_t *record;
+
+	i = hash & (KV_INDEX_SIZE - 1);
+	for (n=0; n<KV_INDEX_SIZE; n++) {
+		if (kv_index[i].offset == KV_EMPTY) {
+			break;
+		}
+		if (kv_index[i].offset != KV_TOMBSTONE && kv_index[i].hash == hash) {
+			record = (kv_record_t *) (PAGE_ADDRESS(active_page) + kv_index[i].offset);
+			if (record->key_len == key_len &&
+					memcmp((uint8_t *) record + sizeof(kv_record_t), key, key_len) == 0) {
+				return i;
+			}
+		}
+		i = (i + 1) & (KV_INDEX_SIZE - 1);
+	}
+	return -1;
+}
+
+
+/**
+ *  @brief
+ *      Inserts, replaces or deletes an index entry.
+ *  @param[in]
+ *      key    key of the record in the flash
+ *  @param[in]
+ *      offset record offset in the active page
+ */
+static void index_update(const char *key, int key_len, uint8_t type, uint16_t offset) {
+	int i, n;
+	uint16_t hash;
+
+	hash = hash_key(key, key_len);
+	i = lookup(key, key_len, hash);
+	if (i >= 0) {
+		if (type == KV_TYPE_DELETED) {
+			kv_index[i].offset = KV_TOMBSTONE;
+			index_live--;
+		} else {
+			kv_index[i].offset = offset;
+		}
+		return;
+	}
+	if (type == KV_TYPE_DELETED) {
+		return;
+	}
+
+	// the first tombstone on the probe sequence is reused, an empty entry
+	// only if one is left to terminate the lookups
+	i = hash & (KV_INDEX_SIZE - 1);
+	for (n=0; n<KV_INDEX_SIZE; n++) {
+		if (kv_index[i].offset == KV_TOMBSTONE) {
+			break;
+		}
+		if (kv_index[i].offset == KV_EMPTY) {
+			if (index_used >= KV_INDEX_SIZE - 1) {
+				return;
+			}
+			index_used++;
+			break;
+		}
+		i = (i + 1) & (KV_INDEX_SIZE - 1);
+	}
+	if (n < KV_INDEX_SIZE) {
+		kv_index[i].hash = hash;
+		kv_index[i].offset = offset;
+		index_live++;
+	}
+}
+
+
+/**
+ *  @brief
+ *      FNV-1a hash (16 bit folded).
+ */
+static uint16_t hash_key(const char *key, int key_len) {
+	uint32_t hash = 2166136261u;
+	int i;
+
+	for (i=0; i<key_len; i++) {
+		hash ^= (uint8_t) key[i];
+		hash *= 16777619u;
+	}
+	return (uint16_t) (hash ^ (hash >> 16));
+}
+
+
+/**
+ *  @brief
+ *      CRC-16-CCITT (polynomial 0x1021).
+ */
+static uint16_t crc16(uint16_t crc, const uint8_t *data, int len) {
+	int i;
+
+	while (len--) {
+		crc ^= (uint16_t) (*data++) << 8;
+		for (i=0; i<8; i++) {
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+		}
+	}
+	return crc;
+}
+
+
+/**
+ *  @brief
+ *      CRC over the record header (without CRC), key and value.
+ */
+static uint16_t record_crc(const kv_record_t *record, const char *key, const void *value) {
+	uint16_t crc;
+
+	crc = crc16(0xFFFF, (const uint8_t *) record, 6);
+	crc = crc16(crc, (const uint8_t *) key, record->key_len);
+	return crc16(crc, (const uint8_t *) value, record->value_len);
+}
@@ -0,0 +1,161 @@
+/**
+ *  @brief
+ *      Console tee, the terminal output goes to several terminals.
+ *
+ *      Every terminal (UART, USB CDC, BLE CRS) has its own Tx ring buffer
+ *      and drain (DMA, CDC thread, CRS thread). A sink with the drop policy
+ *      gets only as many chars as fit into its buffer, a slow or
+ *      disconnected sink never throttles the other terminals. A sink with
+ *      the block policy waits for free space like the plain terminal.
+ *  @file
+ *      tee.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "tee.h"
+#include "uart.h"
+#include "usb_cdc.h"
+#include "crs_app.h"
+
+
+// Private typedefs
+// ****************
+typedef struct {
+	int sink;
+	int (*write)(const char *buffer, int length);
+	int (*free)(void);
+} tee_sink_t;
+
+
+// Private Variables
+// *****************
+static const tee_sink_t tee_sinks[] = {
+		{ TEE_UART, UART_write,   UART_TxFree },
+		{ TEE_CDC,  CDC_write,    CDC_TxFree },
+		{ TEE_CRS,  CRSAPP_write, CRSAPP_TxFree }
+};
+
+static volatile int TEE_Sinks = 0;		// active sinks
+static volatile int TEE_Drop = 0;		// sinks with the drop policy
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Sets the sinks and their policy.
+ *  @param[in]
+ *      sinks  TEE_UART, TEE_CDC, TEE_CRS (or'ed)
+ *  @param[in]
+ *      drop   sinks which drop chars if the Tx buffer is full, the other
+ *             sinks block.
+ *  @return
+ *      None
+ */
+void TEE_set(int sinks, int drop) {
+	TEE_Sinks = sinks;
+	TEE_Drop = drop;
+}
+
+
+/**
+ *  @brief
+ *      Writes a buffer to all sinks.
+ *  @param[in]
+ *      buffer  data to write
+ *  @param[in]
+ *      length  number of bytes to write
+ *  @return
+ *      Return length.
+ */
+int TEE_write(const char *buffer, int length) {
+	unsigned int i;
+	int count;
+
+	for (i=0; i<sizeof(tee_sinks)/sizeof(tee_sink_t); i++) {
+		if (! (TEE_Sinks & tee_sinks[i].sink)) {
+			continue;
+		}
+		count = length;
+		if (TEE_Drop & tee_sinks[i].sink) {
+			// never wait for a slow sink
+			count = tee_sinks[i].free();
+			if (count > length) {
+				count = length;
+			}
+		}
+		if (count > 0) {
+			tee_sinks[i].write(buffer, count);
+		}
+	}
+	return length;
+}
+
+
+/**
+ *  @brief
+ *      Is there room for a char?
+ *
+ *      Sinks with the drop policy never wait, only the blocking sinks
+ *      count.
+ *  @return
+ *      TRUE if all blocking sinks have room for a char
+ */
+int TEE_TxReady(void) {
+	unsigned int i;
+
+	for (i=0; i<sizeof(tee_sinks)/sizeof(tee_sink_t); i++) {
+		if (! (TEE_Sinks & ~TEE_Drop & tee_sinks[i].sink)) {
+			continue;
+		}
+		if (tee_sinks[i].free() <= 0) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+
+/**
+ *  @brief
+ *      Writes a char to all sinks.
+ *  @param[in]
+ *      c  char to write
+ *  @return
+ *      Return 0.
+ */
+int TEE_putc(int c) {
+	char ch = c;
+
+	TEE_write(&ch, 1);
+	return 0;
+}
@@ -2,9 +2,22 @@
  *  @brief
  *      Buffered serial communication.
  *
- *      Using interrupt for USART1 peripheral. Separate threads for transmitting
- *      and receiving data. CMSIS-RTOS Mutex for mutual-exclusion UART resource.
- *      CMSIS-RTOS queues as buffers.
+ *      USART1 Tx uses a DMA, UART_putc() writes into a ring buffer and the
+ *      DMA sends the largest contiguous chunk. The Tx complete interrupt
+ *      starts the next chunk. Optional RTS/CTS hardware flow control.
+ *      USART1 Rx uses a circular DMA, the DMA buffer is a lock-free ring
+ *      buffer (the DMA is the producer, UART_getc() the consumer). Idle line,
+ *      half and full transfer interrupts wake up the reader. The half and
+ *      full transfer interrupts count the laps of the DMA, if the DMA has
+ *      overtaken the reader the oldest characters are lost but the reader
+ *      stays in sync. Framing, noise and parity errors do not stop the DMA.
+ *      Optional XON/XOFF software flow control for uploads: XOFF is sent if
+ *      the Rx ring buffer is half full, XON when it has drained below a
+ *      quarter. The fill level is checked at every CR (character match
+ *      interrupt) so the sender is held off while the interpreter compiles.
+ *      XON and XOFF bypass the Tx ring buffer, the DMA sends them before the
+ *      next chunk. The chunks are limited to UART_TX_CHUNK bytes meanwhile.
+ *      CMSIS-RTOS Mutex for mutual-exclusion UART resource.
  *      CR is end of line for Rx.
  *      LF is end of line for Tx.
  *  @file
@@ -36,6 +49,7 @@
 // ********************
 #include "cmsis_os.h"
 #include <stdio.h>
+#include <string.h>
 
 // Application include files
 // *************************
@@ -47,14 +61,28 @@
 // *******************
 #define UART_TX_BUFFER_LENGTH	1024
 #define UART_RX_BUFFER_LENGTH	(5 * 1024)
+#define UART_KEY_BUFFER_LENGTH	1024
+#define UART_TX_RETRY			10		// ms till a failed Tx DMA start is retried
 
-#define UART_CHAR_SENT		0x01
-#define UART_CHAR_RECEIVED	0x01
+// XON/XOFF watermarks
+#define UART_XOFF_LEVEL		(UART_RX_BUFFER_LENGTH / 2)
+#define UART_XON_LEVEL		(UART_RX_BUFFER_LENGTH / 4)
+#define UART_XON			0x11	// DC1
+#define UART_XOFF			0x13	// DC3
+#define UART_TX_CHUNK		64		// largest Tx DMA chunk with XON/XOFF
 
 // Private function prototypes
 // ***************************
-static void UART_TxThread(void *argument);
-static void UART_RxThread(void *argument);
+static void UART_startTx(void);
+static int UART_waitTx(void);
+static void UART_stop(void);
+static void UART_startRx(void);
+static uint32_t UART_rxHead(uint32_t *laps);
+static int UART_rxCount(void);
+static void UART_rxResync(void);
+static void UART_reverse(uint8_t *p, uint32_t n);
+static void UART_sendFlowCtl(uint8_t c);
+static void UART_checkXoff(void);
 
 // Global Variables
 // ****************
@@ -66,22 +94,6 @@ extern UART_HandleTypeDef huart1;
 // RTOS resources
 // **************
 
-// Definitions for UART Tx thread
-static osThreadId_t UART_TxThreadId;
-static const osThreadAttr_t UART_TxThreadAttr = {
-		.name = "UART_TxThread",
-		.priority = (osPriority_t) osPriorityHigh,
-		.stack_size = 512 * 2
-};
-
-// Definitions for UART Rx thread
-static osThreadId_t UART_RxThreadId;
-static const osThreadAttr_t UART_RxThreadAttr = {
-		.name = "UART_RxThread",
-		.priority = (osPriority_t) osPriorityHigh,
-		.stack_size = 512 * 2
-};
-
 osMutexId_t UART_MutexID;
 const osMutexAttr_t UART_MutexAttr = {
 		NULL,				// no name required
@@ -90,22 +102,44 @@ const osMutexAttr_t UART_MutexAttr = {
 		0U					// size for control block
 };
 
-// Definitions for TxQueue
-static osMessageQueueId_t UART_TxQueueId;
-static const osMessageQueueAttr_t uart_TxQueue_attributes = {
-		.name = "UART_TxQueue"
+// Definitions for TxSemaphore, released by the Tx complete interrupt
+static osSemaphoreId_t UART_TxSemaphoreID;
+static const osSemaphoreAttr_t UART_TxSemaphoreAttr = {
+		.name = "UART_TxSemaphore"
 };
 
-// Definitions for RxQueue
-static osMessageQueueId_t UART_RxQueueId;
-static const osMessageQueueAttr_t uart_RxQueue_attributes = {
-		.name = "UART_RxQueue"
+// Definitions for KeyQueue (redirected output, see UART_putkey())
+static osMessageQueueId_t UART_KeyQueueId;
+static const osMessageQueueAttr_t uart_KeyQueue_attributes = {
+		.name = "UART_KeyQueue"
+};
+
+// Definitions for RxSemaphore, released by the DMA and idle line interrupts
+static osSemaphoreId_t UART_RxSemaphoreID;
+static const osSemaphoreAttr_t UART_RxSemaphoreAttr = {
+		.name = "UART_RxSemaphore"
 };
 
 // Private Variables
 // *****************
-static uint8_t UART_TxBuffer;
-static uint8_t UART_RxBuffer;
+// Tx ring buffer, read by the DMA
+static uint8_t UART_TxBuffer[UART_TX_BUFFER_LENGTH];
+static volatile uint32_t UART_TxHead = 0;	// write index
+static volatile uint32_t UART_TxTail = 0;	// read index (DMA)
+static volatile uint32_t UART_TxCount = 0;	// bytes in the running DMA transfer
+
+// Rx ring buffer, written by the DMA
+static uint8_t UART_RxBuffer[UART_RX_BUFFER_LENGTH];
+static volatile uint32_t UART_RxTail = 0;	// read index
+static volatile uint32_t UART_RxTailLaps = 0;	// laps of the reader
+static volatile uint32_t UART_RxHalves = 0;	// half and full transfer interrupts
+
+// XON/XOFF software flow control
+static volatile int UART_XonXoff = FALSE;	// enabled
+static volatile int UART_XoffSent = FALSE;	// sender is held off
+static volatile uint8_t UART_FlowCtl = 0;	// XON/XOFF to send, 0 none
+static uint8_t UART_FlowCtlBuffer;			// XON/XOFF sent by the DMA
+static volatile int UART_FlowCtlBusy = FALSE;	// DMA sends UART_FlowCtlBuffer
 
 // Public Functions
 // ****************
@@ -118,47 +152,62 @@ static uint8_t UART_RxBuffer;
  */
 void UART_init(void) {
 	// Create the queue(s)
-	// creation of TxQueue
-	UART_TxQueueId = osMessageQueueNew(UART_TX_BUFFER_LENGTH, sizeof(uint8_t),
-			&uart_TxQueue_attributes);
-	if (UART_TxQueueId == NULL) {
-		Error_Handler();
-	}
-	// creation of RxQueue
-	UART_RxQueueId = osMessageQueueNew(UART_RX_BUFFER_LENGTH, sizeof(uint8_t),
-			&uart_RxQueue_attributes);
-	if (UART_RxQueueId == NULL) {
+	// creation of KeyQueue
+	UART_KeyQueueId = osMessageQueueNew(UART_KEY_BUFFER_LENGTH, sizeof(uint8_t),
+			&uart_KeyQueue_attributes);
+	if (UART_KeyQueueId == NULL) {
 		Error_Handler();
 	}
 
-	UART_MutexID = osMutexNew(&UART_MutexAttr);
-	if (UART_MutexID == NULL) {
+	UART_TxSemaphoreID = osSemaphoreNew(1, 0, &UART_TxSemaphoreAttr);
+	if (UART_TxSemaphoreID == NULL) {
 		Error_Handler();
 	}
 
-	// creation of UART_TxThread
-	UART_TxThreadId = osThreadNew(UART_TxThread, NULL, &UART_TxThreadAttr);
-	if (UART_TxThreadId == NULL) {
+	UART_RxSemaphoreID = osSemaphoreNew(1, 0, &UART_RxSemaphoreAttr);
+	if (UART_RxSemaphoreID == NULL) {
 		Error_Handler();
 	}
 
-	// creation of UART_RxThread
-	UART_RxThreadId = osThreadNew(UART_RxThread, NULL, &UART_RxThreadAttr);
-	if (UART_RxThreadId == NULL) {
+	UART_MutexID = osMutexNew(&UART_MutexAttr);
+	if (UART_MutexID == NULL) {
 		Error_Handler();
 	}
 
+	// start the Rx DMA
+	UART_startRx();
 }
 
 /**
  *  @brief
- *      Resets the UART queues.
+ *      Resets the UART buffers.
  *  @return
  *      None
  */
 void UART_reset(void) {
-	osMessageQueueReset(UART_RxQueueId);
-	osMessageQueueReset(UART_TxQueueId);
+	uint32_t primask_bit;
+	uint32_t laps;
+
+	osMessageQueueReset(UART_KeyQueueId);
+	// discard the characters not yet passed to the DMA
+	primask_bit = __get_PRIMASK();
+	__disable_irq();
+	if (! UART_FlowCtlBusy) {
+		UART_TxHead = (UART_TxTail + UART_TxCount) % UART_TX_BUFFER_LENGTH;
+	} else {
+		UART_TxHead = UART_TxTail;
+	}
+	__set_PRIMASK(primask_bit);
+	// discard the received characters
+	primask_bit = __get_PRIMASK();
+	__disable_irq();
+	UART_RxTail = UART_rxHead(&laps);
+	UART_RxTailLaps = laps;
+	__set_PRIMASK(primask_bit);
+	if (UART_XoffSent) {
+		UART_XoffSent = FALSE;
+		UART_sendFlowCtl(UART_XON);
+	}
 }
 
 
@@ -172,12 +221,46 @@ void UART_reset(void) {
  */
 int UART_getc(void) {
 	uint8_t c;
-	if (osMessageQueueGet(UART_RxQueueId, &c, NULL, osWaitForever) == osOK) {
-		return c;
+
+	// redirected output first
+	if (osMessageQueueGetCount(UART_KeyQueueId) > 0) {
+		if (osMessageQueueGet(UART_KeyQueueId, &c, NULL, 0) == osOK) {
+			return c;
+		}
+	}
+
+	while (UART_rxCount() == 0) {
+		// blocked till the DMA or the idle line interrupt signals new data
+		if (osSemaphoreAcquire(UART_RxSemaphoreID, osWaitForever) != osOK) {
+			Error_Handler();
+			return EOF;
+		}
+		if (osMessageQueueGetCount(UART_KeyQueueId) > 0) {
+			if (osMessageQueueGet(UART_KeyQueueId, &c, NULL, 0) == osOK) {
+				return c;
+			}
+		}
+	}
+
+	if (UART_rxCount() >= UART_RX_BUFFER_LENGTH) {
+		// overtaken by the DMA
+		UART_rxResync();
+	}
+
+	c = UART_RxBuffer[UART_RxTail];
+	if (UART_RxTail + 1 < UART_RX_BUFFER_LENGTH) {
+		UART_RxTail++;
 	} else {
-		Error_Handler();
-		return EOF;
+		UART_RxTail = 0;
+		UART_RxTailLaps++;
+	}
+
+	if (UART_XoffSent && UART_rxCount() <= UART_XON_LEVEL) {
+		// drained, resume the sender
+		UART_XoffSent = FALSE;
+		UART_sendFlowCtl(UART_XON);
 	}
+	return c;
 }
 
 
@@ -197,21 +280,20 @@ int UART_getc(void) {
  */
 int UART_gets(char *str, int length) {
 	int i = 0;
-	uint8_t c;
+	int c;
 
 	for (i=0; i<length; i++) {
-		if (osMessageQueueGet(UART_RxQueueId, &c, NULL, osWaitForever) == osOK) {
-			str[i] = c;
-			if (c == '\r' || c == '\n') {
-				str[i+1] = 0;
-				return 0;
-			}
-		} else {
-			Error_Handler();
+		c = UART_getc();
+		if (c == EOF) {
 			str[i] = EOF;
 			str[i+1] = 0;
 			return EOF;
 		}
+		str[i] = c;
+		if (c == '\r' || c == '\n') {
+			str[i+1] = 0;
+			return 0;
+		}
 	}
 	return 0;
 }
@@ -224,7 +306,7 @@ int UART_gets(char *str, int length) {
  *		TRUE if a character has been received.
  */
 int UART_RxReady(void) {
-	if (osMessageQueueGetCount(UART_RxQueueId) == 0) {
+	if (UART_rxCount() == 0 && osMessageQueueGetCount(UART_KeyQueueId) == 0) {
 		return FALSE;
 	} else {
 		return TRUE;
@@ -234,8 +316,8 @@ int UART_RxReady(void) {
 
 /**
  *  @brief
- *      Writes a char to the UART Tx (serial out). Blocking until char can be
- *      written into the queue.
+ *      Writes a char to the UART Tx (serial out). Blocking only if the
+ *      ring buffer is full.
  *
  *      Does not work in ISRs.
  *  @param[in]
@@ -244,14 +326,26 @@ int UART_RxReady(void) {
  *      Return EOF on error, 0 on success.
  */
 int UART_putc(int c) {
-	osStatus_t status;
+	uint32_t primask_bit;
+	uint32_t next;
+
+	for (;;) {
+		primask_bit = __get_PRIMASK();
+		__disable_irq();
+		next = (UART_TxHead + 1) % UART_TX_BUFFER_LENGTH;
+		if (next != UART_TxTail) {
+			UART_TxBuffer[UART_TxHead] = (uint8_t) c;
+			UART_TxHead = next;
+			UART_startTx();
+			__set_PRIMASK(primask_bit);
+			return 0;
+		}
+		__set_PRIMASK(primask_bit);
 
-	status = osMessageQueuePut(UART_TxQueueId, &c, 0, osWaitForever);
-	if (status == osOK) {
-		return 0;
-	} else {
-		Error_Handler();
-		return EOF;
+		// buffer full, blocked till the DMA has sent a chunk
+		if (UART_waitTx() == EOF) {
+			return EOF;
+		}
 	}
 }
 
@@ -269,12 +363,9 @@ int UART_putc(int c) {
  */
 int UART_puts(const char *s) {
 	int i=0;
-	uint8_t buffer;
 
 	while (s[i] != 0) {
-		buffer = (uint8_t) s[i];
-		if (osMessageQueuePut(UART_TxQueueId, &buffer, 0, osWaitForever) != osOK) {
-			Error_Handler();
+		if (UART_putc(s[i]) == EOF) {
 			return EOF;
 		}
 		i++;
@@ -285,12 +376,69 @@ int UART_puts(const char *s) {
 
 /**
  *  @brief
- *      Tx queue ready for next char.
+ *      Writes a buffer to the UART Tx (serial out). The buffer is copied in
+ *      contiguous chunks into the ring buffer, blocking only if the ring
+ *      buffer is full.
+ *
+ *      Does not work in ISRs.
+ *  @param[in]
+ *      buffer  data to write
+ *  @param[in]
+ *      length  number of bytes to write
+ *  @return
+ *      Return EOF on error, number of bytes written on success.
+ */
+int UART_write(const char *buffer, int length) {
+	uint32_t primask_bit;
+	uint32_t head;
+	uint32_t tail;
+	int count;
+	int written = 0;
+
+	while (written < length) {
+		primask_bit = __get_PRIMASK();
+		__disable_irq();
+		head = UART_TxHead;
+		tail = UART_TxTail;
+		// free contiguous space, one byte is always left empty
+		if (head >= tail) {
+			count = UART_TX_BUFFER_LENGTH - head;
+			if (tail == 0) {
+				count--;
+			}
+		} else {
+			count = tail - head - 1;
+		}
+		if (count > length - written) {
+			count = length - written;
+		}
+		if (count > 0) {
+			memcpy(&UART_TxBuffer[head], &buffer[written], count);
+			UART_TxHead = (head + count) % UART_TX_BUFFER_LENGTH;
+			written += count;
+			UART_startTx();
+		}
+		__set_PRIMASK(primask_bit);
+
+		if (count <= 0) {
+			// buffer full, blocked till the DMA has sent a chunk
+			if (UART_waitTx() == EOF) {
+				return EOF;
+			}
+		}
+	}
+	return written;
+}
+
+
+/**
+ *  @brief
+ *      Tx buffer ready for next char.
  *  @return
  *      FALSE if the buffer is full.
  */
 int UART_TxReady(void) {
-	if (osMessageQueueGetSpace(UART_TxQueueId) > 0) {
+	if ((UART_TxHead + 1) % UART_TX_BUFFER_LENGTH != UART_TxTail) {
 		return TRUE;
 	} else {
 		return FALSE;
@@ -298,6 +446,17 @@ int UART_TxReady(void) {
 }
 
 
+/**
+ *  @brief
+ *      Free space in the Tx buffer.
+ *  @return
+ *      Number of chars that can be written without blocking.
+ */
+int UART_TxFree(void) {
+	return (UART_TxTail + UART_TX_BUFFER_LENGTH - UART_TxHead - 1) % UART_TX_BUFFER_LENGTH;
+}
+
+
 /**
  *  @brief
  *      Writes a char direct into the key queue.
@@ -313,8 +472,10 @@ int UART_putkey(const char c) {
 		// eat CR
 		return 0;
 	}
-	status = osMessageQueuePut(UART_RxQueueId, &c, 0, osWaitForever);
+	status = osMessageQueuePut(UART_KeyQueueId, &c, 0, osWaitForever);
 	if (status == osOK) {
+		// wake up a blocked reader
+		osSemaphoreRelease(UART_RxSemaphoreID);
 		return 0;
 	} else {
 		Error_Handler();
@@ -339,9 +500,11 @@ void UART_setBaudrate(const int baudrate) {
 	osMutexAcquire(UART_MutexID, osWaitForever);
 
 	huart1.Init.BaudRate = baudrate;
+	UART_stop();
 	if (HAL_UART_Init(&huart1) != HAL_OK) {
 		Error_Handler();
 	}
+	UART_startRx();
 	osMutexRelease(UART_MutexID);
 }
 
@@ -374,9 +537,11 @@ void UART_setWordLength(const int wordlength) {
 		huart1.Init.WordLength = UART_WORDLENGTH_8B;
 		break;
 	}
+	UART_stop();
 	if (HAL_UART_Init(&huart1) != HAL_OK) {
 		Error_Handler();
 	}
+	UART_startRx();
 	osMutexRelease(UART_MutexID);
 }
 
@@ -408,9 +573,11 @@ void UART_setParityBit(const int paritybit) {
 		huart1.Init.Parity = UART_PARITY_NONE;
 		break;
 	}
+	UART_stop();
 	if (HAL_UART_Init(&huart1) != HAL_OK) {
 		Error_Handler();
 	}
+	UART_startRx();
 
 	osMutexRelease(UART_MutexID);
 }
@@ -443,9 +610,81 @@ void UART_setStopBits(const int stopbits) {
 		huart1.Init.StopBits = UART_STOPBITS_1;
 		break;
 	}
+	UART_stop();
 	if (HAL_UART_Init(&huart1) != HAL_OK) {
 		Error_Handler();
 	}
+	UART_startRx();
+
+	osMutexRelease(UART_MutexID);
+}
+
+
+/**
+ *  @brief
+ *	    Enables or disables the RTS/CTS hardware flow control.
+ *
+ *      RTS is on PB3 (JTDO/SWO, no trace output while enabled), CTS on PB4.
+ *	@param[in]
+ *      flowctl    0 none, 1 RTS/CTS.
+ *  @return
+ *      none
+ *
+ */
+void UART_setHwFlowCtl(const int flowctl) {
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	// only one thread is allowed to use the UART
+	osMutexAcquire(UART_MutexID, osWaitForever);
+
+	if (flowctl) {
+		GPIO_InitStruct.Pin = GPIO_PIN_3|GPIO_PIN_4;
+		GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+		GPIO_InitStruct.Pull = GPIO_NOPULL;
+		GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+		GPIO_InitStruct.Alternate = GPIO_AF7_USART1;
+		HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+		huart1.Init.HwFlowCtl = UART_HWCONTROL_RTS_CTS;
+	} else {
+		huart1.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+	}
+	UART_stop();
+	if (HAL_UART_Init(&huart1) != HAL_OK) {
+		Error_Handler();
+	}
+	UART_startRx();
+
+	osMutexRelease(UART_MutexID);
+}
+
+
+/**
+ *  @brief
+ *	    Enables or disables the XON/XOFF software flow control (upload mode).
+ *
+ *      The Rx fill level is checked on every received CR, the sender gets
+ *      an XOFF if the Rx buffer is half full and an XON if it has drained.
+ *	@param[in]
+ *      xonxoff    0 none, 1 XON/XOFF.
+ *  @return
+ *      none
+ *
+ */
+void UART_setXonXoff(const int xonxoff) {
+	// only one thread is allowed to use the UART
+	osMutexAcquire(UART_MutexID, osWaitForever);
+
+	UART_stop();
+	// the character match address can only be written while the USART is disabled
+	__HAL_UART_DISABLE(&huart1);
+	MODIFY_REG(huart1.Instance->CR2, USART_CR2_ADD, (uint32_t)'\r' << USART_CR2_ADD_Pos);
+	__HAL_UART_ENABLE(&huart1);
+	UART_XonXoff = xonxoff;
+	if (! xonxoff && UART_XoffSent) {
+		UART_XoffSent = FALSE;
+		UART_sendFlowCtl(UART_XON);
+	}
+	UART_startRx();
 
 	osMutexRelease(UART_MutexID);
 }
@@ -455,77 +694,286 @@ void UART_setStopBits(const int stopbits) {
 // *****************
 
 /**
-  * @brief
-  * 	Function implementing the UART Tx thread.
-  * @param
-  * 	argument: Not used
-  * @retval
-  * 	None
-  */
-static void UART_TxThread(void *argument) {
-	osStatus_t status;
-
-	// Infinite loop
-	for(;;) {
-		// blocked till a character is in the Tx queue
-		status = osMessageQueueGet(UART_TxQueueId, &UART_TxBuffer, 0, osWaitForever);
-		if (status == osOK) {
-			// only one thread is allowed to use the UART
-			osMutexAcquire(UART_MutexID, osWaitForever);
-			// send the character
-			if (HAL_UART_Transmit_IT(&huart1, &UART_TxBuffer, 1) == HAL_ERROR) {
-				// can't send char
-				Error_Handler();
-			}
-			osMutexRelease(UART_MutexID);
+ *  @brief
+ *      Starts a Tx DMA transfer if the DMA is idle.
+ *
+ *      A pending flow control character goes first. Otherwise sends the
+ *      largest contiguous chunk of the ring buffer. Has to be called with
+ *      disabled interrupts or from the Tx complete interrupt.
+ *  @return
+ *      None
+ */
+static void UART_startTx(void) {
+	uint32_t head = UART_TxHead;
 
-			// blocked till character is sent
-			status = osThreadFlagsWait(UART_CHAR_SENT, osFlagsWaitAny, 5);
-		} else {
-			// can't read the queue
-			Error_Handler();
+	if (UART_TxCount != 0) {
+		// DMA busy
+		return;
+	}
+	if (UART_FlowCtl != 0) {
+		UART_FlowCtlBuffer = UART_FlowCtl;
+		UART_FlowCtl = 0;
+		UART_FlowCtlBusy = TRUE;
+		UART_TxCount = 1;
+		if (HAL_UART_Transmit_DMA(&huart1, &UART_FlowCtlBuffer, 1) != HAL_OK) {
+			// retried by UART_waitTx()
+			UART_FlowCtl = UART_FlowCtlBuffer;
+			UART_FlowCtlBusy = FALSE;
+			UART_TxCount = 0;
 		}
+		return;
+	}
+	if (head == UART_TxTail) {
+		// nothing to send
+		return;
+	}
+	if (head > UART_TxTail) {
+		UART_TxCount = head - UART_TxTail;
+	} else {
+		// up to the end of the buffer, the rest in the next transfer
+		UART_TxCount = UART_TX_BUFFER_LENGTH - UART_TxTail;
+	}
+	if (UART_XonXoff && UART_TxCount > UART_TX_CHUNK) {
+		// short chunks, an XOFF must not wait long
+		UART_TxCount = UART_TX_CHUNK;
+	}
+	if (HAL_UART_Transmit_DMA(&huart1, &UART_TxBuffer[UART_TxTail], UART_TxCount) != HAL_OK) {
+		// retried by UART_waitTx()
+		UART_TxCount = 0;
 	}
 }
 
 
 /**
-  * @brief
-  * 	Function implementing the UART Rx thread.
-  * @param
-  * 	argument: Not used
-  * @retval
-  * 	None
-  */
-static void UART_RxThread(void *argument) {
+ *  @brief
+ *      Waits till the DMA has sent a chunk (Tx ring buffer full).
+ *
+ *      If the DMA could not be started, nobody releases the semaphore.
+ *      Therefore the start is retried every UART_TX_RETRY ms.
+ *  @return
+ *      Return EOF on error, 0 on success.
+ */
+static int UART_waitTx(void) {
+	uint32_t primask_bit;
 	osStatus_t status;
 
-	osMutexAcquire(UART_MutexID, osWaitForever);
-	// wait for the first Rx character
-	if (HAL_UART_Receive_IT(&huart1, &UART_RxBuffer, 1) != HAL_OK) {
-		// something went wrong
+	status = osSemaphoreAcquire(UART_TxSemaphoreID, UART_TX_RETRY);
+	if (status == osErrorTimeout) {
+		primask_bit = __get_PRIMASK();
+		__disable_irq();
+		UART_startTx();
+		__set_PRIMASK(primask_bit);
+		return 0;
+	}
+	if (status != osOK) {
 		Error_Handler();
+		return EOF;
 	}
-	osMutexRelease(UART_MutexID);
+	return 0;
+}
 
-	// Infinite loop
-	for(;;) {
-		// blocked till a character is received
-		status = osThreadFlagsWait(UART_CHAR_RECEIVED, osFlagsWaitAny, osWaitForever);
-		// put the received character into the queue
-		status = osMessageQueuePut(UART_RxQueueId, &UART_RxBuffer, 0, 100);
-		if (status != osOK) {
-			// can't put char into queue
-			Error_Handler();
-		}
-		// receive the next character
-		osMutexAcquire(UART_MutexID, osWaitForever);
-		status = HAL_UART_Receive_IT(&huart1, &UART_RxBuffer, 1);
-		osMutexRelease(UART_MutexID);
-		if (status != osOK) {
-			// can't receive char
-			Error_Handler();
-		}
+
+/**
+ *  @brief
+ *      Waits till the Tx buffer is empty and stops the Rx DMA (before the
+ *      UART is reconfigured).
+ *  @return
+ *      None
+ */
+static void UART_stop(void) {
+	while (UART_TxCount != 0) {
+		osDelay(1);
+	}
+	HAL_UART_AbortReceive(&huart1);
+}
+
+
+/**
+ *  @brief
+ *      Starts the circular Rx DMA into the ring buffer.
+ *
+ *      The idle line interrupt signals the end of a transmission, the DMA
+ *      half and full transfer interrupts signal bulk data.
+ *      Characters not read yet are kept: the buffer is rotated so that they
+ *      are at the end, the DMA starts again at the beginning.
+ *      The HAL aborts the DMA reception on every error interrupt, therefore
+ *      the framing, noise, overrun and parity error interrupts are disabled.
+ *  @return
+ *      None
+ */
+static void UART_startRx(void) {
+	uint32_t head;
+	uint32_t laps;
+	uint32_t count;
+
+	count = UART_rxCount();
+	if (count >= UART_RX_BUFFER_LENGTH) {
+		count = UART_RX_BUFFER_LENGTH - 1;
+	}
+	head = UART_rxHead(&laps);
+	if (count > 0 && head > 0) {
+		// rotate left by head
+		UART_reverse(UART_RxBuffer, head);
+		UART_reverse(&UART_RxBuffer[head], UART_RX_BUFFER_LENGTH - head);
+		UART_reverse(UART_RxBuffer, UART_RX_BUFFER_LENGTH);
+	}
+	UART_RxHalves = 0;
+	if (count > 0) {
+		// one lap behind the DMA
+		UART_RxTail = UART_RX_BUFFER_LENGTH - count;
+		UART_RxTailLaps = (uint32_t) -1;
+	} else {
+		UART_RxTail = 0;
+		UART_RxTailLaps = 0;
+	}
+
+	__HAL_UART_CLEAR_FLAG(&huart1, UART_CLEAR_PEF | UART_CLEAR_FEF | UART_CLEAR_NEF | UART_CLEAR_OREF);
+	if (HAL_UART_Receive_DMA(&huart1, UART_RxBuffer, UART_RX_BUFFER_LENGTH) != HAL_OK) {
+		Error_Handler();
+	}
+	CLEAR_BIT(huart1.Instance->CR1, USART_CR1_PEIE);
+	CLEAR_BIT(huart1.Instance->CR3, USART_CR3_EIE);
+	__HAL_UART_CLEAR_IDLEFLAG(&huart1);
+	__HAL_UART_ENABLE_IT(&huart1, UART_IT_IDLE);
+	if (UART_XonXoff) {
+		__HAL_UART_CLEAR_FLAG(&huart1, UART_CLEAR_CMF);
+		__HAL_UART_ENABLE_IT(&huart1, UART_IT_CM);
+	} else {
+		__HAL_UART_DISABLE_IT(&huart1, UART_IT_CM);
+	}
+}
+
+
+/**
+ *  @brief
+ *      Write index of the Rx DMA.
+ *
+ *      The write index is given by the DMA counter, the laps by the half and
+ *      full transfer interrupts. If the interrupt for the current half is
+ *      still pending the laps are corrected.
+ *  @param[out]
+ *      laps    number of completed laps of the DMA
+ *  @return
+ *      Write index
+ */
+static uint32_t UART_rxHead(uint32_t *laps) {
+	uint32_t halves = UART_RxHalves;
+	uint32_t head;
+
+	head = (UART_RX_BUFFER_LENGTH - __HAL_DMA_GET_COUNTER(huart1.hdmarx))
+			% UART_RX_BUFFER_LENGTH;
+	if ((halves & 1) != (head >= UART_RX_BUFFER_LENGTH / 2)) {
+		halves++;
+	}
+	*laps = halves / 2;
+	return head;
+}
+
+
+/**
+ *  @brief
+ *      Number of characters in the Rx ring buffer.
+ *  @return
+ *      Number of characters ready to read, UART_RX_BUFFER_LENGTH if the DMA
+ *      has overtaken the reader.
+ */
+static int UART_rxCount(void) {
+	uint32_t head;
+	uint32_t laps;
+	int count;
+
+	head = UART_rxHead(&laps);
+	count = (laps - UART_RxTailLaps) * UART_RX_BUFFER_LENGTH + head - UART_RxTail;
+	if (count < 0 || count >= UART_RX_BUFFER_LENGTH) {
+		return UART_RX_BUFFER_LENGTH;
+	}
+	return count;
+}
+
+
+/**
+ *  @brief
+ *      The DMA has overtaken the reader, the oldest characters are
+ *      overwritten. Continues with the oldest character still in the buffer.
+ *  @return
+ *      None
+ */
+static void UART_rxResync(void) {
+	uint32_t primask_bit;
+	uint32_t head;
+	uint32_t laps;
+
+	primask_bit = __get_PRIMASK();
+	__disable_irq();
+	head = UART_rxHead(&laps);
+	if (head + 1 < UART_RX_BUFFER_LENGTH) {
+		UART_RxTail = head + 1;
+		UART_RxTailLaps = laps - 1;
+	} else {
+		UART_RxTail = 0;
+		UART_RxTailLaps = laps;
+	}
+	__set_PRIMASK(primask_bit);
+}
+
+
+/**
+ *  @brief
+ *      Reverses a byte array in place.
+ *  @param[in, out]
+ *      p   array
+ *  @param[in]
+ *      n   length
+ *  @return
+ *      None
+ */
+static void UART_reverse(uint8_t *p, uint32_t n) {
+	uint8_t *q = p + n - 1;
+	uint8_t c;
+
+	while (p < q) {
+		c = *p;
+		*p++ = *q;
+		*q-- = c;
+	}
+}
+
+
+/**
+ *  @brief
+ *      Sends a flow control character (XON/XOFF) with priority.
+ *
+ *      The character does not go through the Tx ring buffer, the DMA sends
+ *      it before the next chunk. A pending XOFF is replaced by an XON and
+ *      vice versa. Does not block, works in ISRs.
+ *  @param[in]
+ *      c  XON or XOFF
+ *  @return
+ *      None
+ */
+static void UART_sendFlowCtl(uint8_t c) {
+	uint32_t primask_bit;
+
+	primask_bit = __get_PRIMASK();
+	__disable_irq();
+	UART_FlowCtl = c;
+	UART_startTx();
+	__set_PRIMASK(primask_bit);
+}
+
+
+/**
+ *  @brief
+ *      Holds off the sender if the Rx buffer is getting full.
+ *
+ *      Called by the Rx interrupts.
+ *  @return
+ *      None
+ */
+static void UART_checkXoff(void) {
+	if (UART_XonXoff && !UART_XoffSent && UART_rxCount() >= UART_XOFF_LEVEL) {
+		UART_XoffSent = TRUE;
+		UART_sendFlowCtl(UART_XOFF);
 	}
 }
 
@@ -542,11 +990,19 @@ void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
 	/* Prevent unused argument(s) compilation warning */
 	UNUSED(huart);
 
-	osThreadFlagsSet(UART_TxThreadId, UART_CHAR_SENT);
+	if (UART_FlowCtlBusy) {
+		UART_FlowCtlBusy = FALSE;
+	} else {
+		UART_TxTail = (UART_TxTail + UART_TxCount) % UART_TX_BUFFER_LENGTH;
+	}
+	UART_TxCount = 0;
+	// next chunk
+	UART_startTx();
+	osSemaphoreRelease(UART_TxSemaphoreID);
 }
 
 /**
-  * @brief  Rx Transfer completed callback.
+  * @brief  Rx Transfer completed callback (end of the circular buffer).
   * @param  huart UART handle.
   * @retval None
   */
@@ -554,19 +1010,69 @@ void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
 	/* Prevent unused argument(s) compilation warning */
 	UNUSED(huart);
 
-	osThreadFlagsSet(UART_RxThreadId, UART_CHAR_RECEIVED);
+	UART_RxHalves++;
+	UART_checkXoff();
+	osSemaphoreRelease(UART_RxSemaphoreID);
 }
 
 /**
-  * @brief  UART error callback.
+  * @brief  Rx Half Transfer completed callback.
   * @param  huart UART handle.
   * @retval None
   */
-void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart) {
 	/* Prevent unused argument(s) compilation warning */
 	UNUSED(huart);
 
-	Error_Handler();
+	UART_RxHalves++;
+	UART_checkXoff();
+	osSemaphoreRelease(UART_RxSemaphoreID);
+}
+
+/**
+  * @brief  Rx idle line callback, called by USART1_IRQHandler().
+  * @retval None
+  */
+void UART_RxIdleCallback(void) {
+	UART_checkXoff();
+	osSemaphoreRelease(UART_RxSemaphoreID);
+}
+
+/**
+  * @brief  Rx character match (CR) callback, called by USART1_IRQHandler().
+  * @retval None
+  */
+void UART_RxMatchCallback(void) {
+	UART_checkXoff();
+	osSemaphoreRelease(UART_RxSemaphoreID);
+}
+
+/**
+  * @brief  UART error callback.
+  * @param  huart UART handle.
+  * @retval None
+  */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+	if (huart->gState == HAL_UART_STATE_READY && UART_TxCount != 0) {
+		// DMA transmission aborted by the HAL (DMA error), the chunk is
+		// dropped (a retransmit could fail forever), next chunk
+		if (UART_FlowCtlBusy) {
+			// flow control characters are never dropped
+			UART_FlowCtlBusy = FALSE;
+			if (UART_FlowCtl == 0) {
+				UART_FlowCtl = UART_FlowCtlBuffer;
+			}
+		} else {
+			UART_TxTail = (UART_TxTail + UART_TxCount) % UART_TX_BUFFER_LENGTH;
+		}
+		UART_TxCount = 0;
+		UART_startTx();
+		osSemaphoreRelease(UART_TxSemaphoreID);
+	}
+	if (huart->RxState == HAL_UART_STATE_READY) {
+		// DMA reception aborted by the HAL (DMA error), restart
+		UART_startRx();
+	}
 }
 
 
@@ -579,6 +1085,7 @@ void HAL_UARTEx_RxFifoFullCallback(UART_HandleTypeDef *huart) {
 	/* Prevent unused argument(s) compilation warning */
 	UNUSED(huart);
 
-	Error_Handler();
+	// the DMA empties the FIFO, wake up the reader anyway
+	osSemaphoreRelease(UART_RxSemaphoreID);
 }
 
@@ -3,6 +3,17 @@
  *      USB CDC terminal console
  *
  *      Buffered serial communication.
+ *
+ *      Tx: CDC_putc() writes into a ring buffer. The CDC thread collects the
+ *      characters into packets (up to 1 KiB, short flush delay) and sends
+ *      them from the double buffered UserTxBufferFS: the next packet is
+ *      filled while the previous one is in flight. Transfers with a length
+ *      of a multiple of 64 bytes are terminated by a ZLP (see
+ *      USBD_CDC_DataIn()).
+ *
+ *      Rx: single-producer (USB ISR) single-consumer (CDC_getc()) ring
+ *      buffer. If there is no space for another packet, the OUT endpoint is
+ *      not re-armed and the host gets NAKs till CDC_getc() has made room.
  *  @file
  *      usb_cdc.c
  *  @author
@@ -31,6 +42,7 @@
 // System include files
 // ********************
 #include "cmsis_os.h"
+#include <string.h>
 
 // Application include files
 // *************************
@@ -38,14 +50,24 @@
 #include "main.h"
 #include "usb_cdc.h"
 #include "usbd_cdc_if.h"
+#include "usbd_msc.h"
+
+
+#define CDC_TX_BUFFER_LENGTH	2048
+#define CDC_TX_PACKET_SIZE		1024	// half of UserTxBufferFS (APP_TX_DATA_SIZE)
+#define CDC_TX_FLUSH_TIME		1		// ms to collect characters for a packet
 
+#define CDC_TX_DATA		0x01		// thread flag, Tx ring buffer not empty
 
-#define CDC_TX_SENT	0x01
+#define CDC_RX_BUFFER_LENGTH	2048
+#define CDC_KEY_BUFFER_LENGTH	1024
 
 
 // Private function prototypes
 // ***************************
 static void cdc_thread(void *argument);
+static int cdc_txCount(void);
+static int cdc_rxCount(void);
 
 // Global Variables
 // ****************
@@ -61,16 +83,22 @@ const osThreadAttr_t cdc_thread_attributes = {
 		.stack_size = 512*2
 };
 
-// Definitions for TxQueue
-osMessageQueueId_t CDC_TxQueueId;
-static const osMessageQueueAttr_t cdc_TxQueue_attributes = {
-		.name = "CDC_TxQueue"
+// Definitions for TxSemaphore, released by the CDC thread
+static osSemaphoreId_t CDC_TxSemaphoreID;
+static const osSemaphoreAttr_t cdc_TxSemaphore_attributes = {
+		.name = "CDC_TxSemaphore"
 };
 
-// Definitions for RxQueue
-osMessageQueueId_t CDC_RxQueueId;
-static const osMessageQueueAttr_t cdc_RxQueue_attributes = {
-		.name = "CDC_RxQueue"
+// Definitions for KeyQueue (redirected output, see CDC_putkey())
+static osMessageQueueId_t CDC_KeyQueueId;
+static const osMessageQueueAttr_t cdc_KeyQueue_attributes = {
+		.name = "CDC_KeyQueue"
+};
+
+// Definitions for RxSemaphore, released by the USB ISR
+static osSemaphoreId_t CDC_RxSemaphoreID;
+static const osSemaphoreAttr_t cdc_RxSemaphore_attributes = {
+		.name = "CDC_RxSemaphore"
 };
 
 osEventFlagsId_t CDC_EvtFlagsID;
@@ -79,6 +107,21 @@ osEventFlagsId_t CDC_EvtFlagsID;
 // Private Variables
 // *****************
 
+// Tx ring buffer
+static uint8_t CDC_TxBuffer[CDC_TX_BUFFER_LENGTH];
+static volatile uint32_t CDC_TxHead = 0;	// write index
+static volatile uint32_t CDC_TxTail = 0;	// read index (CDC thread)
+
+// Rx ring buffer
+static uint8_t CDC_RxBuffer[CDC_RX_BUFFER_LENGTH];
+static volatile uint32_t CDC_RxHead = 0;	// write index (USB ISR)
+static volatile uint32_t CDC_RxTail = 0;	// read index
+static volatile int CDC_RxNAK = FALSE;		// OUT endpoint not armed
+
+// USB packet buffers, see usbd_cdc_if.c
+extern uint8_t UserTxBufferFS[];
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
 // Public Functions
 // ****************
 
@@ -90,18 +133,24 @@ osEventFlagsId_t CDC_EvtFlagsID;
  */
 void CDC_init(void) {
 	// Create the queue(s)
-	// creation of TxQueue
-	CDC_TxQueueId = osMessageQueueNew(200, sizeof(uint8_t), &cdc_TxQueue_attributes);
-	if (CDC_TxQueueId == NULL) {
-		// no queue created
+	// creation of TxSemaphore
+	CDC_TxSemaphoreID = osSemaphoreNew(1, 0, &cdc_TxSemaphore_attributes);
+	if (CDC_TxSemaphoreID == NULL) {
+		// no semaphore created
 		Error_Handler();
 	}
-	// creation of RxQueue
-	CDC_RxQueueId = osMessageQueueNew(2048, sizeof(uint8_t), &cdc_RxQueue_attributes);
-	if (CDC_RxQueueId == NULL) {
+	// creation of KeyQueue
+	CDC_KeyQueueId = osMessageQueueNew(CDC_KEY_BUFFER_LENGTH, sizeof(uint8_t), &cdc_KeyQueue_attributes);
+	if (CDC_KeyQueueId == NULL) {
 		// no queue created
 		Error_Handler();
 	}
+	// creation of RxSemaphore
+	CDC_RxSemaphoreID = osSemaphoreNew(1, 0, &cdc_RxSemaphore_attributes);
+	if (CDC_RxSemaphoreID == NULL) {
+		// no semaphore created
+		Error_Handler();
+	}
 
 	// Create Event Flags
 	CDC_EvtFlagsID = osEventFlagsNew(NULL);
@@ -117,6 +166,9 @@ void CDC_init(void) {
 		Error_Handler();
 	}
 
+	// mass storage thread, before the host configures the device
+	MSC_init();
+
 	MX_USB_Device_Init();
 
 
@@ -133,12 +185,76 @@ void CDC_init(void) {
  */
 int CDC_getc(void) {
 	uint8_t c;
-	if (osMessageQueueGet(CDC_RxQueueId, &c, NULL, osWaitForever) == osOK) {
-		return c;
-	} else {
-		Error_Handler();
-		return EOF;
+	uint32_t primask_bit;
+
+	// redirected output first
+	if (osMessageQueueGetCount(CDC_KeyQueueId) > 0) {
+		if (osMessageQueueGet(CDC_KeyQueueId, &c, NULL, 0) == osOK) {
+			return c;
+		}
+	}
+
+	while (cdc_rxCount() == 0) {
+		// blocked till the USB ISR signals new data
+		if (osSemaphoreAcquire(CDC_RxSemaphoreID, osWaitForever) != osOK) {
+			Error_Handler();
+			return EOF;
+		}
+		if (osMessageQueueGetCount(CDC_KeyQueueId) > 0) {
+			if (osMessageQueueGet(CDC_KeyQueueId, &c, NULL, 0) == osOK) {
+				return c;
+			}
+		}
 	}
+
+	c = CDC_RxBuffer[CDC_RxTail];
+	CDC_RxTail = (CDC_RxTail + 1) % CDC_RX_BUFFER_LENGTH;
+
+	if (CDC_RxNAK &&
+			CDC_RX_BUFFER_LENGTH - 1 - cdc_rxCount() >= CDC_DATA_FS_MAX_PACKET_SIZE) {
+		// enough space for the next packet, re-arm the OUT endpoint
+		primask_bit = __get_PRIMASK();
+		__disable_irq();
+		CDC_RxNAK = FALSE;
+		USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+		__set_PRIMASK(primask_bit);
+	}
+	return c;
+}
+
+
+/**
+ *  @brief
+ *		Puts the received packet into the Rx ring buffer. Called by the
+ *      USB ISR (CDC_Receive_FS()).
+ *  @param[in]
+ *      buffer  received packet
+ *  @param[in]
+ *      length  packet length
+ *  @return
+ *      TRUE if there is space for the next packet (re-arm the OUT endpoint)
+ */
+int CDC_receive(const uint8_t *buffer, uint32_t length) {
+	uint32_t i;
+	uint32_t head = CDC_RxHead;
+
+	for (i=0; i<length; i++) {
+		if ((head + 1) % CDC_RX_BUFFER_LENGTH == CDC_RxTail) {
+			// full, should not happen (NAK)
+			break;
+		}
+		CDC_RxBuffer[head] = buffer[i];
+		head = (head + 1) % CDC_RX_BUFFER_LENGTH;
+	}
+	CDC_RxHead = head;
+	osSemaphoreRelease(CDC_RxSemaphoreID);
+
+	if (CDC_RX_BUFFER_LENGTH - 1 - cdc_rxCount() < CDC_DATA_FS_MAX_PACKET_SIZE) {
+		// no space for another packet, NAK till CDC_getc() has made room
+		CDC_RxNAK = TRUE;
+		return FALSE;
+	}
+	return TRUE;
 }
 
 
@@ -150,7 +266,7 @@ int CDC_getc(void) {
  *		TRUE if a character has been received.
  */
 int CDC_RxReady(void) {
-	if (osMessageQueueGetCount(CDC_RxQueueId) == 0) {
+	if (cdc_rxCount() == 0 && osMessageQueueGetCount(CDC_KeyQueueId) == 0) {
 		return FALSE;
 	} else {
 		return TRUE;
@@ -160,31 +276,110 @@ int CDC_RxReady(void) {
 
 /**
  *  @brief
- *      Writes a char to the USB CDC Tx (serial out). Blocking until char can be
- *      written into the queue.
+ *      Writes a char to the USB CDC Tx (serial out). Blocking only if the
+ *      ring buffer is full.
  *  @param[in]
  *      c  char to write
  *  @return
  *      Return EOF on error, 0 on success.
  */
 int CDC_putc(int c) {
-	if (osMessageQueuePut(CDC_TxQueueId, &c, 0, osWaitForever) == osOK) {
-		return 0;
-	} else {
-		Error_Handler();
-		return EOF;
+	uint32_t primask_bit;
+	uint32_t next;
+	int was_empty;
+
+	for (;;) {
+		primask_bit = __get_PRIMASK();
+		__disable_irq();
+		next = (CDC_TxHead + 1) % CDC_TX_BUFFER_LENGTH;
+		if (next != CDC_TxTail) {
+			was_empty = (CDC_TxHead == CDC_TxTail);
+			CDC_TxBuffer[CDC_TxHead] = (uint8_t) c;
+			CDC_TxHead = next;
+			__set_PRIMASK(primask_bit);
+			if (was_empty) {
+				// wake up the CDC thread
+				osThreadFlagsSet(CDC_ThreadID, CDC_TX_DATA);
+			}
+			return 0;
+		}
+		__set_PRIMASK(primask_bit);
+
+		// buffer full, blocked till the CDC thread has taken a packet
+		if (osSemaphoreAcquire(CDC_TxSemaphoreID, osWaitForever) != osOK) {
+			Error_Handler();
+			return EOF;
+		}
 	}
 }
 
 
 /**
  *  @brief
- *      Tx queue ready for next char.
+ *      Writes a buffer to the USB CDC Tx (serial out). The buffer is copied
+ *      in contiguous chunks into the ring buffer, blocking only if the ring
+ *      buffer is full.
+ *  @param[in]
+ *      buffer  data to write
+ *  @param[in]
+ *      length  number of bytes to write
+ *  @return
+ *      Return EOF on error, number of bytes written on success.
+ */
+int CDC_write(const char *buffer, int length) {
+	uint32_t primask_bit;
+	uint32_t head;
+	uint32_t tail;
+	int count;
+	int written = 0;
+
+	while (written < length) {
+		primask_bit = __get_PRIMASK();
+		__disable_irq();
+		head = CDC_TxHead;
+		tail = CDC_TxTail;
+		// free contiguous space, one byte is always left empty
+		if (head >= tail) {
+			count = CDC_TX_BUFFER_LENGTH - head;
+			if (tail == 0) {
+				count--;
+			}
+		} else {
+			count = tail - head - 1;
+		}
+		if (count > length - written) {
+			count = length - written;
+		}
+		if (count > 0) {
+			memcpy(&CDC_TxBuffer[head], &buffer[written], count);
+			CDC_TxHead = (head + count) % CDC_TX_BUFFER_LENGTH;
+			written += count;
+		}
+		__set_PRIMASK(primask_bit);
+
+		if (count > 0) {
+			// wake up the CDC thread
+			osThreadFlagsSet(CDC_ThreadID, CDC_TX_DATA);
+		} else {
+			// buffer full, blocked till the CDC thread has taken a packet
+			if (osSemaphoreAcquire(CDC_TxSemaphoreID, osWaitForever) != osOK) {
+				Error_Handler();
+				return EOF;
+			}
+		}
+	}
+	return written;
+}
+
+
+/**
+ *  @brief
+ *      Tx buffer ready for next char.
  *  @return
  *      FALSE if the buffer is full.
  */
 int CDC_TxReady(void) {
-	if (osMessageQueueGetSpace(CDC_TxQueueId) > 0) {
+	if ((CDC_TxHead + 1) % CDC_TX_BUFFER_LENGTH != CDC_TxTail) {
 		return TRUE;
 	} else {
 		return FALSE;
@@ -192,6 +387,17 @@ int CDC_TxReady(void) {
 }
 
 
+/**
+ *  @brief
+ *      Free space in the Tx buffer.
+ *  @return
+ *      Number of chars that can be written without blocking.
+ */
+int CDC_TxFree(void) {
+	return (CDC_TxTail + CDC_TX_BUFFER_LENGTH - CDC_TxHead - 1) % CDC_TX_BUFFER_LENGTH;
+}
+
+
 /**
  *  @brief
  *      Writes a char direct into the key queue.
@@ -207,8 +413,10 @@ int CDC_putkey(const char c) {
 		// eat CR
 		return 0;
 	}
-	status = osMessageQueuePut(CDC_RxQueueId, &c, 0, osWaitForever);
+	status = osMessageQueuePut(CDC_KeyQueueId, &c, 0, osWaitForever);
 	if (status == osOK) {
+		// wake up a blocked reader
+		osSemaphoreRelease(CDC_RxSemaphoreID);
 		return 0;
 	} else {
 		Error_Handler();
@@ -229,34 +437,81 @@ int CDC_putkey(const char c) {
   * 	None
   */
 static void cdc_thread(void *argument) {
-	uint8_t buffer;
+	uint8_t *packet;
+	int packet_index = 0;
+	int count;
+	int len;
 	uint8_t return_value;
 
-	// blocked till USB_CDC is connected
-	osEventFlagsWait(CDC_EvtFlagsID, CDC_CONNECTED, osFlagsWaitAny, osWaitForever);
-	osDelay(2000);
-
 	// Infinite loop
 	for(;;) {
-		// blocked till a character is in the Tx queue
-		if (osMessageQueueGet(CDC_TxQueueId, &buffer, 0, osWaitForever) == osOK) {
-			// blocked till CDC transmit ready
-			osEventFlagsWait(CDC_EvtFlagsID, CDC_TX_READY,
+		count = cdc_txCount();
+		if (count == 0) {
+			// blocked till a character is in the Tx buffer
+			osThreadFlagsWait(CDC_TX_DATA, osFlagsWaitAny, osWaitForever);
+			continue;
+		}
+		if (! (osEventFlagsGet(CDC_EvtFlagsID) & CDC_DTR)) {
+			// blocked till a terminal program opens the port (DTR), the
+			// buffered output is sent in full packets afterwards
+			osEventFlagsWait(CDC_EvtFlagsID, CDC_DTR,
 					osFlagsWaitAny | osFlagsNoClear, osWaitForever);
-			// send the character
-			return_value = CDC_Transmit_FS(&buffer, 1);
-			if (return_value == USBD_FAIL) {
-				// can't send char
-				Error_Handler();
-			} else if (return_value == USBD_BUSY) {
-				// transmit busy
-				Error_Handler();
-			}
+			continue;
+		}
+		if (count < CDC_TX_PACKET_SIZE) {
+			// give the producer some time to fill the packet
+			osDelay(CDC_TX_FLUSH_TIME);
+			count = cdc_txCount();
+		}
+
+		// fill the free packet buffer, the other one can be in flight
+		len = count < CDC_TX_PACKET_SIZE ? count : CDC_TX_PACKET_SIZE;
+		packet = &UserTxBufferFS[packet_index * CDC_TX_PACKET_SIZE];
+		if (CDC_TxTail + len > CDC_TX_BUFFER_LENGTH) {
+			// wrap around
+			count = CDC_TX_BUFFER_LENGTH - CDC_TxTail;
+			memcpy(packet, &CDC_TxBuffer[CDC_TxTail], count);
+			memcpy(&packet[count], CDC_TxBuffer, len - count);
 		} else {
-			// can't write to the queue
+			memcpy(packet, &CDC_TxBuffer[CDC_TxTail], len);
+		}
+		CDC_TxTail = (CDC_TxTail + len) % CDC_TX_BUFFER_LENGTH;
+		osSemaphoreRelease(CDC_TxSemaphoreID);
+
+		// blocked till CDC transmit ready (previous packet sent)
+		osEventFlagsWait(CDC_EvtFlagsID, CDC_TX_READY,
+				osFlagsWaitAny | osFlagsNoClear, osWaitForever);
+		// send the packet
+		return_value = CDC_Transmit_FS(packet, len);
+		if (return_value == USBD_FAIL) {
+			// can't send packet
+			Error_Handler();
+		} else if (return_value == USBD_BUSY) {
+			// transmit busy
 			Error_Handler();
 		}
+		packet_index ^= 1;
 	}
 }
 
 
+/**
+  * @brief
+  * 	Number of characters in the Tx ring buffer.
+  * @retval
+  * 	Number of characters
+  */
+static int cdc_txCount(void) {
+	return (CDC_TxHead + CDC_TX_BUFFER_LENGTH - CDC_TxTail) % CDC_TX_BUFFER_LENGTH;
+}
+
+
+/**
+  * @brief
+  * 	Number of characters in the Rx ring buffer.
+  * @retval
+  * 	Number of characters
+  */
+static int cdc_rxCount(void) {
+	return (CDC_RxHead + CDC_RX_BUFFER_LENGTH - CDC_RxTail) % CDC_RX_BUFFER_LENGTH;
+}
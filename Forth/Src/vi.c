@@ -3774,22 +3774,14 @@ static void emit(char c) {
 
 
 static ssize_t write_term(const void *buf, size_t nbyte) {
-	const char *buf_p;
-	int i;
-
-	buf_p = buf;
-	for (i=0; i<nbyte; i++) {
-		emit(*(buf_p+i));
-	}
+	// bulk output through hook-type
+	stack = FS_type(stack, (uint8_t*)buf, nbyte);
 	return nbyte;
 }
 
 
 static int puts_term(const char *s) {
-	int i;
-	for (i=0; i < strlen(s); i++) {
-		emit(*(s+i));
-	}
+	stack = FS_type(stack, (uint8_t*)s, strlen(s));
 	return 0;
 }
 
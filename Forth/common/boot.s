@@ -24,10 +24,26 @@
    movs r1, #0    @ Clear constant folding pointer
    str r1, [r0]
 
+  .ifdef registercache
+   ldr r0, =Registercache
+   str r1, [r0]   @ Register cache off
+   ldr r0, =Registercachetiefe
+   str r1, [r0]
+  .endif
+
+  .ifdef peephole
+   ldr r0, =Peepholeart
+   str r1, [r0]   @ Nothing compiled to optimise
+  .endif
+
   .ifdef registerallocator
     bl init_register_allocator
   .endif
 
+  .ifdef hashfind
+    bl hashfind_init
+  .endif
+
    @ Suche nach der init-Definition:
    @ Search for current init definition in dictionary:
    pushdatos
@@ -153,6 +153,15 @@ Sucheflashpointer_Speicherbelegung_fertig:
   @ Suche jetzt gleich noch den DictionaryPointer.
   @ Time to search the Dictionarypointer !
 
+  .ifdef dicttail
+  @ Dictionarypointer from the tail record written by smudge, see dict.c
+  ldr r0, =ZweitFadenende
+  ldr r0, [r0]
+  bl DICT_loadTail
+  cmp r0, #0
+  bne.n 3f @ Valid record, no need to scan the free flash.
+  .endif
+
   ldr r0, =FlashDictionaryEnde
   ldr r1, =FlashDictionaryAnfang
   ldr r2, =erasedhalfword
@@ -171,7 +180,15 @@ Sucheflashpointer_Speicherbelegung_fertig:
   adds r0, #2
 
 2:@ Dictionarypointer gefunden. Found DictionaryPointer.
-  ldr r1, =ZweitDictionaryPointer @ We start to compile into RAM - the pointer found goes to the second set of pointers that are swapped with compiletoflash/compiletoram.
+  .ifdef dicttail
+  push {r0, r1}
+  ldr r1, =ZweitFadenende
+  ldr r1, [r1]
+  bl DICT_saveTail @ The next start finds it without scanning.
+  pop {r0, r1}
+  .endif
+
+3:ldr r1, =ZweitDictionaryPointer @ We start to compile into RAM - the pointer found goes to the second set of pointers that are swapped with compiletoflash/compiletoram.
   str r0, [r1]
 
   .ifdef initflash
@@ -89,6 +89,20 @@ smudge:
       bl flushflash
     .endif
 
+    .ifdef hashfind
+      ldr r0, =Fadenende @ Die Definition ist jetzt sichtbar.  Definition is visible now, add it to the hash index.
+      ldr r0, [r0]
+      bl DICT_insert
+    .endif
+
+    .ifdef dicttail
+      ldr r0, =Dictionarypointer @ Für den nächsten Start merken.  Record the pointers for the next start.
+      ldr r0, [r0]
+      ldr r1, =Fadenende
+      ldr r1, [r1]
+      bl DICT_saveTail
+    .endif
+
     pop {pc}
 
   @ -----------------------------------------------------------------------------
@@ -147,6 +161,12 @@ setflags_ram:
 2:
 
   strh r1, [r0]
+
+  .ifdef hashfind
+    subs r0, #4   @ Header ist jetzt sichtbar.  Header is visible now, add it to the hash index.
+    bl DICT_insert
+  .endif
+
   pop {pc}
 
  .ltorg
@@ -479,6 +499,10 @@ allot_ok: @ Alles paletti, es ist noch Platz da !  Everything is fine, just allo
     ldr r0, =Fadenende
     ldr r1, =CoreDictionaryAnfang
     str r1, [r0]
+
+  .ifdef hashfind
+    bl DICT_forgetRam
+  .endif
   pop {pc}
 
 @ -----------------------------------------------------------------------------
@@ -1054,6 +1078,77 @@ skipstring: @ Überspringt einen String, dessen Adresse in r0 liegt.  Skip strin
 
 
 .ifdef registerallocator
+  .equ hookfind, 1
+.endif
+
+.ifdef hashfind
+  .equ hookfind, 1
+
+@ -----------------------------------------------------------------------------
+hashfind_init: @ Baut den Hash-Index aus dem Flash-Dictionary auf.  Builds the hash index from the Flash dictionary after Reset.
+               @ Das Ram-Dictionary ist nach dem Reset leer.          RAM dictionary is empty after Reset.
+@ -----------------------------------------------------------------------------
+  push {lr}
+  bl DICT_init
+
+  pushdatos
+  ldr tos, =CoreDictionaryAnfang
+
+1:ldrh r1, [tos, #4] @ Fetch Flags to see if this definition is visible.
+  ldr r0, =Flag_invisible
+  cmp r0, r1
+  beq 2f
+    movs r0, tos
+    bl DICT_insert
+
+2:bl dictionarynext
+  popda r0
+  beq 1b
+
+  drop
+  pop {pc}
+
+@ -----------------------------------------------------------------------------
+  Wortbirne Flag_visible, "hash-find"
+hash_find: @ ( address length -- Code-Adresse Flags )
+           @ Sucht im Hash-Index, bei vollem Index linear.  Search the hash index, linear search if the index is full.
+@ -----------------------------------------------------------------------------
+  push {lr}
+
+  movs r1, tos  @ Length
+  ldr r0, [psp] @ Address
+
+  ldr r2, =Dictionarypointer @ Compiling into RAM ? RAM definitions are searched first.
+  ldr r2, [r2]
+  ldr r3, =Backlinkgrenze
+  cmp r2, r3
+  bhs 1f
+    movs r2, #0
+    b 2f
+1:  movs r2, #1
+2:
+  bl DICT_find
+
+  adds r1, r0, #1 @ DICT_UNKNOWN ?
+  bne 3f
+    bl core_find @ Index voll.  Index is full, linear search.
+    pop {pc}
+
+3:cmp r0, #0
+  bne 4f
+    movs tos, #0  @ Nicht gefunden.  Not found.
+    str tos, [psp]
+    pop {pc}
+
+4:ldrh tos, [r0, #4] @ Flags
+  adds r0, #6        @ Skip Link and Flags
+  bl skipstring
+  str r0, [psp]      @ Code start address
+  pop {pc}
+
+.endif
+
+.ifdef hookfind
 
 @ -----------------------------------------------------------------------------
   Wortbirne Flag_visible, "find"
@@ -1070,7 +1165,11 @@ find: @ ( address length -- Code-Adresse Flags )
   pushdatos
   ldr tos, =hook_find
   bx lr
+.ifdef hashfind
+  .word hash_find
+.else
   .word core_find
+.endif
 
 @ -----------------------------------------------------------------------------
   Wortbirne Flag_visible, "(find)"
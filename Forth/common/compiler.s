@@ -167,7 +167,16 @@ retkomma: @ Write pop {pc} opcode
   Wortbirne Flag_immediate_compileonly, "exit" @ Kompiliert ein ret mitten in die Definition.
   @ Writes a ret opcode into current definition. Take care with inlining !
 @------------------------------------------------------------------------------
+  .ifdef peephole
+  push {lr}
+  bl peephole_endsprung @ bl x exit  ->  pop {lr} b x
+  cmp r0, #0
+  bne 1f
+    bl retkomma
+1:pop {pc}
+  .else
   b.n retkomma
+  .endif
 
 @ Some tests:
 @  : fac ( n -- n! )   1 swap  1 max  1+ 2 ?do i * loop ;
@@ -217,6 +226,18 @@ retkomma: @ Write pop {pc} opcode
 
   bl create
 
+  .ifdef registercache
+    ldr r0, =Registercachetiefe
+    movs r1, #0 @ Neue Definition: Registercache leer  New definition, register cache empty
+    str r1, [r0]
+  .endif
+
+  .ifdef peephole
+    bl peephole_vergessen @ Neue Definition  New definition, no call to optimise
+    ldr r0, =Peepholeschluss
+    movs r1, #0 @ Noch kein Endsprung  No tail call yet
+    str r1, [r0]
+  .endif
 
   .ifdef registerallocator
 
@@ -291,6 +312,14 @@ retkomma: @ Write pop {pc} opcode
 3:   @ Doch ein pop {pc} ? Dann war wohl etwas enthalten, was nicht durch inline laufen darf.
   .endif
 
+  .ifdef peephole
+  bl peephole_endsprung @ Endsprung statt bl und pop {pc}  Tail call, pop {pc} stays as end of definition
+  .endif
+
+  .ifdef autoinline
+  bl autoinline_pruefen @ Kurze Definitionen inline markieren  Short definitions get the inline flag
+  .endif
+
   pushdaconstw 0xbd00 @ Opcode für pop {pc} schreiben  Write opcode for pop {pc}
   bl hkomma
   
@@ -319,6 +348,14 @@ execute:
   Wortbirne Flag_immediate|Flag_foldable_0, "inline" @ ( -- )
 setze_inlineflag:
 @ -----------------------------------------------------------------------------
+  .ifdef peephole
+  ldr r0, =Peepholeschluss @ Endsprünge sind relativ und holen die Rücksprungadresse.
+  ldr r0, [r0]             @ Tail calls are relative and pop the return address.
+  cmp r0, #0
+  beq 1f
+    Fehler_Quit "Tail call, can't be inline."
+1:
+  .endif
   pushdaconst Flag_inline & ~Flag_visible
   b.n setflags
 
@@ -66,6 +66,10 @@
 tos .req r6
 psp .req r7
 
+@ Mit registercache halten kompilierte Definitionen Stackelemente unter TOS in r8-r11.
+@ With registercache compiled definitions keep stack elements below TOS in r8-r11,
+@ see registercache.s
+
 @ -----------------------------------------------------------------------------
 @ Datenstack-Makros
 @ Macros for Datastack
@@ -19,6 +19,11 @@
 @ Emulation for hflash! to circumvent problems with 8-Byte-ECC Flash
 @ 16-Bit Flash writes are collected here to be written later as 8 Byte blocks
 
+@ With flashrowwrite the writes are collected in row buffers first (FLASH_rowStore),
+@ complete rows are written at once. The table takes the writes to a row which
+@ slot is used by another row. Sammelbelegt counts the used table entries, the
+@ table is only searched if it is not empty.
+
 @ Einfügen im Hauptteil:  
 @ .equ Sammelstellen, 32 @ 32 * (8 + 4) = 384 Bytes
 @ ramallot Sammeltabelle, Sammelstellen * 12 @ Buffer 32 blocks of 8 bytes each for ECC constrained Flash write
@@ -37,7 +42,15 @@ initflash: @ ( -- ) Löscht alle Einträge in der Sammeldatei
   subs r1, #1
   bne 1b
 
-  bx lr
+  .ifdef flashrowwrite
+    ldr r0, =Sammelbelegt
+    str r2, [r0]
+    push {lr}
+    bl FLASH_rowInit
+    pop {pc}
+  .else
+    bx lr
+  .endif
 
   .ifdef debug
 @ -----------------------------------------------------------------------------
@@ -119,6 +132,15 @@ h_flashkomma: @ ( x addr -- ) Fügt einen Eintrag in die Tabelle ein und brennt
 
   lsrs r3, r2, #3 @ Prepare address for crawling by removing low bits
 
+  .ifdef flashrowwrite
+    @ Tabelle leer: Direkt in den Zeilenpuffer.
+    @ Table empty: Straight to the row buffer.
+    ldr r0, =Sammelbelegt
+    ldr r0, [r0]
+    cmp r0, #0
+    beq 5f
+  .endif
+
   ldr r0, =Sammeltabelle
   movs r1, #Sammelstellen
 
@@ -134,6 +156,22 @@ h_flashkomma: @ ( x addr -- ) Fügt einen Eintrag in die Tabelle ein und brennt
   subs r1, #1
   bne 2b
 
+  .ifdef flashrowwrite
+    @ Nicht gefunden: In den Zeilenpuffer, falls dessen Platz frei ist.
+    @ Not found. Collect it in the row buffer if its slot is free.
+5:  movs r4, r2      @ Keep address, C clobbers r0-r3
+    movs r0, r2      @ Address
+    movs r1, tos     @ Halfword
+    bl FLASH_rowStore
+    cmp r0, #0
+    beq 4f
+      drop
+      b.n hflashstoreemulation_fertig
+
+4:  movs r2, r4
+    lsrs r3, r2, #3 @ Prepare address for crawling by removing low bits
+  .endif
+
   @ Nicht gefunden: Suche eine leere Stelle in der Tabelle !
   @ Not found. Search for an empty place in table to fill this request in
 
@@ -166,6 +204,13 @@ hflashstoreemulation_leerestelle:
   str r1, [r0, #4]
   str r1, [r0, #8]
 
+  .ifdef flashrowwrite
+    ldr r1, =Sammelbelegt
+    ldr r4, [r1]
+    adds r4, #1
+    str r4, [r1]
+  .endif
+
 hflashstoreemulation_gefunden: @ Found !
 @  writeln "Einfügen"
   @ r0 zeigt auf den passenden Tabelleneintrag.
@@ -222,6 +267,10 @@ flushflash:
   subs r1, #1
   bne 2b
 
+  .ifdef flashrowwrite
+    bl FLASH_rowFlush
+  .endif
+
   pop {pc}
 
 @ -----------------------------------------------------------------------------
@@ -240,4 +289,11 @@ flushblock: @ Put a table entry which address is in r0 on data stack for later 1
 
   movs r2, #0  @ Clear table entry
   str r2, [r0] 
+
+  .ifdef flashrowwrite
+    ldr r2, =Sammelbelegt
+    ldr r3, [r2]
+    subs r3, #1
+    str r3, [r2]
+  .endif
   bx lr
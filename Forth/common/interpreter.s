@@ -147,6 +147,13 @@ interpret:
     cmp r2, #0 @ Did number recognize the string ?
     bne.n 1b   @ Zahl gefunden, alles gut. Interpretschleife fortsetzen.  Finished.
 
+  .ifdef floatingpoint
+    bl fpu_zahl @ Fließkommazahl ?  Float literal like 1.5e3 ?
+    popda r2
+    cmp r2, #0
+    bne.n 1b
+  .endif
+
     @ Number mochte das Token auch nicht.
 not_found_addr_r0_len_r1:
     pushda r0
@@ -251,6 +258,16 @@ not_found_addr_r0_len_r1:
     @ Write all folding constants left into dictionary.
 
 .konstantenschleife:
+  .ifdef registercache
+    bl registercache_kompilieren @ Stack juggling with the cached elements in registers ?
+    cmp r0, #0
+    bne 1b @ Finished.
+  .endif
+  .ifdef peephole
+    bl peephole_literal @ Last constant directly into TOS for a binary operator ?
+    cmp r0, #0
+    bne 1b @ Finished.
+  .endif
     bl konstantenschreiben
 
 @ -----------------------------------------------------------------------------
@@ -262,16 +279,27 @@ not_found_addr_r0_len_r1:
   beq.n 6f
     @ Es ist immediate. Immer ausführen. Always execute immediate definitions.
     bl execute @ Ausführen.
+  .ifdef peephole
+    bl peephole_vergessen @ then, begin ... may have marked a jump target.
+  .endif
     b.n 1b @ Zurück in die Interpret-Schleife.  Finished.
 
 6:movs r2, #Flag_inline & ~Flag_visible
   ands r2, r1
   beq.n 7f
 
+  .ifdef peephole
+  bl peephole_inlinekomma @ Einfügen, überflüssige Stackjonglage entfernen  Inline, remove redundant stack juggling
+  .else
   bl inlinekomma @ Direkt einfügen.        Inline the code
+  .endif
   b.n 1b @ Zurück in die Interpret-Schleife  Finished.
 
+  .ifdef peephole
+7:bl peephole_callkomma @ Einkompilieren und für Endsprung merken  Compile a call, remember it for a tail call
+  .else
 7:bl callkomma @ Klassisch einkompilieren  Simply compile a BL or Call.
+  .endif
   b.n 1b @ Zurück in die Interpret-Schleife  Finished.
 
 
@@ -444,6 +472,11 @@ not_found_addr_r0_len_r1:
 .interpret_opcodierbar_speicherschreiben:
   cmp r1, #5
   bne.n .interpret_opcodierbar_andere
+
+    .ifdef registercache
+    bl registercache_leeren @ The inlined code takes its operands from the data stack
+    .endif
+
     @------------------------------------------------------------------------------
     @ Write memory
 
@@ -508,6 +541,10 @@ not_found_addr_r0_len_r1:
   @ Special cases that do not have their own handling in interpret.
   @ They have their own handlers at the end of definition that is called here.
 
+  .ifdef registercache
+  bl registercache_leeren
+  .endif
+
   adds r0, #1 @ One more for Thumb
   blx r0
   b.n 1b @ Finished.
@@ -595,6 +632,18 @@ quit:
   @ movs r1, #0  @ Clear constant folding pointer
   str r1, [r0]
 
+  .ifdef registercache
+  ldr r0, =Registercachetiefe
+  @ movs r1, #0  @ Register cache empty
+  str r1, [r0]
+  .endif
+
+  .ifdef peephole
+  ldr r0, =Peepholeart
+  @ movs r1, #0  @ Nothing compiled to optimise
+  str r1, [r0]
+  .endif
+
   ldr r0, =Pufferstand
   @ movs r1, #0  @ Set >IN to 0
   str r1, [r0]
@@ -96,9 +96,17 @@ irq_vektor_\Name:
     movt r0, #:upper16:irq_hook_\Name
   .endif
 
+  .ifdef registercache
+  push {r8-r11, lr} @ Register cache of the interrupted definition, see registercache.s
+  ldr r0, [r0]
+  orr r0, #1    @ Thumb
+  blx r0
+  pop {r8-r11, pc}
+  .else
   ldr r0, [r0]  @ Cannot ldr to PC directly, as this would require bit 0 to be set accordingly.
   mov pc, r0    @ No need to make bit[0] uneven as 16-bit Thumb "mov" to PC ignores bit 0.
   @ Angesprungene Routine kehrt von selbst zurück...   Code returns itself
+  .endif
 
 @ 3.6.1 ARM-Thumb interworking
 @       Thumb interworking uses bit[0] on a write to the PC to determine the CPSR T bit. For 16-bit instructions,
@@ -130,9 +138,17 @@ irq_vektor_\Name:
     movt r0, #:upper16:irq_hook_\Name
   .endif
 
+  .ifdef registercache
+  push {r8-r11, lr} @ Register cache of the interrupted definition, see registercache.s
+  ldr r0, [r0]
+  orr r0, #1    @ Thumb
+  blx r0
+  pop {r8-r11, pc}
+  .else
   ldr r0, [r0]  @ Cannot ldr to PC directly, as this would require bit 0 to be set accordingly.
   mov pc, r0    @ No need to make bit[0] uneven as 16-bit Thumb "mov" to PC ignores bit 0.
   @ Angesprungene Routine kehrt von selbst zurück...   Code returns itself
+  .endif
 
 .endm
 
@@ -393,7 +393,7 @@ zifferstringende:  @ Schließt einen neuen Ziffernstring ab und gibt seine Adres
   bx lr
 
 @------------------------------------------------------------------------------
-  Wortbirne Flag_visible, "f#S"
+  Wortbirne Flag_visible, "x#S"
 falleziffern: @ ( u -- u=0 )
       @ Inserts all digits, at least one, into number buffer.
 @------------------------------------------------------------------------------
@@ -407,7 +407,7 @@ falleziffern: @ ( u -- u=0 )
   pop {r4, pc}
 
 @------------------------------------------------------------------------------
-  Wortbirne Flag_visible, "f#"
+  Wortbirne Flag_visible, "x#"
 fziffer: @ ( u -- u )
       @ Insert one more digit into number buffer
 @------------------------------------------------------------------------------
@@ -479,7 +479,7 @@ zifferstringanfang: @ Eröffnet einen neuen Ziffernstring.
   bx lr
 
 @------------------------------------------------------------------------------
-  Wortbirne Flag_visible, "f."
+  Wortbirne Flag_visible, "x."
       @ ( Low High -- )
       @ Prints a s31.32 number
 @------------------------------------------------------------------------------
@@ -487,7 +487,7 @@ zifferstringanfang: @ Eröffnet einen neuen Ziffernstring.
   b.n fdotn
 
 @------------------------------------------------------------------------------
-  Wortbirne Flag_visible, "f.n"
+  Wortbirne Flag_visible, "x.n"
       @ ( Low High n -- )
       @ Prints a s31.32 number with given number of fractional digits
 fdotn:
@@ -288,8 +288,8 @@ type: @ ( str -- ) Gibt einen String aus  Print a counted string
 
 
 @ -----------------------------------------------------------------------------
-  Wortbirne Flag_visible, "type"
-stype:  @ ( addr len -- ) Gibt einen String aus  Print a string
+  Wortbirne Flag_visible, "emit-type"
+emit_type:  @ ( addr len -- ) Gibt einen String mit emit aus  Print a string char by char
 @ -----------------------------------------------------------------------------
   push {r0, lr}
   ldm psp!, {r0}  @ Adresse holen. Fetch address.
@@ -95,6 +95,25 @@
 .endif
 .endif
 
+@------------------------------------------------------------------------------
+  Wortbirne Flag_visible|Flag_variable, "hook-type" @ ( -- addr )
+  CoreVariable hook_type
+@------------------------------------------------------------------------------
+	pushdatos
+	ldr		tos, =hook_type
+	bx		lr
+.if	DEFAULT_TERMINAL == UART_TERMINAL
+	.word	serial_type		// Serial (UART) for terminal
+.else
+.if DEFAULT_TERMINAL == CDC_TERMINAL
+	.word	cdc_type		// USB CDC for terminal
+.else
+.if	DEFAULT_TERMINAL == CRS_TERMINAL
+	.word	crs_type		// BLE CRS for terminal
+.endif
+.endif
+.endif
+
 @------------------------------------------------------------------------------
   Wortbirne Flag_visible|Flag_variable, "hook-pause" @ ( -- addr )
   CoreVariable hook_pause
@@ -123,6 +142,15 @@ key:
 	bl		hook_intern
 	pop		{r0, r1, r2, r3, pc}
 
+@------------------------------------------------------------------------------
+  Wortbirne Flag_visible, "type" @ ( addr len -- )
+stype:
+@------------------------------------------------------------------------------
+	push	{r0, r1, r2, r3, lr} @ Used in core, registers have to be saved !
+	ldr		r0, =hook_type
+	bl		hook_intern
+	pop		{r0, r1, r2, r3, pc}
+
 @------------------------------------------------------------------------------
   Wortbirne Flag_visible, "emit?" @ ( -- ? )
 qemit:
@@ -168,6 +196,10 @@ uart_terminal:
 	ldr		r1, =serial_qkey
 	ldr		r0, =hook_qkey
 	str		r1, [r0]
+
+	ldr		r1, =serial_type
+	ldr		r0, =hook_type
+	str		r1, [r0]
 	bx		lr
 
 @------------------------------------------------------------------------------
@@ -190,6 +222,10 @@ cdc_terminal:
 	ldr		r1, =cdc_qkey
 	ldr		r0, =hook_qkey
 	str		r1, [r0]
+
+	ldr		r1, =cdc_type
+	ldr		r0, =hook_type
+	str		r1, [r0]
 	bx		lr
 
 @------------------------------------------------------------------------------
@@ -212,9 +248,46 @@ crs_terminal:
 	ldr		r1, =crs_qkey
 	ldr		r0, =hook_qkey
 	str		r1, [r0]
+
+	ldr		r1, =crs_type
+	ldr		r0, =hook_type
+	str		r1, [r0]
 	bx		lr
 
 
+@------------------------------------------------------------------------------
+  Wortbirne Flag_visible, "tee" @ ( u1 u2 -- )
+  @ Console output to the sinks u1 (1 UART, 2 CDC, 4 CRS, or'ed), the sinks in
+  @ u2 drop chars if their buffer is full, the others block. u1 must not be 0.
+  @ uart, cdc or crs end the tee.
+@------------------------------------------------------------------------------
+.global		tee_terminal
+tee_terminal:
+	push	{lr}
+	ldr		r0, [psp]			// sinks
+	cmp		r0, #0
+	bne		1f				// no sinks, the console would be lost
+	Fehler_Quit " No tee sinks."
+1:
+	ldm		psp!, {r0}			// sinks
+	movs	r1, tos				// drop policy
+	drop
+	bl		TEE_set
+
+	ldr		r1, =tee_emit
+	ldr		r0, =hook_emit
+	str		r1, [r0]
+
+	ldr		r1, =tee_qemit
+	ldr		r0, =hook_qemit
+	str		r1, [r0]
+
+	ldr		r1, =tee_type
+	ldr		r0, =hook_type
+	str		r1, [r0]
+	pop		{pc}
+
+
 // Redirect emit to key
 //*********************
 
@@ -227,19 +300,21 @@ TERMINAL_redirect:
 	ldr		r0, [r0]
 	ldr		r1, =RedirectStore
 	str		r0, [r1]			// store old hook
-	ldr		r1, =cdc_emit
+	ldr		r0, =hook_key		// redirect to the key queue of the input terminal
+	ldr		r0, [r0]			// (emit could be the tee)
+	ldr		r1, =cdc_key
 	cmp		r0, r1
 	bne		1f
 	ldr		r1, =cdc_emit2key
 	b		3f
 1:
-	ldr		r1, =serial_emit
+	ldr		r1, =serial_key
 	cmp		r0, r1
 	bne		2f
 	ldr		r1, =serial_emit2key
 	b		3f
 2:
-//	ldr		r1, =crs_emit
+//	ldr		r1, =crs_key
 	ldr		r1, =crs_emit2key
 3:
 	ldr		r0, =hook_emit
@@ -321,6 +396,10 @@ hook_intern:
    ldr r0, =hook_qkey
    str r1, [r0]
 
+   ldr r1, =serial_type
+   ldr r0, =hook_type
+   str r1, [r0]
+
    ldr r1, =nop_vektor
    ldr r0, =hook_pause
    str r1, [r0]
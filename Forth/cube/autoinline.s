@@ -0,0 +1,185 @@
+/**
+ *  @brief
+ *      Automatic inlining of short definitions.
+ *
+ *      ; measures the code of the new definition (without push {lr} and
+ *      pop {pc}). If it is not longer than inline-limit bytes and can be
+ *      copied by inline, to another address, the definition gets the
+ *      inline flag. Accessors like
+ *
+ *          : field@ ( addr -- x ) 4 + @ ;
+ *
+ *      then compile to two opcodes instead of a bl.
+ *
+ *      Not inlined are definitions with
+ *      - calls and long jumps (bl, b.w, blx, bx)
+ *      - PC relative literals and addresses (ldr rX, [pc, #], adr)
+ *      - return stack access (push, pop, sp relative, r@ >r r> do loop)
+ *      - high registers, e.g. compiled with the register cache
+ *      - already immediate or inline definitions
+ *      - halfwords inline, would take as end of code (bx lr, pop {pc})
+ *
+ *      0 inline-limit ! switches off.
+ *  @file
+ *      autoinline.s
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: ARM Assembler, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible|Flag_variable, "inline-limit"
+		@ ( -- addr ) Definitions up to this code length in bytes are inlined
+		CoreVariable inline_limit
+@ -----------------------------------------------------------------------------
+	pushdatos
+	ldr		tos, =inline_limit
+	bx		lr
+	.word	12		// 6 opcodes
+
+
+@ -----------------------------------------------------------------------------
+autoinline_pruefen:
+	@ ( -- ) Called by ; before pop {pc}. Sets the inline flag for short
+	@ position independent definitions. Saves r0-r3.
+@ -----------------------------------------------------------------------------
+	push	{r0, r1, r2, r3, lr}
+
+	// flags of the new definition
+	ldr		r0, =Dictionarypointer
+	ldr		r0, [r0]			// end of code
+	ldr		r1, =Backlinkgrenze
+	cmp		r0, r1
+	bhs		1f
+	ldr		r1, =FlashFlags		// flash: collected until smudge
+	ldr		r1, [r1]
+	b		2f
+1:	ldr		r1, =Fadenende		// RAM: in the header, $FFFF none
+	ldr		r1, [r1]
+	ldrh	r1, [r1, #4]
+	movw	r2, #0xFFFF
+	cmp		r1, r2
+	bne		2f
+	movs	r1, #0
+2:	movs	r2, #Flag_immediate_compileonly & ~Flag_visible
+	tst		r1, r2
+	bne		9f					// already immediate or inline
+
+	// code length
+	ldr		r1, =Einsprungpunkt
+	ldr		r1, [r1]
+	ldrh	r2, [r1]
+	movw	r3, #0xB500			// push {lr}
+	cmp		r2, r3
+	bne		9f
+	adds	r1, #2
+	ldr		r3, =inline_limit
+	ldr		r3, [r3]
+	cmp		r3, #0
+	beq		9f					// off
+	subs	r2, r0, r1
+	cmp		r2, r3
+	bhi		9f					// too long
+
+	// r0: end, r1: opcode pointer
+3:	cmp		r1, r0
+	bhs		8f					// all opcodes position independent
+	ldrh	r2, [r1]
+	adds	r1, #2
+
+	movw	r3, #0xE800
+	cmp		r2, r3
+	bhs		4f					// 32 bit opcode
+
+	// 16 bit opcode
+	movw	r3, #0x4400			// hi register, bx, blx, ldr rX, [pc, #]
+	cmp		r2, r3
+	blo		3b
+	movw	r3, #0x5000
+	cmp		r2, r3
+	blo		9f
+	movw	r3, #0x9000			// sp relative, adr, add sp
+	cmp		r2, r3
+	blo		3b
+	movw	r3, #0xB100
+	cmp		r2, r3
+	blo		9f
+	lsrs	r3, r2, #9
+	cmp		r3, #0xB4 >> 1		// push
+	beq		9f
+	cmp		r3, #0xBC >> 1		// pop
+	beq		9f
+	b		3b
+
+	// 32 bit opcode: r2 first, r3 second halfword
+4:	cmp		r1, r0
+	bhs		9f
+	ldrh	r3, [r1]
+	adds	r1, #2
+	push	{r0}
+	movw	r0, #0xB500			// inline, ends or skips at these
+	cmp		r3, r0
+	beq		5f
+	movw	r0, #0xBD00
+	cmp		r3, r0
+	beq		5f
+	movw	r0, #0x4770
+	cmp		r3, r0
+	beq		5f
+
+	lsrs	r0, r2, #11
+	cmp		r0, #0xF000 >> 11
+	bne		6f
+	tst		r3, #0x8000			// b.w, bl and other branches
+	bne		5f
+	movw	r0, #0xFB5F			// i, add 0xF20F or sub 0xF2AF
+	ands	r0, r2
+	movw	r3, #0xF20F			// adr.w
+	cmp		r0, r3
+	beq		5f
+	b		7f
+
+6:	lsrs	r0, r2, #9			// load, store, vldr, vstr
+	cmp		r0, #0xE800 >> 9
+	beq		6f
+	cmp		r0, #0xEC00 >> 9
+	beq		6f
+	cmp		r0, #0xF800 >> 9
+	bne		7f
+6:	and		r0, r2, #0xF		// Rn sp or pc
+	cmp		r0, #13
+	beq		5f
+	cmp		r0, #15
+	beq		5f
+
+7:	pop		{r0}
+	b		3b
+
+5:	pop		{r0}
+	b		9f
+
+8:	pushdaconst Flag_inline & ~Flag_visible
+	bl		setflags
+
+9:	pop		{r0, r1, r2, r3, pc}
+
+.ltorg
@@ -239,3 +239,75 @@ pwmprescale:
 	pop		{r0-r3, pc}
 
 
+
+
+// BLE link parameters
+//********************
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "blemtu"
+ble_mtu:
+		@ ( -- u ) negotiated ATT MTU in bytes
+// int APP_BLE_getMTU(void)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	pushdatos
+	bl		APP_BLE_getMTU
+	movs	tos, r0
+	pop		{r0-r3, pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "bledatalength"
+ble_datalength:
+		@ ( -- u ) max. link layer payload in bytes (data length extension)
+// int APP_BLE_getDataLength(void)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	pushdatos
+	bl		APP_BLE_getDataLength
+	movs	tos, r0
+	pop		{r0-r3, pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "blephy"
+ble_phy:
+		@ ( -- u ) Tx PHY 1 1M, 2 2M, 3 coded
+// int APP_BLE_getPHY(void)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	pushdatos
+	bl		APP_BLE_getPHY
+	movs	tos, r0
+	pop		{r0-r3, pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "bleinterval"
+ble_interval:
+		@ ( -- u ) connection interval in us
+// int APP_BLE_getConnInterval(void)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	pushdatos
+	bl		APP_BLE_getConnInterval
+	movs	tos, r0
+	pop		{r0-r3, pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "bleinterval!"
+set_bleinterval:
+		@ ( u -- ) requests a connection interval in us (7500 to 4000000)
+// int APP_BLE_setConnInterval(int interval)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	movs	r0, tos		// interval
+	drop
+	bl		APP_BLE_setConnInterval
+	cmp		r0, #0		// BLE_STATUS_SUCCESS
+	beq		1f
+	writeln	"Err: not connected or interval not valid"
+1:	pop		{r0-r3, pc}
+
@@ -0,0 +1,291 @@
+/**
+ *  @brief
+ *      Vector words for arrays of 16 bit samples (Q15 or int16).
+ *
+ *      The loops use the DSP (SIMD) instructions of the Cortex-M4 and
+ *      process two samples per 32 bit load and store, an odd last sample
+ *      separately. The arrays must be halfword aligned, n is the number of
+ *      samples. Results are saturated to -32768 .. 32767.
+ *
+ *          v+      ( a1 a2 a3 n -- )     a3[i] = a1[i] + a2[i]
+ *          v-      ( a1 a2 a3 n -- )     a3[i] = a1[i] - a2[i]
+ *          v*q15   ( a1 a2 a3 n -- )     a3[i] = a1[i] * a2[i] >> 15
+ *          vscale  ( a1 q a2 n -- )      a2[i] = a1[i] * q >> 15
+ *          vdot    ( a1 a2 n -- d )      sum a1[i] * a2[i], 64 bit
+ *          vmax    ( a n -- x )          greatest sample
+ *          vfir    ( x h y n m -- )      y[i] = sum x[i+k] * h[k] >> 15
+ *
+ *      vfir computes n outputs with m taps, x has n+m-1 samples. The
+ *      coefficients h are stored in time reversed order (like CMSIS-DSP).
+ *      The accumulator has 64 bits (SMLALD), no overflow for long filters.
+ *
+ *      Example, moving average with 8 taps (8 * 4096 = 1.0) over an ADC
+ *      block of 127 samples:
+ *
+ *          create coeffs  4096 h, 4096 h, 4096 h, 4096 h,
+ *                         4096 h, 4096 h, 4096 h, 4096 h,
+ *          samples coeffs filtered 120 8 vfir
+ *  @file
+ *      dsp.s
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: ARM Assembler, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+
+// Element by element
+// ******************
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "v+"
+		@ ( a1 a2 a3 n -- ) a3[i] = a1[i] + a2[i] saturated
+@ -----------------------------------------------------------------------------
+dsp_vplus:
+	push	{r4, r5, lr}
+	movs	r3, tos
+	ldm		psp!, {r0, r1, r2, tos}	// a3 a2 a1
+
+1:	subs	r3, #2
+	blt		2f
+	ldr		r4, [r2], #4
+	ldr		r5, [r1], #4
+	qadd16	r4, r4, r5
+	str		r4, [r0], #4
+	b		1b
+
+2:	adds	r3, #2
+	cmp		r3, #1
+	bne		3f						// no odd sample
+	ldrsh	r4, [r2]
+	ldrsh	r5, [r1]
+	qadd16	r4, r4, r5
+	strh	r4, [r0]
+3:	pop		{r4, r5, pc}
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "v-"
+		@ ( a1 a2 a3 n -- ) a3[i] = a1[i] - a2[i] saturated
+@ -----------------------------------------------------------------------------
+dsp_vminus:
+	push	{r4, r5, lr}
+	movs	r3, tos
+	ldm		psp!, {r0, r1, r2, tos}	// a3 a2 a1
+
+1:	subs	r3, #2
+	blt		2f
+	ldr		r4, [r2], #4
+	ldr		r5, [r1], #4
+	qsub16	r4, r4, r5
+	str		r4, [r0], #4
+	b		1b
+
+2:	adds	r3, #2
+	cmp		r3, #1
+	bne		3f
+	ldrsh	r4, [r2]
+	ldrsh	r5, [r1]
+	qsub16	r4, r4, r5
+	strh	r4, [r0]
+3:	pop		{r4, r5, pc}
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "v*q15"
+		@ ( a1 a2 a3 n -- ) a3[i] = a1[i] * a2[i] >> 15 saturated
+@ -----------------------------------------------------------------------------
+dsp_vstarq15:
+	push	{r4, r5, lr}
+	movs	r3, tos
+	ldm		psp!, {r0, r1, r2, tos}	// a3 a2 a1
+
+1:	subs	r3, #2
+	blt		2f
+	ldr		r4, [r2], #4
+	ldr		r5, [r1], #4
+	smulbb	r12, r4, r5
+	smultt	r4, r4, r5
+	ssat	r12, #16, r12, asr #15
+	ssat	r4, #16, r4, asr #15
+	pkhbt	r4, r12, r4, lsl #16
+	str		r4, [r0], #4
+	b		1b
+
+2:	adds	r3, #2
+	cmp		r3, #1
+	bne		3f
+	ldrsh	r4, [r2]
+	ldrsh	r5, [r1]
+	smulbb	r4, r4, r5
+	ssat	r4, #16, r4, asr #15
+	strh	r4, [r0]
+3:	pop		{r4, r5, pc}
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "vscale"
+		@ ( a1 q a2 n -- ) a2[i] = a1[i] * q >> 15 saturated, q is Q15
+@ -----------------------------------------------------------------------------
+dsp_vscale:
+	push	{r4, lr}
+	movs	r3, tos
+	ldm		psp!, {r0, r1, r2, tos}	// a2 q a1
+
+1:	subs	r3, #2
+	blt		2f
+	ldr		r4, [r2], #4
+	smulbb	r12, r4, r1
+	smultb	r4, r4, r1
+	ssat	r12, #16, r12, asr #15
+	ssat	r4, #16, r4, asr #15
+	pkhbt	r4, r12, r4, lsl #16
+	str		r4, [r0], #4
+	b		1b
+
+2:	adds	r3, #2
+	cmp		r3, #1
+	bne		3f
+	ldrsh	r4, [r2]
+	smulbb	r4, r4, r1
+	ssat	r4, #16, r4, asr #15
+	strh	r4, [r0]
+3:	pop		{r4, pc}
+
+
+// Reductions
+// **********
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "vdot"
+		@ ( a1 a2 n -- d ) Dot product sum a1[i] * a2[i]
+@ -----------------------------------------------------------------------------
+dsp_vdot:
+	push	{r4, r5, lr}
+	movs	r3, tos
+	ldm		psp!, {r1, r2}			// a2 a1
+	movs	r4, #0					// low
+	movs	r5, #0					// high
+
+1:	subs	r3, #2
+	blt		2f
+	ldr		r0, [r2], #4
+	ldr		r12, [r1], #4
+	smlald	r4, r5, r0, r12
+	b		1b
+
+2:	adds	r3, #2
+	cmp		r3, #1
+	bne		3f
+	ldrsh	r0, [r2]
+	ldrsh	r12, [r1]
+	smlalbb	r4, r5, r0, r12
+
+3:	movs	tos, r4
+	pushdatos
+	movs	tos, r5
+	pop		{r4, r5, pc}
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "vmax"
+		@ ( a n -- x ) Greatest sample, -32768 for n = 0
+@ -----------------------------------------------------------------------------
+dsp_vmax:
+	push	{r4, lr}
+	movs	r3, tos
+	ldm		psp!, {r1}				// a
+	movw	r0, #0x8000				// maximum of the even and odd samples
+	movt	r0, #0x8000
+
+1:	subs	r3, #2
+	blt		2f
+	ldr		r4, [r1], #4
+	ssub16	r2, r4, r0				// GE flags for r4 >= r0
+	sel		r0, r4, r0
+	b		1b
+
+2:	adds	r3, #2
+	cmp		r3, #1
+	bne		3f
+	ldrsh	r4, [r1]
+	pkhbt	r4, r4, r4, lsl #16
+	ssub16	r2, r4, r0
+	sel		r0, r4, r0
+
+3:	sxth	r2, r0
+	asrs	r0, r0, #16
+	cmp		r2, r0
+	it		gt
+	movgt	r0, r2
+	movs	tos, r0
+	pop		{r4, pc}
+
+
+// Filter
+// ******
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "vfir"
+		@ ( x h y n m -- ) y[i] = sum x[i+k] * h[k] >> 15 saturated,
+		@ n outputs, m taps
+@ -----------------------------------------------------------------------------
+dsp_vfir:
+	push	{r4, r5, r8, r9, r10, r11, lr}
+	mov		r8, tos					// taps
+	ldm		psp!, {r0, r1, r2, r3, tos}	// n y h x
+
+1:	subs	r0, #1
+	blt		9f
+	movs	r4, #0					// accumulator low
+	movs	r5, #0					//             high
+	mov		r9, r3					// x[i]
+	mov		r10, r2					// h[0]
+	mov		r11, r8
+
+	// two taps per SMLALD
+2:	subs	r11, #2
+	blt		3f
+	ldr		r12, [r9], #4
+	ldr		lr, [r10], #4
+	smlald	r4, r5, r12, lr
+	b		2b
+
+3:	adds	r11, #2
+	cmp		r11, #1
+	bne		4f
+	ldrsh	r12, [r9]
+	ldrsh	lr, [r10]
+	smlalbb	r4, r5, r12, lr
+
+	// Q30 accumulator to Q15
+4:	lsrs	r12, r4, #15
+	orr		r12, r12, r5, lsl #17
+	asrs	lr, r5, #14				// 0 or -1 if acc >> 15 fits in 32 bits
+	adds	lr, #1
+	cmp		lr, #1
+	bls		5f
+	movw	lr, #0x7FFF				// overflow: 32767 or -32768
+	eor		r12, lr, r5, asr #31
+	b		6f
+5:	ssat	r12, #16, r12
+6:	strh	r12, [r1], #2
+	adds	r3, #2					// next input sample
+	b		1b
+
+9:	pop		{r4, r5, r8, r9, r10, r11, pc}
+
+.ltorg
@@ -0,0 +1,245 @@
+/**
+ *  @brief
+ *      Floating point words for the FPU (single precision).
+ *
+ *      A float is one cell on the data stack (IEEE 754 binary32), the
+ *      stack words dup swap ! @ ... are used for floats too. The words are
+ *      inline and foldable, 1.5e3 2e f* compiles to a constant.
+ *
+ *      Float literals need an exponent (1e 1.5e3 -2.5e-3) and base 10,
+ *      1.5 is a double number. The interpreter tries them after number.
+ *      The s31.32 fixed point words are x* x/ x. x.n.
+ *
+ *      Any Forth thread and Forth interrupt handler can use the FPU, see
+ *      FPU_init() in fpu.c.
+ *  @file
+ *      fpu.s
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: ARM Assembler, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+.fpu	fpv4-sp-d16
+
+
+// Arithmetic
+// **********
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_2|Flag_inline, "f+"
+		@ ( r1 r2 -- r3 ) Adds r1 and r2
+@ -----------------------------------------------------------------------------
+	ldm		psp!, {r0}
+	vmov	s0, r0
+	vmov	s1, tos
+	vadd.f32 s0, s0, s1
+	vmov	tos, s0
+	bx		lr
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_2|Flag_inline, "f-"
+		@ ( r1 r2 -- r3 ) Subtracts r2 from r1
+@ -----------------------------------------------------------------------------
+	ldm		psp!, {r0}
+	vmov	s0, r0
+	vmov	s1, tos
+	vsub.f32 s0, s0, s1
+	vmov	tos, s0
+	bx		lr
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_2|Flag_inline, "f*"
+		@ ( r1 r2 -- r3 ) Multiplies r1 and r2
+@ -----------------------------------------------------------------------------
+	ldm		psp!, {r0}
+	vmov	s0, r0
+	vmov	s1, tos
+	vmul.f32 s0, s0, s1
+	vmov	tos, s0
+	bx		lr
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_2|Flag_inline, "f/"
+		@ ( r1 r2 -- r3 ) Divides r1 by r2
+@ -----------------------------------------------------------------------------
+	ldm		psp!, {r0}
+	vmov	s0, r0
+	vmov	s1, tos
+	vdiv.f32 s0, s0, s1
+	vmov	tos, s0
+	bx		lr
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_1|Flag_inline, "fsqrt"
+		@ ( r1 -- r2 ) Square root
+@ -----------------------------------------------------------------------------
+	vmov	s0, tos
+	vsqrt.f32 s0, s0
+	vmov	tos, s0
+	bx		lr
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_1|Flag_inline, "fabs"
+		@ ( r1 -- r2 ) Absolute value
+@ -----------------------------------------------------------------------------
+	vmov	s0, tos
+	vabs.f32 s0, s0
+	vmov	tos, s0
+	bx		lr
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_1|Flag_inline, "fnegate"
+		@ ( r1 -- r2 ) Negates r1
+@ -----------------------------------------------------------------------------
+	vmov	s0, tos
+	vneg.f32 s0, s0
+	vmov	tos, s0
+	bx		lr
+
+
+// Comparisons, false for NaN
+// **************************
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_2|Flag_inline, "f<"
+		@ ( r1 r2 -- flag ) True if r1 is less than r2
+@ -----------------------------------------------------------------------------
+	ldm		psp!, {r0}
+	vmov	s0, r0
+	vmov	s1, tos
+	movs	tos, #0
+	vcmp.f32 s0, s1
+	vmrs	APSR_nzcv, fpscr
+	it		mi
+	mvnmi	tos, tos
+	bx		lr
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_2|Flag_inline, "f>"
+		@ ( r1 r2 -- flag ) True if r1 is greater than r2
+@ -----------------------------------------------------------------------------
+	ldm		psp!, {r0}
+	vmov	s0, r0
+	vmov	s1, tos
+	movs	tos, #0
+	vcmp.f32 s0, s1
+	vmrs	APSR_nzcv, fpscr
+	it		gt
+	mvngt	tos, tos
+	bx		lr
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_1|Flag_inline, "f0<"
+		@ ( r -- flag ) True if r is less than zero
+@ -----------------------------------------------------------------------------
+	vmov	s0, tos
+	movs	tos, #0
+	vcmp.f32 s0, #0.0
+	vmrs	APSR_nzcv, fpscr
+	it		mi
+	mvnmi	tos, tos
+	bx		lr
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_1|Flag_inline, "f0="
+		@ ( r -- flag ) True if r is zero (0e or -0e)
+@ -----------------------------------------------------------------------------
+	vmov	s0, tos
+	movs	tos, #0
+	vcmp.f32 s0, #0.0
+	vmrs	APSR_nzcv, fpscr
+	it		eq
+	mvneq	tos, tos
+	bx		lr
+
+
+// Conversions
+// ***********
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_1|Flag_inline, "f>s"
+		@ ( r -- n ) Float to integer, rounded towards zero
+@ -----------------------------------------------------------------------------
+	vmov	s0, tos
+	vcvt.s32.f32 s0, s0
+	vmov	tos, s0
+	bx		lr
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_foldable_1|Flag_inline, "s>f"
+		@ ( n -- r ) Integer to float
+@ -----------------------------------------------------------------------------
+	vmov	s0, tos
+	vcvt.f32.s32 s0, s0
+	vmov	tos, s0
+	bx		lr
+
+
+// Input and output
+// ****************
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "f."
+		@ ( r -- ) Prints a float with 7 significant digits
+// int FPU_f2str(float f, char *buffer)
+@ -----------------------------------------------------------------------------
+fpu_fdot:
+	push	{lr}
+	vmov	s0, tos
+	ldr		r0, =Zahlenpuffer
+	bl		FPU_f2str
+	ldr		tos, =Zahlenpuffer
+	pushdatos
+	movs	tos, r0			// length
+	bl		stype
+	bl		space
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+fpu_zahl:
+	@ Float literal for the interpreter, r0: string, r1: length.
+	@ ( -- 0 ) not recognized, ( -- r 1 ) float. Saves r0-r3.
+// int FPU_str2f(const char *str, int length, float *f)
+@ -----------------------------------------------------------------------------
+	push	{r0, r1, r2, r3, lr}
+	ldr		r2, =base
+	ldr		r2, [r2]
+	cmp		r2, #10
+	bne		8f				// only decimal
+
+	pushdatos
+	pushdatos				// room for the float
+	movs	r2, psp
+	bl		FPU_str2f
+	cmp		r0, #0
+	beq		7f
+	movs	tos, #1			// ( r 1 )
+	pop		{r0, r1, r2, r3, pc}
+
+7:	drop
+	movs	tos, #0			// ( 0 )
+	pop		{r0, r1, r2, r3, pc}
+
+8:	pushdaconst 0
+	pop		{r0, r1, r2, r3, pc}
+
+.ltorg
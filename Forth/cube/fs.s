@@ -187,6 +187,65 @@ coredump:
 	pop		{pc}
 
 
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, ">file"
+		@  ( c-addr len --  ) Redirects the output (emit) into a file
+// FRESULT FS_sinkOpen(uint8_t *str, int count);
+@ -----------------------------------------------------------------------------
+tofile:
+	push	{lr}
+	movs	r1, tos		// len -> count
+	drop
+	movs	r0, tos		// c-addr -> str
+	drop
+	bl		FS_sinkOpen
+	cmp		r0, #0
+	beq		1f
+	writeln	"Err: can't open for write"
+	pop		{pc}
+1:
+	ldr		r0, =hook_emit
+	ldr		r1, [r0]
+	ldr		r2, =SinkStore
+	str		r1, [r2]		// store old hook
+	ldr		r1, =sink_emit
+	str		r1, [r0]
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "file>"
+		@  ( --  ) Ends the redirection, flushes and closes the file
+// FRESULT FS_sinkClose(void);
+@ -----------------------------------------------------------------------------
+filefrom:
+	push	{lr}
+	ldr		r0, =hook_emit
+	ldr		r1, [r0]
+	ldr		r2, =sink_emit
+	cmp		r1, r2
+	bne		1f				// hook changed since >file (e.g. tee), keep it
+	ldr		r2, =SinkStore
+	ldr		r1, [r2]
+	str		r1, [r0]		// restore old hook
+1:
+	bl		FS_sinkClose	// the sink is closed anyway
+	cmp		r0, #0
+	beq		2f
+	writeln	"Err: write failed"
+2:
+	pop		{pc}
+
+sink_emit:
+	push	{lr}
+	movs	r0, tos		// c
+	drop
+	bl		FS_sinkEmit
+	pop		{pc}
+
+.ltorg
+
+
 @ -----------------------------------------------------------------------------
 		Wortbirne Flag_visible, "cat"
 		@ cat ( "line<EOF>" -- ) Types the content of the file.
@@ -369,7 +428,7 @@ wc:
 
 @ -----------------------------------------------------------------------------
 		Wortbirne Flag_visible, "df"
-		@ ( -- ) report file system disk space usage (1 KiB blocks)
+		@ ( "drive" -- ) report file system disk space usage (1 KiB blocks)
 // uint64_t FS_df (uint64_t forth_stack);
 @ -----------------------------------------------------------------------------
 df:
@@ -382,6 +441,21 @@ df:
 	pop		{pc}
 
 
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "mkfs"
+		@ ( "drive" -- ) creates a FAT volume on the drive e.g. mkfs 1:
+// uint64_t FS_mkfs (uint64_t forth_stack);
+@ -----------------------------------------------------------------------------
+mkfs:
+	push	{lr}
+	movs	r0, tos		// get tos
+	movs	r1, psp		// get psp
+	bl		FS_mkfs
+	movs	tos, r0		// update tos
+	movs	psp, r1		// update psp
+	pop		{pc}
+
+
 @ -----------------------------------------------------------------------------
 		Wortbirne Flag_visible, "date"
 		@ ( -- ) Print or set time and time
@@ -397,6 +471,36 @@ date:
 	pop		{pc}
 
 
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "rz"
+		@ ( -- ) Receives files with the YMODEM protocol.
+// uint64_t FS_rz (uint64_t forth_stack);
+@ -----------------------------------------------------------------------------
+rz:
+	push	{lr}
+	movs	r0, tos		// get tos
+	movs	r1, psp		// get psp
+	bl		FS_rz
+	movs	tos, r0		// update tos
+	movs	psp, r1		// update psp
+	pop		{pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "sz"
+		@ ( "line<EOF>" -- ) Sends files with the YMODEM protocol.
+// uint64_t FS_sz (uint64_t forth_stack);
+@ -----------------------------------------------------------------------------
+sz:
+	push	{lr}
+	movs	r0, tos		// get tos
+	movs	r1, psp		// get psp
+	bl		FS_sz
+	movs	tos, r0		// update tos
+	movs	psp, r1		// update psp
+	pop		{pc}
+
+
 @ -----------------------------------------------------------------------------
 		Wortbirne Flag_visible, "mount"
 		@ ( -- ) Mount the default drive
@@ -427,6 +531,34 @@ umount:
 	pop		{pc}
 
 
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "msc-attach"
+		@ ( -- ) Unmount the default drive and give the SD card to the USB host
+// int MSC_attach(void)
+@ -----------------------------------------------------------------------------
+msc_attach:
+	push	{r0-r3, lr}
+	bl		MSC_attach
+	cmp		r0, #0
+	beq		1f
+	writeln	"Err: can't unmount"
+1:	pop		{r0-r3, pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "msc-detach"
+		@ ( -- ) Take the SD card back from the USB host and mount the default drive
+// int MSC_detach(void)
+@ -----------------------------------------------------------------------------
+msc_detach:
+	push	{r0-r3, lr}
+	bl		MSC_detach
+	cmp		r0, #0
+	beq		1f
+	writeln	"Err: can't mount"
+1:	pop		{r0-r3, pc}
+
+
 @ -----------------------------------------------------------------------------
 		Wortbirne Flag_visible, "vi"
 		@ ( -- ) vi editor
@@ -447,6 +579,8 @@ vi:
 
 // These functions call Forth words. They need a data stack SPS and
 // top of stack (TOS).
+// r8-r11 are saved too, Forth words compiled with the register cache
+// (registercache.s) use them.
 
 // catch_evaluate
 //***************
@@ -457,7 +591,7 @@ vi:
 // uint64_t FS_catch_evaluate(uint64_t forth_stack, uint8_t* str, int count);
 .global		FS_catch_evaluate
 FS_catch_evaluate:
-	push 	{r4-r7, lr}
+	push 	{r4-r11, lr}
 	movs	tos, r0			// get tos
 	movs	psp, r1			// get psp
 	pushdatos
@@ -478,7 +612,7 @@ FS_catch_evaluate:
 	str		r1, [r0]
 	movs	r0, tos			// update tos
 	movs	r1, psp			// update psp
-	pop		{r4-r7, pc}
+	pop		{r4-r11, pc}
 
 quit_evaluate:
 	ldr		r1, =1			// error state
@@ -491,13 +625,13 @@ quit_evaluate:
 	ldr		sp, [r0]
 	movs	r0, tos			// update tos
 	movs	r1, psp			// update psp
-	pop		{r4-r7, pc}
+	pop		{r4-r11, pc}
 
 
 // uint64_t FS_evaluate(uint64_t forth_stack, uint8_t* str, int count);
 .global		FS_evaluate
 FS_evaluate:
-	push 	{r4-r7, lr}
+	push 	{r4-r11, lr}
 	movs	tos, r0		// get tos
 	movs	psp, r1		// get psp
 	pushdatos
@@ -507,25 +641,25 @@ FS_evaluate:
 	bl		evaluate
 	movs	r0, tos		// update tos
 	movs	r1, psp		// update psp
-	pop		{r4-r7, pc}
+	pop		{r4-r11, pc}
 
 
 // uint64_t FS_cr(uint64_t forth_stack);
 .global		FS_cr
 FS_cr:
-	push 	{r4-r7, lr}
+	push 	{r4-r11, lr}
 	movs	tos, r0		// get tos
 	movs	psp, r1		// get psp
 	bl		cr
 	movs	r0, tos		// update tos
 	movs	r1, psp		// update psp
-	pop		{r4-r7, pc}
+	pop		{r4-r11, pc}
 
 
 // uint64_t FS_type(uint64_t forth_stack, uint8_t* str, int count);
 .global		FS_type
 FS_type:
-	push 	{r4-r7, lr}
+	push 	{r4-r11, lr}
 	movs	tos, r0		// get tos
 	movs	psp, r1		// get psp
 	pushdatos
@@ -535,13 +669,13 @@ FS_type:
 	bl		stype
 	movs	r0, tos		// update tos
 	movs	r1, psp		// update psp
-	pop		{r4-r7, pc}
+	pop		{r4-r11, pc}
 
 // token ( -- c-addr len )
 // uint64_t  FS_token(uint64_t forth_stack, uint8_t **str, int *count);
 .global	FS_token
 FS_token:
-	push 	{r4-r7, lr}
+	push 	{r4-r11, lr}
 	movs	tos, r0		// get tos
 	movs	psp, r1		// get psp
 	push 	{r2-r3}		// push str argument (pointer to string)
@@ -555,13 +689,13 @@ FS_token:
 	str		r1, [r3]
 	movs	r0, tos		// update tos
 	movs	r1, psp		// update psp
-	pop		{r4-r7, pc}
+	pop		{r4-r11, pc}
 
 // accept ( c-addr maxlength - - length )
 // uint64_t  FS_accept(uint64_t forth_stack, uint8_t *str, int *count);
 .global	FS_accept
 FS_accept:
-	push 	{r4-r7, lr}
+	push 	{r4-r11, lr}
 	movs	tos, r0		// get tos
 	movs	psp, r1		// get psp
 	pushdatos
@@ -576,7 +710,7 @@ FS_accept:
 	str		r1, [r3]	// return count
 	movs	r0, tos		// update tos
 	movs	r1, psp		// update psp
-	pop		{r4-r7, pc}
+	pop		{r4-r11, pc}
 
 
 // FAT FS datastructures
@@ -877,13 +1011,14 @@ fs_f_write:
 //   FIL*    fp,  /* [IN] File object */
 //   FSIZE_t ofs  /* [IN] File read/write pointer */
 // );
+// FSIZE_t is 64 bit wide with exFAT -> FRESULT FS_f_lseek(FIL* fp, DWORD ofs)
 @ -----------------------------------------------------------------------------
 fs_f_lseek:
 	push	{lr}
 	movs	r1, tos		// ofs
 	drop
 	movs	r0, tos		// fp
-	bl		f_lseek
+	bl		FS_f_lseek
 	movs	tos, r0
 	pop		{pc}
 
@@ -951,6 +1086,7 @@ fs_f_forward:
 //   FSIZE_t fsz, /* [IN] File size expanded to */
 //   BYTE    opt  /* [IN] Allocation mode */
 // );
+// FSIZE_t is 64 bit wide with exFAT -> FRESULT FS_f_expand(FIL* fp, DWORD fsz, BYTE opt)
 @ -----------------------------------------------------------------------------
 fs_f_expand:
 	push	{lr}
@@ -959,7 +1095,7 @@ fs_f_expand:
 	movs	r1, tos		// fsz
 	drop
 	movs	r0, tos		// fp
-	bl		f_expand
+	bl		FS_f_expand
 	movs	tos, r0
 	pop		{pc}
 
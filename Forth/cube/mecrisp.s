@@ -58,8 +58,31 @@
 
 @.equ	flash16bytesblockwrite, 1
 .equ	flash8bytesblockwrite, 1
+.equ	flashrowwrite, 1	@ Collect flash writes in 512 byte rows for fast programming, see flash.c
 @.equ	charkommaavailable, 1  Not available.
 
+// hash index for find, see dict.c
+.equ	hashfind,			1
+
+// dictionary pointer record in the page after FlashDictionaryEnde, see dict.c
+// (the page 0x0805F000 was the last page of the flash dictionary before)
+.equ	dicttail,			1
+
+// compiled code keeps stack elements in r8-r11 (ra-on, ra-off), see registercache.s
+.equ	registercache,		1
+
+// peephole optimiser and tail calls (off by default) for compiled definitions, see peephole.s
+.equ	peephole,			1
+
+// short definitions get the inline flag (inline-limit), see autoinline.s
+.equ	autoinline,			1
+
+// single precision float words and literals for the FPU, see fpu.s
+.equ	floatingpoint,		1
+
+// vector words for 16 bit sample arrays with the DSP instructions, see dsp.s
+.equ	dspvector,			1
+
 // console redirection
 .equ	UART_TERMINAL, 		1
 .equ	CDC_TERMINAL, 		2
@@ -104,7 +127,8 @@ RAM_SHARED (xrw)           : ORIGIN = 0x20030000, LENGTH = 10K
 
 .equ	Kernschutzadresse,		0x08040000	@ Mecrisp core never writes flash below this address.
 .equ	FlashDictionaryAnfang,	0x08040000	@ 256 KiB Flash reserved for core and C.
-.equ	FlashDictionaryEnde,	0x08060000	@ 128 KiB Flash available, 386 KiB for drive, 256 KiB for BLE Stack
+.equ	FlashDictionaryEnde,	0x0805F000	@ 124 KiB Flash available, 4 KiB dictionary tail, 386 KiB for drive, 256 KiB for BLE Stack
+.equ	DictTailEnde,			FlashDictionaryEnde + 0x1000	@ End of the dictionary tail journal page, see dict.c
 .equ	Backlinkgrenze,			RamAnfang	@ Ab dem Ram-Start.
 
 
@@ -128,6 +152,19 @@ RAM_SHARED (xrw)           : ORIGIN = 0x20030000, LENGTH = 10K
 	ramallot	Datenstacksicherung, 4
 	ramallot	Einsprungpunkt, 4
 
+.ifdef registercache
+	ramallot	Registercache, 4		@ Register cache on/off
+	ramallot	Registercachetiefe, 4	@ Number of stack elements in r8-r11
+.endif
+
+.ifdef peephole
+	ramallot	Peepholeanfang, 4		@ Start of the last compiled call or inline
+	ramallot	Peepholeende, 4			@ End, dictionary pointer after it
+	ramallot	Peepholewort, 4			@ Call destination or inlined definition
+	ramallot	Peepholeart, 4			@ 0 none, 1 call, 2 inline
+	ramallot	Peepholeschluss, 4		@ <> 0 if the definition has a tail call
+.endif
+
 @ Variablen für das Flashdictionary  Variables for Flash management
 
 	ramallot	ZweitDictionaryPointer, 4
@@ -138,9 +175,11 @@ RAM_SHARED (xrw)           : ORIGIN = 0x20030000, LENGTH = 10K
 	ramallot	EvaluateSP,	4
 	ramallot	EvaluateState, 4
 	ramallot	RedirectStore, 4
+	ramallot	SinkStore, 4
 
 
 .global		Dictionarypointer
+.global		FlashDictionaryEnde		@ dict.c, DICT_TAIL_ADDRESS
 .global		Fadenende
 .global		ZweitDictionaryPointer
 .global		ZweitFadenende
@@ -171,6 +210,9 @@ RAM_SHARED (xrw)           : ORIGIN = 0x20030000, LENGTH = 10K
 .ifdef flash8bytesblockwrite
 	.equ		Sammelstellen, 32					@ 32 * (8 + 4) = 384 Bytes
 	ramallot	Sammeltabelle, Sammelstellen * 12	@ Buffer 32 blocks of 8 bytes each for ECC constrained Flash write
+  .ifdef flashrowwrite
+	ramallot	Sammelbelegt, 4						@ Used table entries, no table search if 0
+  .endif
 .endif
 
 .ifdef flash16bytesblockwrite
@@ -235,6 +277,21 @@ CoreDictionaryAnfang: @ Dictionary-Einsprungpunkt setzen
 .ltorg
 .include "compiler.s"
 .include "compiler-flash.s"
+.ifdef registercache
+	.include "registercache.s"
+.endif
+.ifdef peephole
+	.include "peephole.s"
+.endif
+.ifdef autoinline
+	.include "autoinline.s"
+.endif
+.ifdef floatingpoint
+	.include "fpu.s"
+.endif
+.ifdef dspvector
+	.include "dsp.s"
+.endif
 .include "controlstructures.s"
 .ltorg
 .include "doloop.s"
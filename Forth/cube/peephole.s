@@ -0,0 +1,405 @@
+/**
+ *  @brief
+ *      Peephole optimiser for compiled definitions.
+ *
+ *      interpret records the last call or inlined definition it compiled
+ *      (start and end address in the dictionary). As long as nothing else
+ *      is compiled after it, the optimiser may take the opcodes back:
+ *
+ *      - Tail call: ; and exit after a bl X compile
+ *            ldr lr, [sp], #4   (pop {lr})
+ *            b X
+ *        instead of bl X and pop {pc}. The return stack does not grow in
+ *        call chains. ; still writes the pop {pc} as end of definition.
+ *      - Stack shuffles: dup drop, dup nip, over drop and swap swap are
+ *        removed, swap drop becomes nip.
+ *      - Literal and binary operator: the last constant before an inline
+ *        definition beginning with ldm psp!, {r0} (e.g. u< max) goes
+ *        directly into TOS, the old TOS into r0 (movs r0, tos). The classic
+ *        opcodings for + - and or = ! c! ... are done by interpret.
+ *
+ *      Immediate words (if, then, begin ...) can mark the dictionary
+ *      pointer as jump target, interpret clears the record after them.
+ *      In flash only opcodes still in the row buffer can be taken back
+ *      (FLASH_rowRewind()).
+ *
+ *      The variable peephole selects the optimisations: bit 0 stack
+ *      shuffles and literals (default), bit 1 tail calls. 0 peephole !
+ *      switches the optimiser off, e.g. for debugging with the disassembler,
+ *      -1 peephole ! switches the tail calls on.
+ *
+ *      Tail calls are off by default, X runs with the return address of the
+ *      caller. Words that take their own return address (r> drop, r@ for
+ *      inline data) must not be called as last word of a definition, and
+ *      inline refuses definitions with a tail call (relative jump).
+ *  @file
+ *      peephole.s
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: ARM Assembler, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// Peepholeart, last compiled
+.equ	PEEPHOLE_NONE,		0
+.equ	PEEPHOLE_CALL,		1
+.equ	PEEPHOLE_INLINE,	2
+
+// bits of the variable peephole
+.equ	PEEPHOLE_SHUFFLE,	1
+.equ	PEEPHOLE_TAIL,		2
+
+// stack shuffles
+.equ	PEEPHOLE_DUP,		1
+.equ	PEEPHOLE_DROP,		2
+.equ	PEEPHOLE_SWAP,		3
+.equ	PEEPHOLE_OVER,		4
+.equ	PEEPHOLE_NIP,		5
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible|Flag_variable, "peephole"
+		@ ( -- addr ) Peephole optimiser, bit 0 shuffles and literals,
+		@ bit 1 tail calls (changes the return address, see above)
+		CoreVariable peephole_an
+@ -----------------------------------------------------------------------------
+	pushdatos
+	ldr		tos, =peephole_an
+	bx		lr
+	.word	PEEPHOLE_SHUFFLE	// tail calls off
+
+
+@ -----------------------------------------------------------------------------
+peephole_callkomma:
+	@ ( addr -- ) callkomma and record the call
+@ -----------------------------------------------------------------------------
+	push	{r0, r1, r2, lr}
+	movs	r0, tos				// destination
+	ldr		r1, =Dictionarypointer
+	ldr		r2, [r1]
+	bl		callkomma
+	ldr		r1, [r1]
+	movs	r3, #PEEPHOLE_CALL
+	b		peephole_merken
+
+
+@ -----------------------------------------------------------------------------
+peephole_inlinekomma:
+	@ ( addr -- ) inlinekomma, redundant stack shuffles are removed
+@ -----------------------------------------------------------------------------
+	push	{r0, r1, r2, lr}
+	ldr		r0, =peephole_an
+	ldr		r0, [r0]
+	tst		r0, #PEEPHOLE_SHUFFLE
+	beq		5f
+
+	// directly after another inlined definition?
+	ldr		r0, =Peepholeart
+	ldr		r0, [r0]
+	cmp		r0, #PEEPHOLE_INLINE
+	bne		5f
+	ldr		r1, =Dictionarypointer
+	ldr		r1, [r1]
+	ldr		r2, =Peepholeende
+	ldr		r2, [r2]
+	cmp		r1, r2
+	bne		5f
+
+	ldr		r0, =Peepholewort
+	ldr		r0, [r0]
+	bl		peephole_jonglieren
+	lsls	r1, r0, #8			// previous shuffle
+	movs	r0, tos
+	bl		peephole_jonglieren
+	orrs	r1, r0				// previous, next
+
+	adr		r2, peephole_paare
+1:	ldrh	r0, [r2]
+	cmp		r0, #0
+	beq		5f					// end of table
+	cmp		r0, r1
+	beq		2f
+	adds	r2, #4
+	b		1b
+
+2:	ldr		r0, =Peepholeanfang
+	ldr		r0, [r0]
+	bl		peephole_zurueck
+	cmp		r0, #0
+	beq		5f
+	ldrh	r0, [r2, #2]		// replacement
+	cmp		r0, #0
+	beq		3f
+	pushda	r0
+	bl		hkomma
+3:	drop
+	pop		{r0, r1, r2, pc}
+
+5:	ldr		r1, =Dictionarypointer
+	ldr		r2, [r1]
+	push	{r2}
+	movs	r0, tos				// definition
+	push	{r0}
+	bl		inlinekomma			// does not save r0-r3
+	pop		{r0, r2}
+	ldr		r1, =Dictionarypointer
+	ldr		r1, [r1]
+	movs	r3, #PEEPHOLE_INLINE
+
+peephole_merken:
+	// r0: destination or definition, r1: end, r2: start, r3: kind
+	push	{r3}
+	ldr		r3, =Peepholeanfang
+	str		r2, [r3]
+	ldr		r3, =Peepholeende
+	str		r1, [r3]
+	ldr		r3, =Peepholewort
+	str		r0, [r3]
+	pop		{r3}
+	ldr		r0, =Peepholeart
+	str		r3, [r0]
+	pop		{r0, r1, r2, pc}
+
+	.p2align 2
+peephole_paare:
+	// previous << 8 | next, replacement opcode (0 none)
+	.hword	PEEPHOLE_DUP  << 8 | PEEPHOLE_DROP, 0
+	.hword	PEEPHOLE_DUP  << 8 | PEEPHOLE_NIP,  0
+	.hword	PEEPHOLE_OVER << 8 | PEEPHOLE_DROP, 0
+	.hword	PEEPHOLE_SWAP << 8 | PEEPHOLE_SWAP, 0
+	.hword	PEEPHOLE_SWAP << 8 | PEEPHOLE_DROP, 0x3704	// adds psp, #4 (nip)
+	.hword	0, 0
+
+
+@ -----------------------------------------------------------------------------
+peephole_jonglieren:
+	@ Stack shuffle of the definition in r0, 0 for others. Saves r1-r3.
+@ -----------------------------------------------------------------------------
+	push	{r1, r2}
+	ldr		r1, [r0]
+	ldr		r2, =0x4770cf40		// ldm psp!, {tos}  bx lr
+	cmp		r1, r2
+	bne		1f
+	movs	r0, #PEEPHOLE_DROP
+	b		9f
+
+1:	ldr		r2, =0x47703704		// adds psp, #4  bx lr
+	cmp		r1, r2
+	bne		1f
+	movs	r0, #PEEPHOLE_NIP
+	b		9f
+
+1:	ldr		r2, =0x603e6839		// ldr r1, [psp]  str tos, [psp]
+	cmp		r1, r2
+	bne		1f
+	ldr		r1, [r0, #4]
+	ldr		r2, =0x4770000e		// movs tos, r1  bx lr
+	cmp		r1, r2
+	bne		8f
+	movs	r0, #PEEPHOLE_SWAP
+	b		9f
+
+1:	ldr		r2, =0x6d04f847		// str tos, [psp, #-4]!
+	cmp		r1, r2
+	bne		8f
+	ldrh	r1, [r0, #4]
+	movw	r2, #0x4770			// bx lr
+	cmp		r1, r2
+	bne		1f
+	movs	r0, #PEEPHOLE_DUP
+	b		9f
+1:	ldr		r1, [r0, #4]
+	ldr		r2, =0x4770687e		// ldr tos, [psp, #4]  bx lr
+	cmp		r1, r2
+	bne		8f
+	movs	r0, #PEEPHOLE_OVER
+	b		9f
+
+8:	movs	r0, #0
+9:	pop		{r1, r2}
+	bx		lr
+
+
+@ -----------------------------------------------------------------------------
+peephole_endsprung:
+	@ Tail call for ; and exit. Returns r0 <> 0 if the last call is
+	@ replaced by pop {lr} and a jump.
+@ -----------------------------------------------------------------------------
+	push	{r1, r2, r3, lr}
+	ldr		r0, =peephole_an
+	ldr		r0, [r0]
+	tst		r0, #PEEPHOLE_TAIL
+	beq		8f
+
+	ldr		r0, =Peepholeart
+	ldr		r0, [r0]
+	cmp		r0, #PEEPHOLE_CALL
+	bne		8f
+	ldr		r1, =Dictionarypointer
+	ldr		r1, [r1]
+	ldr		r2, =Peepholeende
+	ldr		r2, [r2]
+	cmp		r1, r2
+	bne		8f
+	ldr		r0, =Peepholeanfang
+	ldr		r0, [r0]
+	subs	r2, r0
+	cmp		r2, #4				// bl, not movw r0, ... blx r0
+	bne		8f
+
+	// b.w from start + 4 in reach (like bl in callkomma)?
+	ldr		r3, =Peepholewort
+	ldr		r3, [r3]
+	subs	r3, r0
+	subs	r3, #8
+	ldr		r1, =0xFFC00001
+	ands	r1, r3
+	beq		1f
+	ldr		r2, =0xFFC00000
+	cmp		r1, r2
+	bne		8f
+
+1:	bl		peephole_zurueck
+	cmp		r0, #0
+	beq		8f
+
+	pushdaconstw 0xf85d			// ldr lr, [sp], #4
+	bl		hkomma
+	pushdaconstw 0xeb04
+	bl		hkomma
+
+	// b.w: S | imm10 || 1 0 J1 1 J2 imm11, J1 = J2 = 1 like in callkomma
+	lsrs	r3, #1
+	ldr		r0, =0xF000B800
+	movw	r1, #0x7FF
+	ands	r1, r3
+	orrs	r0, r1
+	lsrs	r3, #11
+	movw	r1, #0x3FF
+	ands	r1, r3
+	orrs	r0, r0, r1, lsl #16
+	lsrs	r3, #10
+	ands	r1, r3, #1
+	orrs	r0, r0, r1, lsl #26
+	pushda	r0
+	bl		reversekomma
+
+	movs	r0, #1
+	ldr		r1, =Peepholeschluss	// inline refuses the definition
+	str		r0, [r1]
+	pop		{r1, r2, r3, pc}
+
+8:	movs	r0, #0
+	pop		{r1, r2, r3, pc}
+
+
+@ -----------------------------------------------------------------------------
+peephole_literal:
+	@ Special internal entry point with register dependencies of interpret.
+	@  r1: Flags, r2: code entry point, r3: number of folding constants,
+	@  r4: address of and r5: constant folding pointer.
+	@ Returns r0 <> 0 if the last constant and the binary operator are
+	@ compiled together.
+@ -----------------------------------------------------------------------------
+	push	{r1, r2, r3, lr}
+	ldr		r0, =peephole_an
+	ldr		r0, [r0]
+	tst		r0, #PEEPHOLE_SHUFFLE
+	beq		8f
+	cmp		r3, #0
+	beq		8f
+
+	movs	r0, #Flag_immediate_compileonly & ~Flag_visible
+	ands	r0, r1
+	cmp		r0, #Flag_inline & ~Flag_visible	// inline, but not immediate
+	bne		8f
+	ldrh	r0, [r2]
+	movw	r1, #0xcf01			// ldm psp!, {r0}
+	cmp		r0, r1
+	bne		8f
+
+	popda	r0					// last constant
+	push	{r0}
+	subs	r3, #1
+	bl		konstantenschreiben	// the others the classic way
+	pushdaconst 0x30			// movs r0, tos
+	bl		hkomma
+	pop		{r0}
+	pushda	r0
+	pushdaconst 6				// directly into r6=tos
+	bl		registerliteralkomma
+	adds	r2, #2				// without ldm psp!, {r0}
+	pushda	r2
+	bl		inlinekomma
+
+	ldr		r0, =Peepholeart
+	movs	r1, #PEEPHOLE_NONE
+	str		r1, [r0]
+	movs	r0, #1
+	pop		{r1, r2, r3, pc}
+
+8:	movs	r0, #0
+	pop		{r1, r2, r3, pc}
+
+
+@ -----------------------------------------------------------------------------
+peephole_vergessen:
+	@ Clears the record, e.g. after immediate words. Saves all registers.
+@ -----------------------------------------------------------------------------
+	push	{r0, r1}
+	ldr		r0, =Peepholeart
+	movs	r1, #PEEPHOLE_NONE
+	str		r1, [r0]
+	pop		{r0, r1}
+	bx		lr
+
+
+@ -----------------------------------------------------------------------------
+peephole_zurueck:
+	@ Sets the dictionary pointer back to r0. Returns r0 = 0 if this is not
+	@ possible (flash already programmed). Saves r1-r3.
+@ -----------------------------------------------------------------------------
+	push	{r1, r2, r3, lr}
+	ldr		r1, =Dictionarypointer
+	ldr		r2, [r1]
+	ldr		r3, =Backlinkgrenze
+	cmp		r2, r3
+	bhs		2f					// RAM
+
+  .ifdef flashrowwrite
+	push	{r0, r1}
+	movs	r1, r2				// End
+	bl		FLASH_rowRewind		// r0: Start
+	movs	r2, r0
+	pop		{r0, r1}
+	cmp		r2, #0
+	bne		2f
+  .endif
+	movs	r0, #0
+	pop		{r1, r2, r3, pc}
+
+2:	str		r0, [r1]
+	ldr		r0, =Peepholeart
+	movs	r1, #PEEPHOLE_NONE
+	str		r1, [r0]
+	movs	r0, #1
+	pop		{r1, r2, r3, pc}
+
+.ltorg
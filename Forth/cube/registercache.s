@@ -0,0 +1,382 @@
+/**
+ *  @brief
+ *      Register cache for the native code generator.
+ *
+ *      The classic code generator keeps only TOS in a register (r6), every
+ *      dup, over or literal stores to the data stack (psp, r7) and every
+ *      binary operator loads from it. With the register cache the compiler
+ *      keeps up to four further stack elements in r8-r11 while compiling
+ *      a definition:
+ *
+ *          depth 1: NOS r11
+ *          depth 2: NOS r10, r11
+ *          depth 3: NOS r9, r10, r11
+ *          depth 4: NOS r8, r9, r10, r11 (r11 is the deepest element)
+ *
+ *      Literals, dup, over, drop, nip, swap, binary operators (inline words
+ *      beginning with ldm psp!, {r0}) and inline words using only TOS and
+ *      scratch registers are compiled to register moves. Before anything
+ *      else (calls, immediate words like if, then, loop or ;, words with
+ *      memory stack access) the cache is written back with one stmdb, so
+ *      the stack is canonical at calls and control flow joins.
+ *
+ *      The mode is switched by the immediate words ra-on and ra-off, the
+ *      default is off. Definitions compiled with the cache use r8-r11 as
+ *      scratch registers, therefore the interrupt trampolines and the C
+ *      interface to Forth words save them.
+ *  @file
+ *      registercache.s
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: ARM Assembler, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// Kinds of inline definitions
+.equ	RC_NEUTRAL,	0		// TOS and scratch registers only
+.equ	RC_PUSH,	1		// pushdatos, ...
+.equ	RC_OVER,	2		// pushdatos, ldr tos, [psp, #4]
+.equ	RC_DROP,	3		// ldm psp!, {tos}, ...
+.equ	RC_NIP,		4		// adds psp, #4, ...
+.equ	RC_BINARY,	5		// ldm psp!, {r0}, ...
+.equ	RC_SWAP,	6		// ldr r1, [psp]  str tos, [psp]  movs tos, r1
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_immediate, "ra-on"
+		@ ( -- ) Keeps stack elements in registers while compiling
+@ -----------------------------------------------------------------------------
+	ldr		r0, =Registercache
+	movs	r1, #0
+	mvns	r1, r1		// -1
+	str		r1, [r0]
+	bx		lr
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_immediate, "ra-off"
+		@ ( -- ) Classic code generation, only TOS in a register
+@ -----------------------------------------------------------------------------
+	ldr		r0, =Registercache
+	movs	r1, #0
+	str		r1, [r0]
+	bx		lr
+
+
+@ -----------------------------------------------------------------------------
+registercache_kompilieren:
+	@ Special internal entry point with register dependencies of interpret.
+	@  r1: Flags, r2: code entry point, r3: number of folding constants,
+	@  r4: address of and r5: constant folding pointer.
+	@ Compiles the definition with the register cache and returns r0 <> 0,
+	@ or flushes the cache and returns r0 = 0 for the classic compilation.
+@ -----------------------------------------------------------------------------
+	push	{r1, r2, r3, lr}
+
+	ldr		r0, =Registercache
+	ldr		r0, [r0]
+	cmp		r0, #0
+	beq		.rc_klassisch
+
+	movs	r0, #Flag_immediate_compileonly & ~Flag_visible
+	ands	r0, r1
+	cmp		r0, #Flag_inline & ~Flag_visible	// inline, but not immediate
+	bne		.rc_klassisch
+
+	// classify the definition by its first opcodes
+	ldrh	r0, [r2]
+	movw	r1, #0xf847			// str tos, [psp, #-4]!
+	cmp		r0, r1
+	bne		1f
+	ldrh	r0, [r2, #2]
+	movw	r1, #0x6d04
+	cmp		r0, r1
+	bne		.rc_klassisch
+	ldr		r0, [r2, #4]
+	ldr		r1, =0x4770687e		// ldr tos, [psp, #4]  bx lr
+	cmp		r0, r1
+	bne		2f
+	movs	r1, #RC_OVER
+	b		.rc_genug
+2:	adds	r0, r2, #4
+	movs	r1, #RC_PUSH
+	b		.rc_rest
+
+1:	movw	r1, #0xcf40			// ldm psp!, {tos}
+	cmp		r0, r1
+	bne		1f
+	adds	r0, r2, #2
+	movs	r1, #RC_DROP
+	b		.rc_rest
+
+1:	movw	r1, #0xcf01			// ldm psp!, {r0}
+	cmp		r0, r1
+	bne		1f
+	adds	r0, r2, #2
+	movs	r1, #RC_BINARY
+	b		.rc_rest
+
+1:	movw	r1, #0x3704			// adds psp, #4
+	cmp		r0, r1
+	bne		1f
+	adds	r0, r2, #2
+	movs	r1, #RC_NIP
+	b		.rc_rest
+
+1:	ldr		r0, [r2]
+	ldr		r1, =0x603e6839		// ldr r1, [psp]  str tos, [psp]
+	cmp		r0, r1
+	bne		1f
+	ldr		r0, [r2, #4]
+	ldr		r1, =0x4770000e		// movs tos, r1  bx lr
+	cmp		r0, r1
+	bne		1f
+	movs	r1, #RC_SWAP
+	b		.rc_genug
+
+1:	movs	r0, r2
+	movs	r1, #RC_NEUTRAL
+
+.rc_rest:
+	// the rest of the definition has to be neutral
+	push	{r0}
+	bl		registercache_neutral
+	cmp		r0, #0
+	pop		{r0}
+	beq		.rc_klassisch
+
+.rc_genug:
+	// r0: rest of the definition, r1: kind
+	// drop, nip, swap and binary operators need an element in the cache
+	cmp		r1, #RC_DROP
+	blo		1f
+	ldr		r2, =Registercachetiefe
+	ldr		r2, [r2]
+	orrs	r2, r3				// cached elements or constants?
+	beq		.rc_klassisch
+
+1:	bl		registercache_konstanten
+	ldr		r3, =Registercachetiefe
+	ldr		r2, [r3]			// depth d, NOS in r(12-d)
+
+	cmp		r1, #RC_NEUTRAL
+	beq		.rc_inline
+
+	cmp		r1, #RC_PUSH
+	bne		1f
+	bl		registercache_push
+	b		.rc_inline
+
+1:	rsb		r2, r2, #4			// register field of the NOS
+	cmp		r1, #RC_OVER
+	bne		1f
+	bl		registercache_push
+	pushdatos
+	tst		r2, #3
+	bne		2f
+	movw	tos, #0x683e		// ldr tos, [psp]  NOS is not in the cache
+	b		3f
+2:	movw	tos, #0x4646		// mov tos, rN
+	orrs	tos, tos, r2, lsl #3
+3:	bl		hkomma
+	b		.rc_fertig
+
+1:	cmp		r1, #RC_SWAP
+	bne		1f
+	pushdaconstw 0x4630			// mov r0, tos
+	bl		hkomma
+	pushdatos
+	movw	tos, #0x4646		// mov tos, rN
+	orrs	tos, tos, r2, lsl #3
+	bl		hkomma
+	pushdatos
+	movw	tos, #0x4680		// mov rN, r0
+	orrs	tos, r2
+	bl		hkomma
+	b		.rc_fertig
+
+1:	ldr		r12, [r3]			// drop, nip and binary operators take the NOS
+	subs	r12, #1
+	str		r12, [r3]
+
+	cmp		r1, #RC_NIP
+	beq		.rc_inline			// nothing more to do
+
+	pushdatos
+	movw	tos, #0x4640		// mov r0, rN
+	cmp		r1, #RC_DROP
+	bne		2f
+	movw	tos, #0x4646		// mov tos, rN
+2:	orrs	tos, tos, r2, lsl #3
+	bl		hkomma
+
+.rc_inline:
+	pushda	r0
+	bl		inlinekomma
+
+.rc_fertig:
+  .ifdef peephole
+	bl		peephole_vergessen	// code in registers, nothing to optimise
+  .endif
+	movs	r0, #1
+	pop		{r1, r2, r3, pc}
+
+.rc_klassisch:
+	bl		registercache_leeren
+	movs	r0, #0
+	pop		{r1, r2, r3, pc}
+
+
+@ -----------------------------------------------------------------------------
+registercache_leeren:
+	@ Compiles the write back of the cached elements to the data stack.
+	@ Saves all registers.
+@ -----------------------------------------------------------------------------
+	push	{r0, r1, r2, lr}
+	ldr		r0, =Registercachetiefe
+	ldr		r1, [r0]
+	cmp		r1, #0
+	beq		2f
+	movs	r2, #0
+	str		r2, [r0]
+
+	cmp		r1, #1
+	bne		1f
+	pushdaconstw 0xf847			// str r11, [psp, #-4]!
+	bl		hkomma
+	pushdaconstw 0xbd04
+	bl		hkomma
+	b		2f
+
+1:	pushdaconstw 0xe927			// stmdb psp!, {r(12-d)-r11}
+	bl		hkomma
+	movs	r2, #1
+	lsls	r2, r1
+	subs	r2, #1
+	rsb		r1, r1, #12
+	lsls	r2, r1
+	pushda	r2
+	bl		hkomma
+
+2:	pop		{r0, r1, r2, pc}
+
+
+@ -----------------------------------------------------------------------------
+registercache_push:
+	@ Compiles the move of TOS into the cache, flushes a full cache before.
+	@ Saves r0-r3.
+@ -----------------------------------------------------------------------------
+	push	{r0, r1, r2, lr}
+	ldr		r1, =Registercachetiefe
+	ldr		r0, [r1]
+	cmp		r0, #4
+	bne		1f
+	bl		registercache_leeren
+	movs	r0, #0
+1:	adds	r2, r0, #1
+	str		r2, [r1]
+	pushdatos
+	movw	tos, #0x46b3		// mov r(11-d), tos
+	subs	tos, r0
+	bl		hkomma
+	pop		{r0, r1, r2, pc}
+
+
+@ -----------------------------------------------------------------------------
+registercache_konstanten:
+	@ Like konstantenschreiben, but the folding constants go to the cache.
+	@  r3: number of folding constants, r4/r5 constant folding pointer
+@ -----------------------------------------------------------------------------
+	push	{r0, lr}
+	cmp		r3, #0
+	beq		2f
+
+1:	subs	r3, #1
+	pushda	r3
+	ldr		tos, [psp, tos, lsl #2]	// pick
+	bl		registercache_push
+	pushdaconst 6				// directly into r6=tos
+	bl		registerliteralkomma
+	cmp		r3, #0
+	bne		1b
+
+	subs	r5, #4				// drop the constants written
+	movs	psp, r5
+	drop
+
+2:	movs	r5, #0				// clear constant folding pointer
+	str		r5, [r4]
+	pop		{r0, pc}
+
+
+@ -----------------------------------------------------------------------------
+registercache_neutral:
+	@ Checks the code from r0 up to bx lr. Returns r0 = 0 if there is an
+	@ opcode that is not a 16 bit data processing, load or store opcode or
+	@ that uses psp. Saves r1-r3.
+@ -----------------------------------------------------------------------------
+	push	{r1, r2, r3}
+	movw	r3, #0x4770			// bx lr
+
+1:	ldrh	r1, [r0]
+	cmp		r1, r3
+	beq		9f
+
+	cmp		r1, #0x2000			// shifts, add and sub register/imm3
+	blo		3f
+	cmp		r1, #0x4000			// mov, cmp, add and sub imm8
+	blo		4f
+	cmp		r1, #0x4400			// data processing register
+	blo		2f
+	cmp		r1, #0x5000
+	blo		8f
+	cmp		r1, #0x6000			// load and store register offset
+	blo		3f
+	cmp		r1, #0x9000			// load and store immediate offset
+	blo		2f
+	cmp		r1, #0x9800
+	blo		8f
+	cmp		r1, #0xa000			// ldr Rd, [sp, #imm]
+	blo		4f
+	b		8f
+
+3:	ubfx	r2, r1, #6, #3		// Rm
+	cmp		r2, #7
+	beq		8f
+2:	ubfx	r2, r1, #3, #3		// Rn, Rm
+	cmp		r2, #7
+	beq		8f
+	ands	r2, r1, #7			// Rd
+	cmp		r2, #7
+	beq		8f
+	b		5f
+
+4:	ubfx	r2, r1, #8, #3		// Rd
+	cmp		r2, #7
+	beq		8f
+
+5:	adds	r0, #2
+	b		1b
+
+8:	movs	r0, #0
+9:	pop		{r1, r2, r3}
+	bx		lr
+
+.ltorg
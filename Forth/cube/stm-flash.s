@@ -65,22 +65,38 @@ flashpageerase:
 	ldr		r0, =FlashDictionaryAnfang
 eraseflash_intern:
 //	cpsid	i
+.ifdef dicttail
+	ldr		r1, =DictTailEnde	// the journal page too
+.else
 	ldr		r1, =FlashDictionaryEnde
+.endif
 	ldr		r2, =0xFFFF
 
-1:	ldrh	r3, [r0]
+	// first programmed halfword
+1:	cmp		r0, r1
+	beq		3f					// all erased
+	ldrh	r3, [r0]
 	cmp		r3, r2
-	beq		2f
+	bne		2f
+	adds	r0, r0, #2
+	b		1b
+
+	// last programmed halfword
+2:	subs	r1, r1, #2
+	ldrh	r3, [r1]
+	cmp		r3, r2
+	beq		2b
+	adds	r1, r1, #2
+
 	pushda	r0
-	dup
-	write	"Erase block at  "
-	bl	hexdot
-	writeln " from Flash"
-	bl		flashpageerase
-2:	adds	r0, r0, #2
-	cmp		r0, r1
-	bne		1b
-	writeln	"Finished. Reset !"
+	write	"Erase Flash from "
+	bl		hexdot
+	pushda	r1
+	write	"to "
+	bl		hexdot
+	writeln	""
+	bl		FLASH_eraseRange	// all pages in one burst
+3:	writeln	"Finished. Reset !"
 	pushdatos
 	ldr		tos, =500			// wait 500 ms to give some time for writeln
 	bl		rtos_osDelay
@@ -93,3 +109,53 @@ eraseflash_intern:
 	popda	r0
 	b.n		eraseflash_intern
 .ltorg
+
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "kv!" @ ( x c-addr u -- )
+	@ Stores x under the key c-addr u in the flash key-value store.
+// int KV_putCell(const char *key, int key_len, int value)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	movs	r1, tos		// key_len
+	drop
+	movs	r0, tos		// key
+	drop
+	movs	r2, tos		// value
+	drop
+	bl		KV_putCell
+	cmp		r0, #0		// KV_OK
+	beq		1f
+	writeln	"Err: kv store full or flash error"
+1:	pop		{r0-r3, pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "kv@" @ ( c-addr u -- x flag )
+	@ Fetches the value of the key c-addr u, flag is false if not found.
+// int KV_getCell(const char *key, int key_len, int *value)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	movs	r1, tos		// key_len
+	ldr		r0, [psp]	// key
+	movs	r2, psp		// value replaces the key
+	bl		KV_getCell
+	movs	tos, r0		// flag
+	pop		{r0-r3, pc}
+
+@ -----------------------------------------------------------------------------
+	Wortbirne Flag_visible, "kv-delete" @ ( c-addr u -- )
+	@ Removes the key c-addr u from the flash key-value store.
+// int KV_delete(const char *key, int key_len)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	movs	r1, tos		// key_len
+	drop
+	movs	r0, tos		// key
+	drop
+	bl		KV_delete
+	cmp		r0, #1		// KV_ERROR, a missing key is no error
+	bne		1f
+	writeln	"Err: flash error"
+1:	pop		{r0-r3, pc}
+
+.ltorg
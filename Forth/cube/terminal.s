@@ -75,6 +75,28 @@ serial_qkey:
 	pop		{r0-r3, pc}
 
 
+@ -----------------------------------------------------------------------------
+        Wortbirne Flag_visible, "serial-type"
+serial_type:
+        @ ( addr len -- ) Print a string, bulk write if emit is not redirected
+// int UART_write(const char *buffer, int length)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	ldr		r0, =hook_emit
+	ldr		r0, [r0]
+	ldr		r1, =serial_emit
+	cmp		r0, r1
+	bne		1f			// emit redirected (e.g. >file), char by char
+	ldm		psp!, {r0}	// addr
+	movs	r1, tos		// len
+	drop
+	bl		UART_write
+	pop		{r0-r3, pc}
+1:
+	bl		emit_type
+	pop		{r0-r3, pc}
+
+
 @ -----------------------------------------------------------------------------
         Wortbirne Flag_visible, "cdc-emit"
 cdc_emit:
@@ -119,6 +141,28 @@ cdc_qkey:
 	movs	tos, r0
 	pop		{r0-r3, pc}
 
+@ -----------------------------------------------------------------------------
+        Wortbirne Flag_visible, "cdc-type"
+cdc_type:
+        @ ( addr len -- ) Print a string, bulk write if emit is not redirected
+// int CDC_write(const char *buffer, int length)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	ldr		r0, =hook_emit
+	ldr		r0, [r0]
+	ldr		r1, =cdc_emit
+	cmp		r0, r1
+	bne		1f			// emit redirected (e.g. >file), char by char
+	ldm		psp!, {r0}	// addr
+	movs	r1, tos		// len
+	drop
+	bl		CDC_write
+	pop		{r0-r3, pc}
+1:
+	bl		emit_type
+	pop		{r0-r3, pc}
+
+
 @ -----------------------------------------------------------------------------
         Wortbirne Flag_visible, "crs-emit"
 crs_emit:
@@ -164,6 +208,74 @@ crs_qkey:
 	pop		{r0-r3, pc}
 
 
+@ -----------------------------------------------------------------------------
+        Wortbirne Flag_visible, "crs-type"
+crs_type:
+        @ ( addr len -- ) Print a string, bulk write if emit is not redirected
+// int CRSAPP_write(const char *buffer, int length)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	ldr		r0, =hook_emit
+	ldr		r0, [r0]
+	ldr		r1, =crs_emit
+	cmp		r0, r1
+	bne		1f			// emit redirected (e.g. >file), char by char
+	ldm		psp!, {r0}	// addr
+	movs	r1, tos		// len
+	drop
+	bl		CRSAPP_write
+	pop		{r0-r3, pc}
+1:
+	bl		emit_type
+	pop		{r0-r3, pc}
+
+
+@ -----------------------------------------------------------------------------
+        Wortbirne Flag_visible, "tee-emit"
+tee_emit:
+        @ ( c -- ) Emit one character to all tee sinks
+// int TEE_putc(int c)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	movs	r0, tos
+	drop
+	bl		TEE_putc
+	pop		{r0-r3, pc}
+
+@ -----------------------------------------------------------------------------
+        Wortbirne Flag_visible, "tee-emit?"
+tee_qemit:
+        @ ( -- ? ) Ready to send a character to all blocking tee sinks ?
+// int TEE_TxReady(void)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	pushdatos
+	bl		TEE_TxReady
+	movs	tos, r0
+	pop		{r0-r3, pc}
+
+@ -----------------------------------------------------------------------------
+        Wortbirne Flag_visible, "tee-type"
+tee_type:
+        @ ( addr len -- ) Print a string to all tee sinks
+// int TEE_write(const char *buffer, int length)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	ldr		r0, =hook_emit
+	ldr		r0, [r0]
+	ldr		r1, =tee_emit
+	cmp		r0, r1
+	bne		1f			// emit redirected (e.g. >file), char by char
+	ldm		psp!, {r0}	// addr
+	movs	r1, tos		// len
+	drop
+	bl		TEE_write
+	pop		{r0-r3, pc}
+1:
+	bl		emit_type
+	pop		{r0-r3, pc}
+
+
 @ -----------------------------------------------------------------------------
 		Wortbirne Flag_visible, "baudrate!"
 set_baudrate:
@@ -216,16 +328,44 @@ set_stopbits:
 	pop		{r0-r3, pc}
 
 
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "rtscts!"
+set_rtscts:
+		@ ( u --  ) sets hardware flow control 0 none, 1 RTS/CTS
+// void UART_setHwFlowCtl(const int flowctl)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	movs	r0, tos		// flowctl
+	drop
+	bl		UART_setHwFlowCtl
+	pop		{r0-r3, pc}
+
+
+@ -----------------------------------------------------------------------------
+		Wortbirne Flag_visible, "xonxoff!"
+set_xonxoff:
+		@ ( u --  ) sets software flow control (upload mode) 0 none, 1 XON/XOFF
+// void UART_setXonXoff(const int xonxoff)
+@ -----------------------------------------------------------------------------
+	push	{r0-r3, lr}
+	movs	r0, tos		// xonxoff
+	drop
+	bl		UART_setXonXoff
+	pop		{r0-r3, pc}
+
+
 // C Interface to some Forth Words
 //********************************
 
 // These functions call Forth words. They need a data stack SPS and
 // top of stack (TOS).
+// r8-r11 are saved too, Forth words compiled with the register cache
+// (registercache.s) use them.
 
 // uint64_t TERMINAL_emit(uint64_t forth_stack, uint8_t c);
 .global		TERMINAL_emit
 TERMINAL_emit:
-	push 	{r4-r7, lr}
+	push 	{r4-r11, lr}
 	movs	tos, r0		// get tos
 	movs	psp, r1		// get psp
 	pushdatos
@@ -233,13 +373,13 @@ TERMINAL_emit:
 	bl		emit
 	movs	r0, tos		// update tos
 	movs	r1, psp		// update psp
-	pop		{r4-r7, pc}
+	pop		{r4-r11, pc}
 
 
 // uint64_t TERMINAL_key(uint64_t forth_stack, uint8_t *c);
 .global		TERMINAL_key
 TERMINAL_key:
-	push 	{r4-r7, lr}
+	push 	{r4-r11, lr}
 	movs	tos, r0		// get tos
 	movs	psp, r1		// get psp
 	push	{r2}
@@ -249,13 +389,13 @@ TERMINAL_key:
 	drop
 	movs	r0, tos		// update tos
 	movs	r1, psp		// update psp
-	pop		{r4-r7, pc}
+	pop		{r4-r11, pc}
 
 
 // uint64_t TERMINAL_qemit(uint64_t forth_stack, uint8_t *c);
 .global		TERMINAL_qemit
 TERMINAL_qemit:
-	push 	{r4-r7, lr}
+	push 	{r4-r11, lr}
 	movs	tos, r0		// get tos
 	movs	psp, r1		// get psp
 	push	{r2}
@@ -265,13 +405,13 @@ TERMINAL_qemit:
 	drop
 	movs	r0, tos		// update tos
 	movs	r1, psp		// update psp
-	pop		{r4-r7, pc}
+	pop		{r4-r11, pc}
 
 
 // uint64_t TERMINAL_qkey(uint64_t forth_stack, uint8_t *c);
 .global		TERMINAL_qkey
 TERMINAL_qkey:
-	push 	{r4-r7, lr}
+	push 	{r4-r11, lr}
 	movs	tos, r0		// get tos
 	movs	psp, r1		// get psp
 	push	{r2}
@@ -281,7 +421,7 @@ TERMINAL_qkey:
 	drop
 	movs	r0, tos		// update tos
 	movs	r1, psp		// update psp
-	pop		{r4-r7, pc}
+	pop		{r4-r11, pc}
 
 
 
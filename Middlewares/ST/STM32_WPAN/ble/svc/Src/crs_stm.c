@@ -58,6 +58,8 @@ PLACE_IN_SECTION("BLE_DRIVER_CONTEXT") static CRSContext_t CRSContext;
  */
 /* Private function prototypes -----------------------------------------------*/
 static SVCCTL_EvtAckStatus_t CRS_Event_Handler(void *pckt);
+/* Exported function, not in crs_stm.h (see crs_app.c) */
+tBleStatus CRSAPP_Update_CharLength(uint16_t UUID, uint8_t *pPayload, uint8_t length);
 
 
 /* Functions Definition ------------------------------------------------------*/
@@ -87,7 +89,12 @@ do {\
     uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7], \
     uuid[8], uuid[9], uuid[10], uuid[11], uuid[12], uuid[13], uuid[14], uuid[15])
 
-#define CRS_MAX_RX_CHAR_LEN                                     CRS_MAX_DATA_LEN        /**< Maximum length of the RX Characteristic (in bytes). */
+/*
+ * The RX characteristic takes CRS_MAX_RX_CHAR_LEN + 19 (128 bit UUID) + 2*CFG_BLE_NUM_LINK
+ * (CCCD) = 188 bytes of CFG_BLE_ATT_VALUE_ARRAY_SIZE. GAP, GATT, DIS, HRS and CRS need
+ * about 600 of the 1344 bytes.
+ */
+#define CRS_MAX_RX_CHAR_LEN                                     (CFG_BLE_MAX_ATT_MTU-3) /**< Maximum length of the RX Characteristic (in bytes), notifications up to the ATT MTU. */
 #define CRS_MAX_TX_CHAR_LEN                                     CRS_MAX_DATA_LEN        /**< Maximum length of the TX Characteristic (in bytes). */
 
 
@@ -278,23 +285,35 @@ void CRS_STM_Init(void)
  * 
  */
 tBleStatus CRSAPP_Update_Char(uint16_t UUID, uint8_t *pPayload) 
+{
+  uint8_t size;
+
+  size = 0;
+  while(pPayload[size] != '\0')
+  {
+    size++;
+  }
+  return CRSAPP_Update_CharLength(UUID, pPayload, size);
+}/* end CRSAPP_Update_Char() */
+
+/**
+ * @brief  Characteristic update with binary data
+ * @param  UUID: UUID of the characteristic
+ * @param  pPayload: value, may contain '\0'
+ * @param  length: number of bytes
+ * 
+ */
+tBleStatus CRSAPP_Update_CharLength(uint16_t UUID, uint8_t *pPayload, uint8_t length) 
 {
   tBleStatus result = BLE_STATUS_INVALID_PARAMS;
   switch(UUID)
   {
     case CRS_RX_CHAR_UUID:
     {
-      uint8_t size;
-      
-      size = 0;
-      while(pPayload[size] != '\0')
-      {
-        size++;
-      }
       result = aci_gatt_update_char_value(CRSContext.SvcHdle,
                                           CRSContext.CRSRXCharHdle,
                                           0, /* charValOffset */
-                                          size/*CRS_MAX_RX_CHAR_LEN*/, /* charValueLen */
+                                          length, /* charValueLen */
                                           (uint8_t *)  pPayload);
     }
     break;
@@ -304,7 +323,7 @@ tBleStatus CRSAPP_Update_Char(uint16_t UUID, uint8_t *pPayload)
   }
 
   return result;
-}/* end CRSAPP_Update_Char() */
+}/* end CRSAPP_Update_CharLength() */
 
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -183,6 +183,10 @@ typedef struct
 #define BD_ADDR_SIZE_LOCAL    6
 
 /* USER CODE BEGIN PD */
+#define BLE_DEFAULT_ATT_MTU			23
+#define BLE_DEFAULT_MAX_TX_OCTETS	27
+#define BLE_MAX_TX_OCTETS			251
+#define BLE_MAX_TX_TIME				2120	// us for 251 bytes on 1M PHY
 
 /* USER CODE END PD */
 
@@ -249,6 +253,14 @@ uint8_t  manuf_data[14] = {
 /* USER CODE BEGIN PV */
 //static const uint8_t CRS_STM_UUID[] = { CRS_STM_UUID128 };
 
+// current link parameters
+static uint16_t LinkMTU = BLE_DEFAULT_ATT_MTU;
+static uint16_t LinkDataLength = BLE_DEFAULT_MAX_TX_OCTETS;
+static uint8_t LinkPHY = 1;
+static uint16_t LinkInterval;		// 1.25 ms units
+static uint16_t LinkLatency;		// connection events
+static uint16_t LinkTimeout;		// 10 ms units
+
 /* USER CODE END PV */
 
 /* Global variables ----------------------------------------------------------*/
@@ -451,6 +463,10 @@ SVCCTL_UserEvtFlowStatus_t SVCCTL_App_Notification( void *pckt )
       Adv_Request(APP_BLE_FAST_ADV);
       /* USER CODE BEGIN EVT_DISCONN_COMPLETE */
       BSP_setLED1(FALSE);
+      LinkMTU = BLE_DEFAULT_ATT_MTU;
+      LinkDataLength = BLE_DEFAULT_MAX_TX_OCTETS;
+      LinkPHY = 1;
+      CRSAPP_Disconnect();
       /* USER CODE END EVT_DISCONN_COMPLETE */
     }
 
@@ -468,6 +484,14 @@ SVCCTL_UserEvtFlowStatus_t SVCCTL_App_Notification( void *pckt )
           APP_DBG_MSG("\r\n\r** CONNECTION UPDATE EVENT WITH CLIENT \n");
 
           /* USER CODE BEGIN EVT_LE_CONN_UPDATE_COMPLETE */
+          {
+            hci_le_connection_update_complete_event_rp0 *conn_update_complete;
+
+            conn_update_complete = (hci_le_connection_update_complete_event_rp0 *) meta_evt->data;
+            LinkInterval = conn_update_complete->Conn_Interval;
+            LinkLatency = conn_update_complete->Conn_Latency;
+            LinkTimeout = conn_update_complete->Supervision_Timeout;
+          }
 
           /* USER CODE END EVT_LE_CONN_UPDATE_COMPLETE */
           break;
@@ -502,6 +526,10 @@ SVCCTL_UserEvtFlowStatus_t SVCCTL_App_Notification( void *pckt )
             APP_DBG_MSG("Read conf not succeess \n");
           }
           /* USER CODE BEGIN EVT_LE_PHY_UPDATE_COMPLETE */
+          if (ret == BLE_STATUS_SUCCESS)
+          {
+            LinkPHY = TX_PHY;
+          }
 
           /* USER CODE END EVT_LE_PHY_UPDATE_COMPLETE */          
           break;
@@ -530,11 +558,29 @@ SVCCTL_UserEvtFlowStatus_t SVCCTL_App_Notification( void *pckt )
           BleApplicationContext.BleApplicationContext_legacy.connectionHandle = connection_complete_event->Connection_Handle;
           /* USER CODE BEGIN HCI_EVT_LE_CONN_COMPLETE */
           BSP_setLED1(TRUE);
-          osThreadFlagsSet(CRS_ThreadId, CRSAPP_CONNECTED);
+          LinkInterval = connection_complete_event->Conn_Interval;
+          LinkLatency = connection_complete_event->Conn_Latency;
+          LinkTimeout = connection_complete_event->Supervision_Timeout;
+
+          // larger ATT MTU, data length extension and 2M PHY if the peer supports it
+          aci_gatt_exchange_config(connection_complete_event->Connection_Handle);
+          hci_le_set_data_length(connection_complete_event->Connection_Handle,
+              BLE_MAX_TX_OCTETS, BLE_MAX_TX_TIME);
+          hci_le_set_phy(connection_complete_event->Connection_Handle,
+              ALL_PHYS_PREFERENCE, TX_2M_PREFERRED, RX_2M_PREFERRED, 0);
           /* USER CODE END HCI_EVT_LE_CONN_COMPLETE */
         }
         break; /* HCI_EVT_LE_CONN_COMPLETE */
 
+        case EVT_LE_DATA_LENGTH_CHANGE:
+        {
+          hci_le_data_length_change_event_rp0 *data_length_change;
+
+          data_length_change = (hci_le_data_length_change_event_rp0 *) meta_evt->data;
+          LinkDataLength = data_length_change->MaxTxOctets;
+        }
+        break; /* EVT_LE_DATA_LENGTH_CHANGE */
+
         default:
           /* USER CODE BEGIN SUBEVENT_DEFAULT */
 
@@ -554,6 +600,23 @@ SVCCTL_UserEvtFlowStatus_t SVCCTL_App_Notification( void *pckt )
       /* USER CODE BEGIN ecode */
         aci_gap_pairing_complete_event_rp0 *pairing_complete;
 
+      case EVT_BLUE_ATT_EXCHANGE_MTU_RESP:
+      {
+        aci_att_exchange_mtu_resp_event_rp0 *exchange_mtu_resp;
+
+        exchange_mtu_resp = (aci_att_exchange_mtu_resp_event_rp0 *) blue_evt->data;
+        LinkMTU = exchange_mtu_resp->Server_RX_MTU;
+        if (LinkMTU > CFG_BLE_MAX_ATT_MTU) {
+          LinkMTU = CFG_BLE_MAX_ATT_MTU;
+        }
+      }
+          break; /* EVT_BLUE_ATT_EXCHANGE_MTU_RESP */
+
+      case EVT_BLUE_GATT_TX_POOL_AVAILABLE:
+        // buffers for notifications available again
+        osThreadFlagsSet(CRS_ThreadId, CRSAPP_TX_POOL);
+          break; /* EVT_BLUE_GATT_TX_POOL_AVAILABLE */
+
       case EVT_BLUE_GAP_LIMITED_DISCOVERABLE:
         APP_DBG_MSG("\r\n\r** EVT_BLUE_GAP_LIMITED_DISCOVERABLE \n");
           break; /* EVT_BLUE_GAP_LIMITED_DISCOVERABLE */
@@ -647,6 +710,77 @@ APP_BLE_ConnStatus_t APP_BLE_Get_Server_Connection_Status(void)
 
 /* USER CODE BEGIN FD*/
 
+/**
+ *  @brief
+ *      Negotiated ATT MTU.
+ *  @return
+ *      MTU in bytes
+ */
+int APP_BLE_getMTU(void) {
+	return LinkMTU;
+}
+
+/**
+ *  @brief
+ *      Max. payload of a link layer packet (data length extension).
+ *  @return
+ *      octets
+ */
+int APP_BLE_getDataLength(void) {
+	return LinkDataLength;
+}
+
+/**
+ *  @brief
+ *      Tx PHY.
+ *  @return
+ *      1 for 1M PHY, 2 for 2M PHY, 3 coded PHY
+ */
+int APP_BLE_getPHY(void) {
+	return LinkPHY;
+}
+
+/**
+ *  @brief
+ *      Connection interval.
+ *  @return
+ *      interval in us
+ */
+int APP_BLE_getConnInterval(void) {
+	return LinkInterval * 1250;
+}
+
+/**
+ *  @brief
+ *      Requests a new connection interval from the central.
+ *
+ *      Slave latency and supervision timeout are kept. The supervision
+ *      timeout has to be longer than (1 + latency) * interval * 2.
+ *  @param[in]
+ *      interval   interval in us (7500 to 4000000)
+ *  @return
+ *      BLE status, BLE_STATUS_INVALID_PARAMS if the interval is out of
+ *      range or too long for the supervision timeout
+ */
+int APP_BLE_setConnInterval(int interval) {
+	uint16_t conn_interval;
+
+	if (BleApplicationContext.Device_Connection_Status != APP_BLE_CONNECTED_SERVER) {
+		return BLE_STATUS_FAILED;
+	}
+	if (interval < 7500 || interval > 4000000) {
+		return BLE_STATUS_INVALID_PARAMS;
+	}
+	conn_interval = interval / 1250;
+	// timeout in 10 ms, interval in 1.25 ms units
+	if ((uint32_t)LinkTimeout * 4 <= (uint32_t)(1 + LinkLatency) * conn_interval) {
+		return BLE_STATUS_INVALID_PARAMS;
+	}
+	return aci_l2cap_connection_parameter_update_req(
+			BleApplicationContext.BleApplicationContext_legacy.connectionHandle,
+			conn_interval, conn_interval, LinkLatency, LinkTimeout);
+}
+
 /* USER CODE END FD*/
 /*************************************************************
  *
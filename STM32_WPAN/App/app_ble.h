@@ -73,6 +73,11 @@ extern "C" {
   APP_BLE_ConnStatus_t APP_BLE_Get_Server_Connection_Status(void);
 
 /* USER CODE BEGIN EF */
+  int APP_BLE_getMTU(void);
+  int APP_BLE_getDataLength(void);
+  int APP_BLE_getPHY(void);
+  int APP_BLE_getConnInterval(void);
+  int APP_BLE_setConnInterval(int interval);
 
 /* USER CODE END EF */
 
@@ -2,7 +2,11 @@
  *  @brief
  *      Cable Replacement Server CRS (for GAP Peripheral Role).
  *
- *      Using CMSIS-RTOS queues as buffers.
+ *      Tx: CRSAPP_putc() writes into a ring buffer, the CRS thread sends
+ *      notifications as long as the BLE stack has buffers. If the stack is
+ *      out of buffers, the thread waits for the TX pool available event.
+ *      The notifications are as large as the negotiated ATT MTU allows.
+ *      Rx: written data goes into a ring buffer.
  *  @file
  *      crs_app.c
  *  @author
@@ -32,6 +36,7 @@
 // ********************
 #include "cmsis_os.h"
 #include <stdio.h>
+#include <string.h>
 
 // Application include files
 // *************************
@@ -42,19 +47,26 @@
 #include "dbg_trace.h"
 #include "ble.h"
 #include "crs_stm.h"
+#include "app_ble.h"
 
 
 // Rx/Tx Buffer Length
 // *******************
 #define CRS_TX_BUFFER_LENGTH	1024
 #define CRS_RX_BUFFER_LENGTH	1024
+#define CRS_KEY_BUFFER_LENGTH	256
 
-// max. Tx tries
-#define MAX_TRIES				50
+// max. notification payload (ATT MTU - 3 bytes ATT header)
+#define CRS_MAX_CHUNK			(CFG_BLE_MAX_ATT_MTU - 3)
 
 // Private function prototypes
 // ***************************
 static void CRS_Thread(void *argument);
+static int crs_txCount(void);
+static int crs_rxCount(void);
+
+// crs_stm.c, not in the ST header crs_stm.h
+tBleStatus CRSAPP_Update_CharLength(uint16_t UUID, uint8_t *pPayload, uint8_t length);
 
 // Global Variables
 // ****************
@@ -78,19 +90,40 @@ const osMutexAttr_t CRS_MutexAttr = {
 		0U					// size for control block
 };
 
-// Definitions for TxQueue
-static osMessageQueueId_t CRS_TxQueueId;
-static const osMessageQueueAttr_t crs_TxQueue_attributes = {
-		.name = "CRS_TxQueue"
+// Definitions for TxSemaphore, released by the CRS thread
+static osSemaphoreId_t CRS_TxSemaphoreID;
+static const osSemaphoreAttr_t crs_TxSemaphore_attributes = {
+		.name = "CRS_TxSemaphore"
+};
+
+// Definitions for RxSemaphore, released by CRSAPP_Notification()
+static osSemaphoreId_t CRS_RxSemaphoreID;
+static const osSemaphoreAttr_t crs_RxSemaphore_attributes = {
+		.name = "CRS_RxSemaphore"
 };
 
-// Definitions for RxQueue
-static osMessageQueueId_t CRS_RxQueueId;
-static const osMessageQueueAttr_t crs_RxQueue_attributes = {
-		.name = "CRS_RxQueue"
+// Definitions for KeyQueue (redirected output, see CRSAPP_putkey())
+static osMessageQueueId_t CRS_KeyQueueId;
+static const osMessageQueueAttr_t crs_KeyQueue_attributes = {
+		.name = "CRS_KeyQueue"
 };
 
 
+// Private Variables
+// *****************
+
+// Tx ring buffer
+static uint8_t CRS_TxBuffer[CRS_TX_BUFFER_LENGTH];
+static volatile uint32_t CRS_TxHead = 0;	// write index
+static volatile uint32_t CRS_TxTail = 0;	// read index (CRS thread)
+static volatile int CRS_NotifyEnabled = FALSE;	// client subscribed
+
+// Rx ring buffer
+static uint8_t CRS_RxBuffer[CRS_RX_BUFFER_LENGTH];
+static volatile uint32_t CRS_RxHead = 0;	// write index (BLE event)
+static volatile uint32_t CRS_RxTail = 0;	// read index
+
+
 // Public Functions
 // ****************
 
@@ -102,16 +135,20 @@ static const osMessageQueueAttr_t crs_RxQueue_attributes = {
  */
 void CRSAPP_Init(void) {
 	// Create the queue(s)
-	// creation of TxQueue
-	CRS_TxQueueId = osMessageQueueNew(CRS_TX_BUFFER_LENGTH, sizeof(uint8_t),
-			&crs_TxQueue_attributes);
-	if (CRS_TxQueueId == NULL) {
+	// creation of KeyQueue
+	CRS_KeyQueueId = osMessageQueueNew(CRS_KEY_BUFFER_LENGTH, sizeof(uint8_t),
+			&crs_KeyQueue_attributes);
+	if (CRS_KeyQueueId == NULL) {
+		Error_Handler();
+	}
+
+	CRS_TxSemaphoreID = osSemaphoreNew(1, 0, &crs_TxSemaphore_attributes);
+	if (CRS_TxSemaphoreID == NULL) {
 		Error_Handler();
 	}
-	// creation of RxQueue
-	CRS_RxQueueId = osMessageQueueNew(CRS_RX_BUFFER_LENGTH, sizeof(uint8_t),
-			&crs_RxQueue_attributes);
-	if (CRS_RxQueueId == NULL) {
+
+	CRS_RxSemaphoreID = osSemaphoreNew(1, 0, &crs_RxSemaphore_attributes);
+	if (CRS_RxSemaphoreID == NULL) {
 		Error_Handler();
 	}
 
@@ -138,23 +175,41 @@ void CRSAPP_Init(void) {
  */
 int CRSAPP_getc(void) {
 	uint8_t c;
-	if (osMessageQueueGet(CRS_RxQueueId, &c, NULL, osWaitForever) == osOK) {
-		return c;
-	} else {
-		Error_Handler();
-		return EOF;
+
+	// redirected output first
+	if (osMessageQueueGetCount(CRS_KeyQueueId) > 0) {
+		if (osMessageQueueGet(CRS_KeyQueueId, &c, NULL, 0) == osOK) {
+			return c;
+		}
+	}
+
+	while (crs_rxCount() == 0) {
+		// blocked till data is written by the client
+		if (osSemaphoreAcquire(CRS_RxSemaphoreID, osWaitForever) != osOK) {
+			Error_Handler();
+			return EOF;
+		}
+		if (osMessageQueueGetCount(CRS_KeyQueueId) > 0) {
+			if (osMessageQueueGet(CRS_KeyQueueId, &c, NULL, 0) == osOK) {
+				return c;
+			}
+		}
 	}
+
+	c = CRS_RxBuffer[CRS_RxTail];
+	CRS_RxTail = (CRS_RxTail + 1) % CRS_RX_BUFFER_LENGTH;
+	return c;
 }
 
 
 /**
  *  @brief
- *		There is a character in the queue (key pressed).
+ *		There is a character in the buffer (key pressed).
  *  @return
  *		TRUE if a character has been received.
  */
 int CRSAPP_RxReady(void) {
-	if (osMessageQueueGetCount(CRS_RxQueueId) == 0) {
+	if (crs_rxCount() == 0 && osMessageQueueGetCount(CRS_KeyQueueId) == 0) {
 		return FALSE;
 	} else {
 		return TRUE;
@@ -164,31 +219,106 @@ int CRSAPP_RxReady(void) {
 
 /**
  *  @brief
- *      Writes a char to the CRS Tx (serial out). Blocking until char can be
- *      written into the queue.
+ *      Writes a char to the CRS Tx (serial out). Blocking only if the ring
+ *      buffer is full.
  *  @param[in]
  *      c  char to write
  *  @return
  *      Return EOF on error, 0 on success.
  */
 int CRSAPP_putc(int c) {
-	if (osMessageQueuePut(CRS_TxQueueId, &c, 0, osWaitForever) == osOK) {
-		return 0;
-	} else {
-		Error_Handler();
-		return EOF;
+	uint32_t next;
+	int was_empty;
+
+	for (;;) {
+		osMutexAcquire(CRS_MutexID, osWaitForever);
+		next = (CRS_TxHead + 1) % CRS_TX_BUFFER_LENGTH;
+		if (next != CRS_TxTail) {
+			was_empty = (CRS_TxHead == CRS_TxTail);
+			CRS_TxBuffer[CRS_TxHead] = (uint8_t) c;
+			CRS_TxHead = next;
+			osMutexRelease(CRS_MutexID);
+			if (was_empty) {
+				// wake up the CRS thread
+				osThreadFlagsSet(CRS_ThreadId, CRSAPP_TX_DATA);
+			}
+			return 0;
+		}
+		osMutexRelease(CRS_MutexID);
+
+		// buffer full, blocked till the CRS thread has sent a notification
+		if (osSemaphoreAcquire(CRS_TxSemaphoreID, osWaitForever) != osOK) {
+			Error_Handler();
+			return EOF;
+		}
+	}
+}
+
+
+/**
+ *  @brief
+ *      Writes a buffer to the CRS Tx (serial out). The buffer is copied in
+ *      contiguous chunks into the ring buffer, blocking only if the ring
+ *      buffer is full.
+ *  @param[in]
+ *      buffer  data to write
+ *  @param[in]
+ *      length  number of bytes to write
+ *  @return
+ *      Return EOF on error, number of bytes written on success.
+ */
+int CRSAPP_write(const char *buffer, int length) {
+	uint32_t head;
+	uint32_t tail;
+	int count;
+	int written = 0;
+
+	while (written < length) {
+		osMutexAcquire(CRS_MutexID, osWaitForever);
+		head = CRS_TxHead;
+		tail = CRS_TxTail;
+		// free contiguous space, one byte is always left empty
+		if (head >= tail) {
+			count = CRS_TX_BUFFER_LENGTH - head;
+			if (tail == 0) {
+				count--;
+			}
+		} else {
+			count = tail - head - 1;
+		}
+		if (count > length - written) {
+			count = length - written;
+		}
+		if (count > 0) {
+			memcpy(&CRS_TxBuffer[head], &buffer[written], count);
+			CRS_TxHead = (head + count) % CRS_TX_BUFFER_LENGTH;
+			written += count;
+		}
+		osMutexRelease(CRS_MutexID);
+
+		if (count > 0) {
+			// wake up the CRS thread
+			osThreadFlagsSet(CRS_ThreadId, CRSAPP_TX_DATA);
+		} else {
+			// buffer full, blocked till the CRS thread has sent a notification
+			if (osSemaphoreAcquire(CRS_TxSemaphoreID, osWaitForever) != osOK) {
+				Error_Handler();
+				return EOF;
+			}
+		}
 	}
+	return written;
 }
 
 
 /**
  *  @brief
- *      Tx queue ready for next char.
+ *      Tx buffer ready for next char.
  *  @return
  *      FALSE if the buffer is full.
  */
 int CRSAPP_TxReady(void) {
-	if (osMessageQueueGetSpace(CRS_TxQueueId) > 0) {
+	if ((CRS_TxHead + 1) % CRS_TX_BUFFER_LENGTH != CRS_TxTail) {
 		return TRUE;
 	} else {
 		return FALSE;
@@ -196,6 +326,17 @@ int CRSAPP_TxReady(void) {
 }
 
 
+/**
+ *  @brief
+ *      Free space in the Tx buffer.
+ *  @return
+ *      Number of chars that can be written without blocking.
+ */
+int CRSAPP_TxFree(void) {
+	return (CRS_TxTail + CRS_TX_BUFFER_LENGTH - CRS_TxHead - 1) % CRS_TX_BUFFER_LENGTH;
+}
+
+
 /**
  *  @brief
  *      Writes a char direct into the key queue.
@@ -211,8 +352,10 @@ int CRSAPP_putkey(const char c) {
 		// eat CR
 		return 0;
 	}
-	status = osMessageQueuePut(CRS_RxQueueId, &c, 0, osWaitForever);
+	status = osMessageQueuePut(CRS_KeyQueueId, &c, 0, osWaitForever);
 	if (status == osOK) {
+		// wake up a blocked reader
+		osSemaphoreRelease(CRS_RxSemaphoreID);
 		return 0;
 	} else {
 		Error_Handler();
@@ -230,32 +373,37 @@ int CRSAPP_putkey(const char c) {
  *      none
  */
 void CRSAPP_Notification(CRSAPP_Notification_evt_t *pNotification) {
-	uint8_t buffer;
 	uint32_t i;
-	osStatus_t status;
+	uint32_t head;
 
 	switch(pNotification->CRS_Evt_Opcode) {
 	case CRS_WRITE_EVT:
 		APP_DBG_MSG("CRS_WRITE_EVT: Data received: %s \n", pNotification->DataTransfered.pPayload);
-		pNotification->DataTransfered.pPayload[pNotification->DataTransfered.Length] = '\0';
 
+		// write the data into the Rx ring buffer, no flow control with
+		// write without response -> characters are lost if the buffer is full
+		head = CRS_RxHead;
 		for (i=0; i<pNotification->DataTransfered.Length; i++) {
-			buffer = pNotification->DataTransfered.pPayload[i];
-			status = osMessageQueuePut(CRS_RxQueueId, &buffer, 0, 0);
-			if (status != osOK) {
-				// can't put char into queue
-				Error_Handler();
+			if ((head + 1) % CRS_RX_BUFFER_LENGTH == CRS_RxTail) {
 				break;
 			}
+			CRS_RxBuffer[head] = pNotification->DataTransfered.pPayload[i];
+			head = (head + 1) % CRS_RX_BUFFER_LENGTH;
 		}
+		CRS_RxHead = head;
+		osSemaphoreRelease(CRS_RxSemaphoreID);
 		break;
 
 	case CRS_NOTIFY_ENABLED_EVT:
 		APP_DBG_MSG("CRS_NOTIFY_ENABLED_EVT\n");
+		// terminal ready, start the output
+		CRS_NotifyEnabled = TRUE;
+		osThreadFlagsSet(CRS_ThreadId, CRSAPP_NOTIFY);
 		break;
 
 	case CRS_NOTIFY_DISABLED_EVT:
 		APP_DBG_MSG("CRS_NOTIFY_DISABLED_EVT\n");
+		CRS_NotifyEnabled = FALSE;
 		break;
 
 	default:
@@ -264,53 +412,102 @@ void CRSAPP_Notification(CRSAPP_Notification_evt_t *pNotification) {
 }
 
 
+/**
+ *  @brief
+ *      The client has disconnected.
+ *
+ *      Called from the EVT_DISCONN_COMPLETE event (app_ble.c). The
+ *      notifications are off till the next client subscribes, the CRS
+ *      thread is woken up if it waits for the TX pool of the lost link.
+ *  @return
+ *      none
+ */
+void CRSAPP_Disconnect(void) {
+	CRS_NotifyEnabled = FALSE;
+	osThreadFlagsSet(CRS_ThreadId, CRSAPP_TX_POOL);
+}
+
+
 /**
   * @brief
   * 	Function implementing the CRS thread.
+  *
+  * 	Sends notifications till the BLE stack is out of buffers
+  * 	(BLE_STATUS_INSUFFICIENT_RESOURCES), then waits for the TX pool
+  * 	available event (see app_ble.c).
   * @param
   * 	argument: Not used
   * @retval
   * 	None
   */
 static void CRS_Thread(void *argument) {
-	uint8_t buffer[CRS_MAX_DATA_LEN];
-	uint32_t count;
-	uint8_t i;
+	uint8_t buffer[CRS_MAX_CHUNK];
+	int count;
+	int chunk;
+	int i;
 	tBleStatus status;
-	uint8_t tries;
-
-	// blocked till connected
-	osThreadFlagsWait(CRSAPP_CONNECTED, osFlagsWaitAny, osWaitForever);
-	osDelay(3000);
 
 	// Infinite loop
 	for(;;) {
-		// blocked till a character is in the Tx queue
-		if (osMessageQueueGet(CRS_TxQueueId, &buffer[0], 0, osWaitForever) == osOK) {
-			count = osMessageQueueGetCount(CRS_TxQueueId);
-			if (count > CRS_MAX_DATA_LEN-2) {
-				count = CRS_MAX_DATA_LEN-2;
-			}
-			for (i=1; i<count+1; i++) {
-				osMessageQueueGet(CRS_TxQueueId, &buffer[i], 0, osWaitForever);
-			}
-			buffer[count+1] = '\0';
-			// send the characters
-			status = BLE_STATUS_TIMEOUT;
-			tries = 0;
-			while (status != BLE_STATUS_SUCCESS) {
-				// not elegant but it works
-				status = CRSAPP_Update_Char(CRS_RX_CHAR_UUID, (uint8_t *)&buffer[0]);
-				if (status != BLE_STATUS_SUCCESS && tries++ > MAX_TRIES) {
-					Error_Handler();
-					break;
-				}
-				osDelay(10);
-			}
-		} else {
-			// can't write to the queue
-			Error_Handler();
+		if (! CRS_NotifyEnabled) {
+			// blocked till the client subscribes to the notifications, the
+			// buffered output is sent in full chunks afterwards
+			osThreadFlagsWait(CRSAPP_NOTIFY, osFlagsWaitAny, osWaitForever);
+			continue;
+		}
+		count = crs_txCount();
+		if (count == 0) {
+			// blocked till a character is in the Tx buffer
+			osThreadFlagsWait(CRSAPP_TX_DATA, osFlagsWaitAny, osWaitForever);
+			continue;
+		}
+		// chunk size given by the negotiated MTU
+		chunk = APP_BLE_getMTU() - 3;
+		if (chunk > CRS_MAX_CHUNK) {
+			chunk = CRS_MAX_CHUNK;
 		}
+		if (count > chunk) {
+			count = chunk;
+		}
+		for (i=0; i<count; i++) {
+			buffer[i] = CRS_TxBuffer[(CRS_TxTail + i) % CRS_TX_BUFFER_LENGTH];
+		}
+
+		// send the characters, binary data (0x00) too
+		osThreadFlagsClear(CRSAPP_TX_POOL);
+		status = CRSAPP_Update_CharLength(CRS_RX_CHAR_UUID, buffer, count);
+		if (status == BLE_STATUS_INSUFFICIENT_RESOURCES) {
+			// no more buffers in the stack, wait for the TX pool available event
+			osThreadFlagsWait(CRSAPP_TX_POOL, osFlagsWaitAny, osWaitForever);
+			continue;
+		}
+		// sent (or not connected/subscribed -> discard)
+		CRS_TxTail = (CRS_TxTail + count) % CRS_TX_BUFFER_LENGTH;
+		osSemaphoreRelease(CRS_TxSemaphoreID);
 	}
 }
 
+
+// Private Functions
+// *****************
+
+/**
+  * @brief
+  * 	Number of characters in the Tx ring buffer.
+  * @retval
+  * 	Number of characters
+  */
+static int crs_txCount(void) {
+	return (CRS_TxHead + CRS_TX_BUFFER_LENGTH - CRS_TxTail) % CRS_TX_BUFFER_LENGTH;
+}
+
+
+/**
+  * @brief
+  * 	Number of characters in the Rx ring buffer.
+  * @retval
+  * 	Number of characters
+  */
+static int crs_rxCount(void) {
+	return (CRS_RxHead + CRS_RX_BUFFER_LENGTH - CRS_RxTail) % CRS_RX_BUFFER_LENGTH;
+}
@@ -35,10 +35,15 @@ extern "C"
 extern osThreadId_t CRS_ThreadId;
 
 /* Exported macros -----------------------------------------------------------*/
-#define CRSAPP_CONNECTED	1
+#define CRSAPP_NOTIFY		0x01	// client enabled the notifications
+#define CRSAPP_TX_DATA		0x02	// Tx ring buffer not empty
+#define CRSAPP_TX_POOL		0x04	// BLE stack has free Tx buffers
 
 /* Exported functions ------------------------------------------------------- */
 void CRSAPP_Init( void );
+void CRSAPP_Disconnect(void);
+int CRSAPP_write(const char *buffer, int length);
+int CRSAPP_TxFree(void);
 
 
 #ifdef __cplusplus
@@ -195,6 +195,7 @@ static int8_t CDC_DeInit_FS(void)
 {
   /* USER CODE BEGIN 4 */
 //  osEventFlagsClear(CDC_EvtFlagsID, CDC_CONNECTED);
+  osEventFlagsClear(CDC_EvtFlagsID, CDC_DTR);
   return (USBD_OK);
   /* USER CODE END 4 */
 }
@@ -269,7 +270,13 @@ static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
     break;
 
     case CDC_SET_CONTROL_LINE_STATE:
-
+    	// pbuf is the setup request, wValue bit 0 is DTR
+    	if (((USBD_SetupReqTypedef *) pbuf)->wValue & 0x0001) {
+    		// terminal ready, start the output
+    		osEventFlagsSet(CDC_EvtFlagsID, CDC_DTR);
+    	} else {
+    		osEventFlagsClear(CDC_EvtFlagsID, CDC_DTR);
+    	}
     break;
 
     case CDC_SEND_BREAK:
@@ -302,17 +309,12 @@ static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
 static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 {
   /* USER CODE BEGIN 6 */
-	int i;
-	// write the Buf into the Rx queue
-	for (i=0; i<*Len; i++) {
-		if (osMessageQueuePut(CDC_RxQueueId, Buf+i, 0, 0) != osOK) {
-			// can't put char into queue
-			Error_Handler();
-		}
+	// write the Buf into the Rx ring buffer
+	USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &Buf[0]);
+	if (CDC_receive(Buf, *Len)) {
+		USBD_CDC_ReceivePacket(&hUsbDeviceFS);
 	}
-
-  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &Buf[0]);
-  USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+	// else NAK till CDC_getc() re-arms the endpoint
   return (USBD_OK);
   /* USER CODE END 6 */
 }
@@ -0,0 +1,292 @@
+/**
+ *  @brief
+ *      USB composite device: CDC (virtual COM port) and mass storage.
+ *
+ *      Wraps the unchanged USBD_CDC class. The CDC keeps pClassData and
+ *      pUserData, the mass storage (usbd_msc.c) has its own state.
+ *      Requests for interface 2 and endpoint 3 go to the mass storage,
+ *      everything else to the CDC. The CDC functions are grouped by an
+ *      interface association descriptor (IAD), the device descriptor uses
+ *      the class codes EF/02/01 (see usbd_desc.c).
+ *
+ *      Endpoints: 0x81/0x01 CDC data, 0x82 CDC command, 0x83/0x03 MSC.
+ *  @file
+ *      usbd_composite.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// Application include files
+// *************************
+#include "usbd_composite.h"
+#include "usbd_cdc.h"
+#include "usbd_msc.h"
+#include "usbd_ctlreq.h"
+
+
+// Private function prototypes
+// ***************************
+static uint8_t composite_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t composite_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t composite_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+static uint8_t composite_EP0_RxReady(USBD_HandleTypeDef *pdev);
+static uint8_t composite_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static uint8_t composite_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static uint8_t *composite_GetCfgDesc(uint16_t *length);
+static uint8_t *composite_GetDeviceQualifierDesc(uint16_t *length);
+
+// Global Variables
+// ****************
+
+USBD_ClassTypeDef USBD_COMPOSITE = {
+		composite_Init,
+		composite_DeInit,
+		composite_Setup,
+		NULL,				// EP0_TxSent
+		composite_EP0_RxReady,
+		composite_DataIn,
+		composite_DataOut,
+		NULL,
+		NULL,
+		NULL,
+		composite_GetCfgDesc,	// HS
+		composite_GetCfgDesc,	// FS
+		composite_GetCfgDesc,	// other speed
+		composite_GetDeviceQualifierDesc,
+};
+
+
+// Private Variables
+// *****************
+
+__ALIGN_BEGIN static uint8_t composite_CfgDesc[USB_COMPOSITE_CONFIG_DESC_SIZ] __ALIGN_END = {
+		// Configuration Descriptor
+		0x09,								// bLength
+		USB_DESC_TYPE_CONFIGURATION,		// bDescriptorType
+		LOBYTE(USB_COMPOSITE_CONFIG_DESC_SIZ),	// wTotalLength
+		HIBYTE(USB_COMPOSITE_CONFIG_DESC_SIZ),
+		0x03,								// bNumInterfaces
+		0x01,								// bConfigurationValue
+		0x00,								// iConfiguration
+		0xC0,								// bmAttributes: self powered
+		0x32,								// MaxPower 100 mA
+
+		// Interface Association Descriptor, CDC
+		0x08,								// bLength
+		0x0B,								// bDescriptorType: IAD
+		0x00,								// bFirstInterface
+		0x02,								// bInterfaceCount
+		0x02,								// bFunctionClass: CDC
+		0x02,								// bFunctionSubClass: ACM
+		0x01,								// bFunctionProtocol: AT commands
+		0x00,								// iFunction
+
+		// CDC Communication Interface
+		0x09,								// bLength
+		USB_DESC_TYPE_INTERFACE,			// bDescriptorType
+		0x00,								// bInterfaceNumber
+		0x00,								// bAlternateSetting
+		0x01,								// bNumEndpoints
+		0x02,								// bInterfaceClass: CDC
+		0x02,								// bInterfaceSubClass: ACM
+		0x01,								// bInterfaceProtocol: AT commands
+		0x00,								// iInterface
+
+		// Header Functional Descriptor
+		0x05,								// bLength
+		0x24,								// bDescriptorType: CS_INTERFACE
+		0x00,								// bDescriptorSubtype: Header
+		0x10,								// bcdCDC 1.10
+		0x01,
+
+		// Call Management Functional Descriptor
+		0x05,								// bFunctionLength
+		0x24,								// bDescriptorType: CS_INTERFACE
+		0x01,								// bDescriptorSubtype: Call Management
+		0x00,								// bmCapabilities
+		0x01,								// bDataInterface
+
+		// ACM Functional Descriptor
+		0x04,								// bFunctionLength
+		0x24,								// bDescriptorType: CS_INTERFACE
+		0x02,								// bDescriptorSubtype: ACM
+		0x02,								// bmCapabilities
+
+		// Union Functional Descriptor
+		0x05,								// bFunctionLength
+		0x24,								// bDescriptorType: CS_INTERFACE
+		0x06,								// bDescriptorSubtype: Union
+		0x00,								// bMasterInterface
+		0x01,								// bSlaveInterface0
+
+		// CDC Command Endpoint
+		0x07,								// bLength
+		USB_DESC_TYPE_ENDPOINT,				// bDescriptorType
+		CDC_CMD_EP,							// bEndpointAddress
+		0x03,								// bmAttributes: Interrupt
+		LOBYTE(CDC_CMD_PACKET_SIZE),		// wMaxPacketSize
+		HIBYTE(CDC_CMD_PACKET_SIZE),
+		CDC_FS_BINTERVAL,					// bInterval
+
+		// CDC Data Interface
+		0x09,								// bLength
+		USB_DESC_TYPE_INTERFACE,			// bDescriptorType
+		0x01,								// bInterfaceNumber
+		0x00,								// bAlternateSetting
+		0x02,								// bNumEndpoints
+		0x0A,								// bInterfaceClass: CDC data
+		0x00,								// bInterfaceSubClass
+		0x00,								// bInterfaceProtocol
+		0x00,								// iInterface
+
+		// CDC OUT Endpoint
+		0x07,								// bLength
+		USB_DESC_TYPE_ENDPOINT,				// bDescriptorType
+		CDC_OUT_EP,							// bEndpointAddress
+		0x02,								// bmAttributes: Bulk
+		LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),	// wMaxPacketSize
+		HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
+		0x00,								// bInterval
+
+		// CDC IN Endpoint
+		0x07,								// bLength
+		USB_DESC_TYPE_ENDPOINT,				// bDescriptorType
+		CDC_IN_EP,							// bEndpointAddress
+		0x02,								// bmAttributes: Bulk
+		LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),	// wMaxPacketSize
+		HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
+		0x00,								// bInterval
+
+		// Mass Storage Interface
+		0x09,								// bLength
+		USB_DESC_TYPE_INTERFACE,			// bDescriptorType
+		MSC_INTERFACE,						// bInterfaceNumber
+		0x00,								// bAlternateSetting
+		0x02,								// bNumEndpoints
+		0x08,								// bInterfaceClass: Mass Storage
+		0x06,								// bInterfaceSubClass: SCSI transparent
+		0x50,								// bInterfaceProtocol: Bulk-Only
+		0x00,								// iInterface
+
+		// MSC IN Endpoint
+		0x07,								// bLength
+		USB_DESC_TYPE_ENDPOINT,				// bDescriptorType
+		MSC_IN_EP,							// bEndpointAddress
+		0x02,								// bmAttributes: Bulk
+		LOBYTE(MSC_MAX_PACKET),				// wMaxPacketSize
+		HIBYTE(MSC_MAX_PACKET),
+		0x00,								// bInterval
+
+		// MSC OUT Endpoint
+		0x07,								// bLength
+		USB_DESC_TYPE_ENDPOINT,				// bDescriptorType
+		MSC_OUT_EP,							// bEndpointAddress
+		0x02,								// bmAttributes: Bulk
+		LOBYTE(MSC_MAX_PACKET),				// wMaxPacketSize
+		HIBYTE(MSC_MAX_PACKET),
+		0x00								// bInterval
+};
+
+
+// Private Functions
+// *****************
+
+static uint8_t composite_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx) {
+	uint8_t ret;
+
+	ret = USBD_CDC.Init(pdev, cfgidx);
+	if (ret != (uint8_t)USBD_OK) {
+		return ret;
+	}
+	return MSC_Init(pdev);
+}
+
+
+static uint8_t composite_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx) {
+	(void)MSC_DeInit(pdev);
+	return USBD_CDC.DeInit(pdev, cfgidx);
+}
+
+
+/**
+ *  @brief
+ *      Routes the setup request by the interface or endpoint number.
+ *  @param[in]
+ *      pdev    device instance
+ *  @param[in]
+ *      req     setup request
+ *  @return
+ *      USBD_OK or USBD_FAIL
+ */
+static uint8_t composite_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req) {
+	switch (req->bmRequest & USB_REQ_RECIPIENT_MASK) {
+	case USB_REQ_RECIPIENT_INTERFACE:
+		if (LOBYTE(req->wIndex) == MSC_INTERFACE) {
+			return MSC_Setup(pdev, req);
+		}
+		break;
+
+	case USB_REQ_RECIPIENT_ENDPOINT:
+		if ((LOBYTE(req->wIndex) & 0x0FU) == MSC_EP_NUM) {
+			return MSC_Setup(pdev, req);
+		}
+		break;
+
+	default:
+		break;
+	}
+	return USBD_CDC.Setup(pdev, req);
+}
+
+
+static uint8_t composite_EP0_RxReady(USBD_HandleTypeDef *pdev) {
+	// only the CDC has control OUT data stages
+	return USBD_CDC.EP0_RxReady(pdev);
+}
+
+
+static uint8_t composite_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum) {
+	if (epnum == MSC_EP_NUM) {
+		return MSC_DataIn(pdev, epnum);
+	}
+	return USBD_CDC.DataIn(pdev, epnum);
+}
+
+
+static uint8_t composite_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum) {
+	if (epnum == MSC_EP_NUM) {
+		return MSC_DataOut(pdev, epnum);
+	}
+	return USBD_CDC.DataOut(pdev, epnum);
+}
+
+
+static uint8_t *composite_GetCfgDesc(uint16_t *length) {
+	*length = (uint16_t)sizeof(composite_CfgDesc);
+	return composite_CfgDesc;
+}
+
+
+static uint8_t *composite_GetDeviceQualifierDesc(uint16_t *length) {
+	return USBD_CDC.GetDeviceQualifierDescriptor(length);
+}
+
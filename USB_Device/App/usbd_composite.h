@@ -0,0 +1,18 @@
+/*
+ * usbd_composite.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: psi
+ */
+
+#ifndef USBD_COMPOSITE_H_
+#define USBD_COMPOSITE_H_
+
+#include "usbd_ioreq.h"
+
+// configuration + IAD + CDC (interfaces 0, 1) + MSC (interface 2)
+#define USB_COMPOSITE_CONFIG_DESC_SIZ	98
+
+extern USBD_ClassTypeDef USBD_COMPOSITE;
+
+#endif /* USBD_COMPOSITE_H_ */
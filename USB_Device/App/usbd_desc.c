@@ -76,6 +76,10 @@
 #undef USBD_PRODUCT_STRING
 #define USBD_MANUFACTURER_STRING     "spyr.ch"
 #define USBD_PRODUCT_STRING     "Forth Virtual ComPort"
+#undef USBD_CONFIGURATION_STRING
+#undef USBD_INTERFACE_STRING
+#define USBD_CONFIGURATION_STRING     "CDC MSC Config"
+#define USBD_INTERFACE_STRING     "CDC MSC Interface"
 
 /* USER CODE END PRIVATE_DEFINES */
 
@@ -155,15 +159,15 @@ __ALIGN_BEGIN uint8_t USBD_CDC_DeviceDesc[USB_LEN_DEV_DESC] __ALIGN_END =
   USB_DESC_TYPE_DEVICE,       /*bDescriptorType*/
   0x00,                       /*bcdUSB */
   0x02,
-  0x02,                       /*bDeviceClass*/
-  0x02,                       /*bDeviceSubClass*/
-  0x00,                       /*bDeviceProtocol*/
+  0xEF,                       /*bDeviceClass: Miscellaneous (IAD)*/
+  0x02,                       /*bDeviceSubClass: Common Class*/
+  0x01,                       /*bDeviceProtocol: Interface Association*/
   USB_MAX_EP0_SIZE,           /*bMaxPacketSize*/
   LOBYTE(USBD_VID),           /*idVendor*/
   HIBYTE(USBD_VID),           /*idVendor*/
   LOBYTE(USBD_PID),           /*idProduct*/
   HIBYTE(USBD_PID),           /*idProduct*/
-  0x00,                       /*bcdDevice rel. 2.00*/
+  0x01,                       /*bcdDevice rel. 2.01, composite CDC+MSC*/
   0x02,
   USBD_IDX_MFC_STR,           /*Index of manufacturer  string*/
   USBD_IDX_PRODUCT_STR,       /*Index of product string*/
@@ -0,0 +1,694 @@
+/**
+ *  @brief
+ *      USB mass storage (bulk-only transport) for the SD card.
+ *
+ *      Second function of the composite CDC+MSC device (see
+ *      usbd_composite.c). The USB ISR only takes the CBW and signals the
+ *      data stages with thread flags, the MSC thread runs the SCSI command
+ *      (usbd_scsi.c) and the SD transfers. READ(10) and WRITE(10) use two
+ *      4 KiB buffers: the next chunk is read from (written to) the SD card
+ *      while the previous one is on the bus.
+ *
+ *      The SD card is owned either by Forth (FatFs, blocks) or by the USB
+ *      host. MSC_attach() unmounts the FatFs volume and hands the card to
+ *      the host, MSC_detach() takes it back. Eject the drive on the host
+ *      before MSC_detach(), the host caches the file system.
+ *  @file
+ *      usbd_msc.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include "cmsis_os.h"
+#include <string.h>
+
+// Application include files
+// *************************
+#include "app_common.h"
+#include "main.h"
+#include "usbd_core.h"
+#include "usbd_ctlreq.h"
+#include "usbd_msc.h"
+#include "usbd_scsi.h"
+#include "sd.h"
+#include "block.h"
+#include "ff.h"
+#include "fs.h"
+
+
+// Defines
+// *******
+#define MSC_BUFFER_BLOCKS		8
+#define MSC_BUFFER_SIZE			(MSC_BUFFER_BLOCKS * SCSI_BLOCK_SIZE)
+
+#define MSC_CBW_SIGNATURE		0x43425355
+#define MSC_CSW_SIGNATURE		0x53425355
+#define MSC_CBW_LENGTH			31
+#define MSC_CSW_LENGTH			13
+
+#define MSC_CSW_PASSED			0x00
+#define MSC_CSW_FAILED			0x01
+#define MSC_CSW_PHASE_ERROR		0x02
+
+// thread flags
+#define MSC_CBW_RECEIVED		0x01
+#define MSC_DATA_IN_DONE		0x02
+#define MSC_DATA_OUT_DONE		0x04
+#define MSC_CLEAR_HALT			0x08	// host cleared the stalled IN endpoint
+#define MSC_RESET				0x10	// BOT reset, (de)configuration
+#define MSC_ALL_FLAGS			0x1F
+
+enum {
+	MSC_IDLE = 0,	// OUT endpoint armed for the next CBW
+	MSC_BUSY,		// command or data stage
+	MSC_STALLED,	// IN endpoint stalled, CSW after the clear halt
+	MSC_CBW_ERROR	// invalid CBW, stalled till the BOT reset
+};
+
+typedef struct __attribute__((packed)) {
+	uint32_t dSignature;
+	uint32_t dTag;
+	uint32_t dDataLength;
+	uint8_t  bmFlags;
+	uint8_t  bLUN;
+	uint8_t  bCBLength;
+	uint8_t  CB[16];
+} MSC_CBW_TypeDef;
+
+typedef struct __attribute__((packed)) {
+	uint32_t dSignature;
+	uint32_t dTag;
+	uint32_t dDataResidue;
+	uint8_t  bStatus;
+} MSC_CSW_TypeDef;
+
+
+// Private function prototypes
+// ***************************
+static void msc_thread(void *argument);
+static void msc_command(void);
+static int msc_wait(uint32_t flag);
+static int msc_readBlocks(uint32_t *sent, uint8_t *status);
+static int msc_writeBlocks(uint32_t *received, uint8_t *status);
+static void msc_sendCSW(uint32_t tag, uint32_t residue, uint8_t status);
+static void msc_reset(void);
+static int msc_read(uint8_t *buffer, uint32_t lba, uint32_t count);
+static int msc_write(const uint8_t *buffer, uint32_t lba, uint32_t count);
+static uint32_t msc_blocks(void);
+
+// Global Variables
+// ****************
+extern FATFS FatFs;
+
+// RTOS resources
+// **************
+
+// Definitions for MSC thread
+static osThreadId_t MSC_ThreadID;
+static const osThreadAttr_t msc_thread_attributes = {
+		.name = "MSC_Thread",
+		.priority = (osPriority_t) osPriorityNormal,
+		.stack_size = 512*2
+};
+
+// SCSI state and SD card ownership
+static osMutexId_t MSC_MutexID;
+static const osMutexAttr_t MSC_MutexAttr = {
+		NULL,				// no name required
+		osMutexPrioInherit,	// attr_bits
+		NULL,				// memory for control block
+		0U					// size for control block
+};
+
+
+// Private Variables
+// *****************
+static USBD_HandleTypeDef *msc_pdev = NULL;
+static volatile int msc_open = FALSE;		// endpoints configured
+static volatile int msc_state = MSC_IDLE;
+static volatile uint32_t msc_cbwLength;
+static int msc_attached = FALSE;			// SD card owned by the host
+
+static MSC_CBW_TypeDef msc_cbw __attribute__((aligned(4)));
+static MSC_CSW_TypeDef msc_csw __attribute__((aligned(4)));
+static uint8_t msc_buffer[2][MSC_BUFFER_SIZE] __attribute__((aligned(4)));
+static uint8_t msc_maxLun = 0;
+
+static SCSI_HandleTypeDef msc_scsi;
+static const SCSI_DeviceTypeDef msc_device = {
+		msc_read,
+		msc_write,
+		msc_blocks
+};
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Initializes the mass storage, has to be called before the USB device
+ *      is started.
+ *  @return
+ *      None
+ */
+void MSC_init(void) {
+	SCSI_init(&msc_scsi, &msc_device);
+
+	MSC_MutexID = osMutexNew(&MSC_MutexAttr);
+	if (MSC_MutexID == NULL) {
+		Error_Handler();
+	}
+
+	// creation of MSC_Thread
+	MSC_ThreadID = osThreadNew(msc_thread, NULL, &msc_thread_attributes);
+	if (MSC_ThreadID == NULL) {
+		// no thread created
+		Error_Handler();
+	}
+}
+
+
+/**
+ *  @brief
+ *      Hands the SD card over to the USB host. Saves the block buffers and
+ *      unmounts the FatFs volume.
+ *  @return
+ *      FR_OK or FatFs error code (the SD card stays with Forth).
+ */
+int MSC_attach(void) {
+	FRESULT fr;
+
+	if (msc_attached) {
+		return FR_OK;
+	}
+
+	BLOCK_flushBuffers();
+	// the SD card volume, "" would be the current drive
+	fr = f_mount(0, FS_SD_DRIVE, 0);
+	if (fr != FR_OK) {
+		return fr;
+	}
+
+	osMutexAcquire(MSC_MutexID, osWaitForever);
+	msc_attached = TRUE;
+	SCSI_mediumChanged(&msc_scsi);
+	osMutexRelease(MSC_MutexID);
+
+	return FR_OK;
+}
+
+
+/**
+ *  @brief
+ *      Takes the SD card back from the USB host and remounts the FatFs
+ *      volume. Waits for a running SCSI command.
+ *  @return
+ *      FR_OK or FatFs error code of the mount.
+ */
+int MSC_detach(void) {
+	if (! msc_attached) {
+		return FR_OK;
+	}
+
+	osMutexAcquire(MSC_MutexID, osWaitForever);
+	msc_attached = FALSE;
+	SCSI_mediumChanged(&msc_scsi);
+	osMutexRelease(MSC_MutexID);
+
+	// the host could have changed anything
+	BLOCK_emptyBuffers();
+	return f_mount(&FatFs, FS_SD_DRIVE, 0);
+}
+
+
+// USB class callbacks, called from the USB ISR by usbd_composite.c
+// ****************************************************************
+
+/**
+ *  @brief
+ *      Opens the endpoints, the MSC thread arms the OUT endpoint for the
+ *      first CBW.
+ *  @param[in]
+ *      pdev    device instance
+ *  @return
+ *      USBD_OK
+ */
+uint8_t MSC_Init(USBD_HandleTypeDef *pdev) {
+	msc_pdev = pdev;
+
+	(void)USBD_LL_OpenEP(pdev, MSC_IN_EP, USBD_EP_TYPE_BULK, MSC_MAX_PACKET);
+	pdev->ep_in[MSC_IN_EP & 0xFU].is_used = 1U;
+	(void)USBD_LL_OpenEP(pdev, MSC_OUT_EP, USBD_EP_TYPE_BULK, MSC_MAX_PACKET);
+	pdev->ep_out[MSC_OUT_EP & 0xFU].is_used = 1U;
+
+	msc_open = TRUE;
+	osThreadFlagsSet(MSC_ThreadID, MSC_RESET);
+	return (uint8_t)USBD_OK;
+}
+
+
+/**
+ *  @brief
+ *      Closes the endpoints and aborts a running command.
+ *  @param[in]
+ *      pdev    device instance
+ *  @return
+ *      USBD_OK
+ */
+uint8_t MSC_DeInit(USBD_HandleTypeDef *pdev) {
+	msc_open = FALSE;
+
+	(void)USBD_LL_CloseEP(pdev, MSC_IN_EP);
+	pdev->ep_in[MSC_IN_EP & 0xFU].is_used = 0U;
+	(void)USBD_LL_CloseEP(pdev, MSC_OUT_EP);
+	pdev->ep_out[MSC_OUT_EP & 0xFU].is_used = 0U;
+
+	osThreadFlagsSet(MSC_ThreadID, MSC_RESET);
+	return (uint8_t)USBD_OK;
+}
+
+
+/**
+ *  @brief
+ *      Handles the MSC interface and endpoint requests.
+ *  @param[in]
+ *      pdev    device instance
+ *  @param[in]
+ *      req     setup request
+ *  @return
+ *      USBD_OK or USBD_FAIL
+ */
+uint8_t MSC_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req) {
+	static uint8_t ifalt = 0U;
+	static uint16_t status_info = 0U;
+	USBD_StatusTypeDef ret = USBD_OK;
+
+	switch (req->bmRequest & USB_REQ_TYPE_MASK) {
+	case USB_REQ_TYPE_CLASS:
+		if (req->bRequest == MSC_BOT_GET_MAX_LUN
+				&& req->wValue == 0U && req->wLength == 1U
+				&& (req->bmRequest & 0x80U) != 0U) {
+			(void)USBD_CtlSendData(pdev, &msc_maxLun, 1U);
+		} else if (req->bRequest == MSC_BOT_RESET
+				&& req->wValue == 0U && req->wLength == 0U
+				&& (req->bmRequest & 0x80U) == 0U) {
+			// the host clears the halts next
+			msc_state = MSC_BUSY;
+			osThreadFlagsSet(MSC_ThreadID, MSC_RESET);
+		} else {
+			USBD_CtlError(pdev, req);
+			ret = USBD_FAIL;
+		}
+		break;
+
+	case USB_REQ_TYPE_STANDARD:
+		switch (req->bRequest) {
+		case USB_REQ_GET_STATUS:
+			if (pdev->dev_state == USBD_STATE_CONFIGURED) {
+				(void)USBD_CtlSendData(pdev, (uint8_t *)&status_info, 2U);
+			} else {
+				USBD_CtlError(pdev, req);
+				ret = USBD_FAIL;
+			}
+			break;
+
+		case USB_REQ_GET_INTERFACE:
+			if (pdev->dev_state == USBD_STATE_CONFIGURED) {
+				(void)USBD_CtlSendData(pdev, &ifalt, 1U);
+			} else {
+				USBD_CtlError(pdev, req);
+				ret = USBD_FAIL;
+			}
+			break;
+
+		case USB_REQ_SET_INTERFACE:
+			if (pdev->dev_state != USBD_STATE_CONFIGURED) {
+				USBD_CtlError(pdev, req);
+				ret = USBD_FAIL;
+			}
+			break;
+
+		case USB_REQ_CLEAR_FEATURE:
+			// the core has already cleared the halt
+			if (msc_state == MSC_CBW_ERROR) {
+				// stays stalled till the BOT reset
+				(void)USBD_LL_StallEP(pdev, LOBYTE(req->wIndex));
+			} else if (msc_state == MSC_STALLED && LOBYTE(req->wIndex) == MSC_IN_EP) {
+				osThreadFlagsSet(MSC_ThreadID, MSC_CLEAR_HALT);
+			}
+			break;
+
+		default:
+			USBD_CtlError(pdev, req);
+			ret = USBD_FAIL;
+			break;
+		}
+		break;
+
+	default:
+		USBD_CtlError(pdev, req);
+		ret = USBD_FAIL;
+		break;
+	}
+
+	return (uint8_t)ret;
+}
+
+
+/**
+ *  @brief
+ *      Data sent on the IN endpoint.
+ *  @param[in]
+ *      pdev    device instance
+ *  @param[in]
+ *      epnum   endpoint number
+ *  @return
+ *      USBD_OK
+ */
+uint8_t MSC_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum) {
+	UNUSED(pdev);
+	UNUSED(epnum);
+
+	osThreadFlagsSet(MSC_ThreadID, MSC_DATA_IN_DONE);
+	return (uint8_t)USBD_OK;
+}
+
+
+/**
+ *  @brief
+ *      Data received on the OUT endpoint, a CBW or a data stage.
+ *  @param[in]
+ *      pdev    device instance
+ *  @param[in]
+ *      epnum   endpoint number
+ *  @return
+ *      USBD_OK
+ */
+uint8_t MSC_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum) {
+	if (msc_state == MSC_IDLE) {
+		msc_cbwLength = USBD_LL_GetRxDataSize(pdev, epnum);
+		msc_state = MSC_BUSY;
+		osThreadFlagsSet(MSC_ThreadID, MSC_CBW_RECEIVED);
+	} else {
+		osThreadFlagsSet(MSC_ThreadID, MSC_DATA_OUT_DONE);
+	}
+	return (uint8_t)USBD_OK;
+}
+
+
+// Private Functions
+// *****************
+
+/**
+ *  @brief
+ *      Function implementing the MSC thread.
+ *  @param
+ *      argument: Not used
+ *  @retval
+ *      None
+ */
+static void msc_thread(void *argument) {
+	uint32_t flags;
+
+	for(;;) {
+		flags = osThreadFlagsWait(MSC_CBW_RECEIVED | MSC_RESET, osFlagsWaitAny, osWaitForever);
+		if (flags & osFlagsError) {
+			continue;
+		}
+		if (flags & MSC_RESET) {
+			msc_reset();
+			continue;
+		}
+		osMutexAcquire(MSC_MutexID, osWaitForever);
+		msc_command();
+		osMutexRelease(MSC_MutexID);
+	}
+}
+
+
+/**
+ *  @brief
+ *      Executes the received CBW: command, data stage and CSW.
+ *  @return
+ *      None
+ */
+static void msc_command(void) {
+	uint32_t expected = msc_cbw.dDataLength;
+	int to_host = (msc_cbw.bmFlags & 0x80) != 0;
+	uint32_t length = 0;
+	uint8_t status = MSC_CSW_PASSED;
+	int ok = TRUE;
+
+	if (msc_cbwLength != MSC_CBW_LENGTH || msc_cbw.dSignature != MSC_CBW_SIGNATURE
+			|| msc_cbw.bLUN != 0 || msc_cbw.bCBLength < 1 || msc_cbw.bCBLength > 16) {
+		msc_state = MSC_CBW_ERROR;
+		(void)USBD_LL_StallEP(msc_pdev, MSC_IN_EP);
+		(void)USBD_LL_StallEP(msc_pdev, MSC_OUT_EP);
+		return;
+	}
+
+	switch (SCSI_command(&msc_scsi, msc_cbw.CB, msc_cbw.bCBLength, msc_buffer[0], &length)) {
+	case SCSI_NO_DATA:
+		length = 0;
+		break;
+
+	case SCSI_DATA_IN:
+		if (expected && ! to_host) {
+			status = MSC_CSW_PHASE_ERROR;
+			length = 0;
+			break;
+		}
+		if (length > expected) {
+			length = expected;
+		}
+		if (length) {
+			(void)USBD_LL_Transmit(msc_pdev, MSC_IN_EP, msc_buffer[0], length);
+			ok = msc_wait(MSC_DATA_IN_DONE);
+		}
+		break;
+
+	case SCSI_READ:
+		if (! to_host || expected < length) {
+			status = MSC_CSW_PHASE_ERROR;
+			length = 0;
+			break;
+		}
+		ok = msc_readBlocks(&length, &status);
+		break;
+
+	case SCSI_WRITE:
+		if (to_host || expected < length) {
+			status = MSC_CSW_PHASE_ERROR;
+			length = 0;
+			break;
+		}
+		ok = msc_writeBlocks(&length, &status);
+		break;
+
+	default:
+		status = MSC_CSW_FAILED;
+		length = 0;
+		break;
+	}
+
+	if (! ok) {
+		// reset
+		return;
+	}
+
+	if (length < expected) {
+		// the host expects more (less) data, end the data stage with a stall
+		if (to_host) {
+			msc_state = MSC_STALLED;
+			(void)USBD_LL_StallEP(msc_pdev, MSC_IN_EP);
+			if (! msc_wait(MSC_CLEAR_HALT)) {
+				return;
+			}
+		} else {
+			(void)USBD_LL_StallEP(msc_pdev, MSC_OUT_EP);
+		}
+	}
+
+	msc_sendCSW(msc_cbw.dTag, expected - length, status);
+}
+
+
+/**
+ *  @brief
+ *      Waits for a thread flag.
+ *  @param[in]
+ *      flag    thread flag
+ *  @return
+ *      FALSE on a reset, the reset flag is set again for the thread loop.
+ */
+static int msc_wait(uint32_t flag) {
+	uint32_t flags = osThreadFlagsWait(flag | MSC_RESET, osFlagsWaitAny, osWaitForever);
+
+	if (flags & osFlagsError) {
+		return FALSE;
+	}
+	if (flags & MSC_RESET) {
+		osThreadFlagsSet(MSC_ThreadID, MSC_RESET);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+
+/**
+ *  @brief
+ *      READ(10) data stage. Reads the next chunk while the previous one is
+ *      sent.
+ *  @param[out]
+ *      sent    number of bytes sent
+ *  @param[out]
+ *      status  CSW status
+ *  @return
+ *      FALSE on a reset.
+ */
+static int msc_readBlocks(uint32_t *sent, uint8_t *status) {
+	int cur = 0;
+	int n;
+	uint32_t length;
+
+	*sent = 0;
+	n = SCSI_read(&msc_scsi, msc_buffer[cur], MSC_BUFFER_BLOCKS);
+	while (n > 0) {
+		length = n * SCSI_BLOCK_SIZE;
+		(void)USBD_LL_Transmit(msc_pdev, MSC_IN_EP, msc_buffer[cur], length);
+		cur ^= 1;
+		n = SCSI_read(&msc_scsi, msc_buffer[cur], MSC_BUFFER_BLOCKS);
+		if (! msc_wait(MSC_DATA_IN_DONE)) {
+			return FALSE;
+		}
+		*sent += length;
+	}
+	if (n < 0) {
+		*status = MSC_CSW_FAILED;
+	}
+	return TRUE;
+}
+
+
+/**
+ *  @brief
+ *      WRITE(10) data stage. Receives the next chunk while the previous one
+ *      is written. After a write error the remaining data is discarded.
+ *  @param[out]
+ *      received    number of bytes received
+ *  @param[out]
+ *      status      CSW status
+ *  @return
+ *      FALSE on a reset.
+ */
+static int msc_writeBlocks(uint32_t *received, uint8_t *status) {
+	int cur = 0;
+	uint32_t remaining = msc_scsi.count;
+	uint32_t n, next;
+
+	*received = 0;
+	n = remaining < MSC_BUFFER_BLOCKS ? remaining : MSC_BUFFER_BLOCKS;
+	(void)USBD_LL_PrepareReceive(msc_pdev, MSC_OUT_EP, msc_buffer[cur], n * SCSI_BLOCK_SIZE);
+	while (n > 0) {
+		if (! msc_wait(MSC_DATA_OUT_DONE)) {
+			return FALSE;
+		}
+		remaining -= n;
+		*received += n * SCSI_BLOCK_SIZE;
+		next = remaining < MSC_BUFFER_BLOCKS ? remaining : MSC_BUFFER_BLOCKS;
+		if (next) {
+			(void)USBD_LL_PrepareReceive(msc_pdev, MSC_OUT_EP, msc_buffer[cur ^ 1], next * SCSI_BLOCK_SIZE);
+		}
+		if (*status == MSC_CSW_PASSED && SCSI_write(&msc_scsi, msc_buffer[cur], n) < 0) {
+			*status = MSC_CSW_FAILED;
+		}
+		cur ^= 1;
+		n = next;
+	}
+	return TRUE;
+}
+
+
+/**
+ *  @brief
+ *      Sends the CSW and arms the OUT endpoint for the next CBW.
+ *  @return
+ *      None
+ */
+static void msc_sendCSW(uint32_t tag, uint32_t residue, uint8_t status) {
+	msc_csw.dSignature = MSC_CSW_SIGNATURE;
+	msc_csw.dTag = tag;
+	msc_csw.dDataResidue = residue;
+	msc_csw.bStatus = status;
+
+	msc_state = MSC_BUSY;
+	(void)USBD_LL_Transmit(msc_pdev, MSC_IN_EP, (uint8_t *)&msc_csw, MSC_CSW_LENGTH);
+	if (! msc_wait(MSC_DATA_IN_DONE)) {
+		return;
+	}
+
+	msc_state = MSC_IDLE;
+	(void)USBD_LL_PrepareReceive(msc_pdev, MSC_OUT_EP, (uint8_t *)&msc_cbw, MSC_CBW_LENGTH);
+}
+
+
+/**
+ *  @brief
+ *      BOT reset or (re)configuration: aborts the command and waits for
+ *      the next CBW.
+ *  @return
+ *      None
+ */
+static void msc_reset(void) {
+	osThreadFlagsClear(MSC_ALL_FLAGS);
+	msc_state = MSC_IDLE;
+	if (msc_open) {
+		(void)USBD_LL_PrepareReceive(msc_pdev, MSC_OUT_EP, (uint8_t *)&msc_cbw, MSC_CBW_LENGTH);
+	}
+}
+
+
+// SCSI block device, SD card
+// **************************
+
+static int msc_read(uint8_t *buffer, uint32_t lba, uint32_t count) {
+	return SD_ReadBlocks(buffer, lba, count) != SD_OK;
+}
+
+
+static int msc_write(const uint8_t *buffer, uint32_t lba, uint32_t count) {
+	return SD_WriteBlocks((uint8_t *)buffer, lba, count) != SD_OK;
+}
+
+
+static uint32_t msc_blocks(void) {
+	if (! msc_attached) {
+		// Forth owns the SD card
+		return 0;
+	}
+	// SD_getBlocks() returns KiB
+	return SD_getBlocks() * 2;
+}
+
@@ -0,0 +1,33 @@
+/*
+ * usbd_msc.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: psi
+ */
+
+#ifndef USBD_MSC_H_
+#define USBD_MSC_H_
+
+#include "usbd_def.h"
+
+#define MSC_INTERFACE			0x02
+#define MSC_IN_EP				0x83
+#define MSC_OUT_EP				0x03
+#define MSC_EP_NUM				(MSC_OUT_EP & 0x0F)
+#define MSC_MAX_PACKET			64
+
+// class requests
+#define MSC_BOT_GET_MAX_LUN		0xFE
+#define MSC_BOT_RESET			0xFF
+
+void    MSC_init(void);
+int     MSC_attach(void);
+int     MSC_detach(void);
+
+uint8_t MSC_Init(USBD_HandleTypeDef *pdev);
+uint8_t MSC_DeInit(USBD_HandleTypeDef *pdev);
+uint8_t MSC_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+uint8_t MSC_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
+uint8_t MSC_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
+
+#endif /* USBD_MSC_H_ */
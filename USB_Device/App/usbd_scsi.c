@@ -0,0 +1,339 @@
+/**
+ *  @brief
+ *      SCSI block commands for the USB mass storage (bulk-only transport).
+ *
+ *      Transparent SCSI command set (SPC/SBC subset) as used by Linux,
+ *      macOS and Windows for a removable direct access device. The layer
+ *      only knows the block device functions (SCSI_DeviceTypeDef), no USB
+ *      or RTOS, the host test is in USB_Device/Test (RAM disk).
+ *
+ *      SCSI_command() decodes a command block and returns the data phase.
+ *      READ(10) and WRITE(10) only check the range, the blocks are
+ *      transferred in chunks by SCSI_read() and SCSI_write() to overlap the
+ *      block device with the USB transfer.
+ *  @file
+ *      usbd_scsi.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, STM32CubeIDE GCC
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include <string.h>
+
+// Application include files
+// *************************
+#include "usbd_scsi.h"
+
+
+// Private function prototypes
+// ***************************
+static int scsi_fail(SCSI_HandleTypeDef *hscsi, uint8_t key, uint8_t asc);
+static int scsi_ready(SCSI_HandleTypeDef *hscsi);
+static void scsi_put32(uint8_t *p, uint32_t value);
+static uint32_t scsi_get32(const uint8_t *p);
+static uint32_t scsi_min(uint32_t a, uint32_t b);
+
+// Private Variables
+// *****************
+
+// standard INQUIRY data, removable direct access device
+static const uint8_t scsi_inquiry[36] = {
+		0x00,			// direct access block device
+		0x80,			// removable medium
+		0x04,			// SPC-2
+		0x02,			// response data format
+		36 - 5,			// additional length
+		0x00, 0x00, 0x00,
+		's', 'p', 'y', 'r', '.', 'c', 'h', ' ',		// vendor (8)
+		'M', 'e', 'c', 'r', 'i', 's', 'p', '-',		// product (16)
+		'C', 'u', 'b', 'e', ' ', 'S', 'D', ' ',
+		'1', '.', '0', '0'							// revision (4)
+};
+
+
+// Public Functions
+// ****************
+
+/**
+ *  @brief
+ *      Initializes the SCSI handle.
+ *  @param[in]
+ *      hscsi   SCSI handle
+ *  @param[in]
+ *      device  block device
+ *  @return
+ *      None
+ */
+void SCSI_init(SCSI_HandleTypeDef *hscsi, const SCSI_DeviceTypeDef *device) {
+	memset(hscsi, 0, sizeof(SCSI_HandleTypeDef));
+	hscsi->device = device;
+	hscsi->unit_attention = 1;
+}
+
+
+/**
+ *  @brief
+ *      Decodes and executes a SCSI command block.
+ *  @param[in]
+ *      hscsi       SCSI handle
+ *  @param[in]
+ *      cb          command block
+ *  @param[in]
+ *      length      command block length
+ *  @param[out]
+ *      data        response buffer (at least 36 bytes)
+ *  @param[out]
+ *      data_length response length or number of bytes for READ/WRITE
+ *  @return
+ *      Data phase SCSI_NO_DATA, SCSI_DATA_IN, SCSI_READ, SCSI_WRITE or
+ *      SCSI_FAIL (sense data set).
+ */
+int SCSI_command(SCSI_HandleTypeDef *hscsi, const uint8_t *cb, int length,
+		uint8_t *data, uint32_t *data_length) {
+	uint32_t blocks;
+	uint32_t lba;
+	uint32_t count;
+
+	*data_length = 0;
+	hscsi->count = 0;
+
+	if (length < 6) {
+		return scsi_fail(hscsi, SCSI_ILLEGAL_REQUEST, SCSI_ASC_INVALID_COMMAND);
+	}
+
+	// a medium change is reported once to every command but INQUIRY and
+	// REQUEST SENSE
+	if (hscsi->unit_attention
+			&& cb[0] != SCSI_INQUIRY && cb[0] != SCSI_REQUEST_SENSE) {
+		hscsi->unit_attention = 0;
+		return scsi_fail(hscsi, SCSI_UNIT_ATTENTION, SCSI_ASC_MEDIUM_CHANGED);
+	}
+
+	switch (cb[0]) {
+	case SCSI_TEST_UNIT_READY:
+	case SCSI_VERIFY10:
+	case SCSI_SYNCHRONIZE_CACHE10:
+		if (! scsi_ready(hscsi)) {
+			return SCSI_FAIL;
+		}
+		return SCSI_NO_DATA;
+
+	case SCSI_START_STOP_UNIT:
+	case SCSI_PREVENT_ALLOW:
+		return SCSI_NO_DATA;
+
+	case SCSI_REQUEST_SENSE:
+		// fixed format sense data, the sense is cleared
+		memset(data, 0, 18);
+		data[0] = 0x70;
+		data[2] = hscsi->sense_key;
+		data[7] = 18 - 8;
+		data[12] = hscsi->asc;
+		hscsi->sense_key = SCSI_NO_SENSE;
+		hscsi->asc = 0;
+		*data_length = scsi_min(18, cb[4]);
+		return SCSI_DATA_IN;
+
+	case SCSI_INQUIRY:
+		if (cb[1] & 0x01) {
+			// no vital product data pages
+			return scsi_fail(hscsi, SCSI_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+		}
+		memcpy(data, scsi_inquiry, sizeof(scsi_inquiry));
+		*data_length = scsi_min(sizeof(scsi_inquiry), (cb[3] << 8) | cb[4]);
+		return SCSI_DATA_IN;
+
+	case SCSI_MODE_SENSE6:
+		// header only, no write protection, no pages
+		memset(data, 0, 4);
+		data[0] = 4 - 1;
+		*data_length = scsi_min(4, cb[4]);
+		return SCSI_DATA_IN;
+
+	case SCSI_MODE_SENSE10:
+		memset(data, 0, 8);
+		data[1] = 8 - 2;
+		*data_length = scsi_min(8, (cb[7] << 8) | cb[8]);
+		return SCSI_DATA_IN;
+
+	case SCSI_READ_FORMAT_CAPACITIES:
+		memset(data, 0, 12);
+		data[3] = 8;	// capacity list length
+		blocks = hscsi->device->blocks();
+		if (blocks) {
+			scsi_put32(&data[4], blocks);
+			data[8] = 0x02;	// formatted media
+		} else {
+			scsi_put32(&data[4], 0xFFFFFFFF);
+			data[8] = 0x03;	// no media present
+		}
+		data[10] = SCSI_BLOCK_SIZE >> 8;
+		data[11] = SCSI_BLOCK_SIZE & 0xFF;
+		*data_length = scsi_min(12, (cb[7] << 8) | cb[8]);
+		return SCSI_DATA_IN;
+
+	case SCSI_READ_CAPACITY10:
+		if (! scsi_ready(hscsi)) {
+			return SCSI_FAIL;
+		}
+		scsi_put32(&data[0], hscsi->device->blocks() - 1);	// last LBA
+		scsi_put32(&data[4], SCSI_BLOCK_SIZE);
+		*data_length = 8;
+		return SCSI_DATA_IN;
+
+	case SCSI_READ10:
+	case SCSI_WRITE10:
+		if (length < 10) {
+			return scsi_fail(hscsi, SCSI_ILLEGAL_REQUEST, SCSI_ASC_INVALID_FIELD);
+		}
+		if (! scsi_ready(hscsi)) {
+			return SCSI_FAIL;
+		}
+		lba = scsi_get32(&cb[2]);
+		count = (cb[7] << 8) | cb[8];
+		blocks = hscsi->device->blocks();
+		if (lba >= blocks || count > blocks - lba) {
+			return scsi_fail(hscsi, SCSI_ILLEGAL_REQUEST, SCSI_ASC_LBA_OUT_OF_RANGE);
+		}
+		if (count == 0) {
+			return SCSI_NO_DATA;
+		}
+		hscsi->lba = lba;
+		hscsi->count = count;
+		*data_length = count * SCSI_BLOCK_SIZE;
+		return cb[0] == SCSI_READ10 ? SCSI_READ : SCSI_WRITE;
+
+	default:
+		return scsi_fail(hscsi, SCSI_ILLEGAL_REQUEST, SCSI_ASC_INVALID_COMMAND);
+	}
+}
+
+
+/**
+ *  @brief
+ *      Reads the next blocks of a READ(10) command.
+ *  @param[in]
+ *      hscsi       SCSI handle
+ *  @param[out]
+ *      buffer      block buffer
+ *  @param[in]
+ *      max_blocks  buffer size in blocks
+ *  @return
+ *      Number of blocks read, 0 at the end of the command, -1 on error
+ *      (sense data set).
+ */
+int SCSI_read(SCSI_HandleTypeDef *hscsi, uint8_t *buffer, uint32_t max_blocks) {
+	uint32_t n = scsi_min(hscsi->count, max_blocks);
+
+	if (n == 0) {
+		return 0;
+	}
+	if (hscsi->device->read(buffer, hscsi->lba, n)) {
+		hscsi->count = 0;
+		return scsi_fail(hscsi, SCSI_MEDIUM_ERROR, SCSI_ASC_READ_ERROR);
+	}
+	hscsi->lba += n;
+	hscsi->count -= n;
+	return n;
+}
+
+
+/**
+ *  @brief
+ *      Writes the next blocks of a WRITE(10) command.
+ *  @param[in]
+ *      hscsi       SCSI handle
+ *  @param[in]
+ *      buffer      block buffer
+ *  @param[in]
+ *      blocks      number of blocks in the buffer
+ *  @return
+ *      Number of blocks written, -1 on error (sense data set).
+ */
+int SCSI_write(SCSI_HandleTypeDef *hscsi, const uint8_t *buffer, uint32_t blocks) {
+	uint32_t n = scsi_min(hscsi->count, blocks);
+
+	if (n == 0) {
+		return 0;
+	}
+	if (hscsi->device->write(buffer, hscsi->lba, n)) {
+		hscsi->count = 0;
+		return scsi_fail(hscsi, SCSI_MEDIUM_ERROR, SCSI_ASC_WRITE_FAULT);
+	}
+	hscsi->lba += n;
+	hscsi->count -= n;
+	return n;
+}
+
+
+/**
+ *  @brief
+ *      The medium was inserted or removed. The next command gets a
+ *      UNIT ATTENTION, the host re-reads the capacity and the file system.
+ *  @param[in]
+ *      hscsi   SCSI handle
+ *  @return
+ *      None
+ */
+void SCSI_mediumChanged(SCSI_HandleTypeDef *hscsi) {
+	hscsi->unit_attention = 1;
+}
+
+
+// Private Functions
+// *****************
+
+static int scsi_fail(SCSI_HandleTypeDef *hscsi, uint8_t key, uint8_t asc) {
+	hscsi->sense_key = key;
+	hscsi->asc = asc;
+	return SCSI_FAIL;
+}
+
+
+static int scsi_ready(SCSI_HandleTypeDef *hscsi) {
+	if (hscsi->device->blocks() == 0) {
+		scsi_fail(hscsi, SCSI_NOT_READY, SCSI_ASC_MEDIUM_NOT_PRESENT);
+		return 0;
+	}
+	return 1;
+}
+
+
+// big endian
+static void scsi_put32(uint8_t *p, uint32_t value) {
+	p[0] = value >> 24;
+	p[1] = value >> 16;
+	p[2] = value >> 8;
+	p[3] = value;
+}
+
+
+static uint32_t scsi_get32(const uint8_t *p) {
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+
+static uint32_t scsi_min(uint32_t a, uint32_t b) {
+	return a < b ? a : b;
+}
+
@@ -0,0 +1,78 @@
+/*
+ * usbd_scsi.h
+ *
+ *  Created on: 18.10.2026
+ *      Author: psi
+ */
+
+#ifndef USBD_SCSI_H_
+#define USBD_SCSI_H_
+
+#include <stdint.h>
+
+#define SCSI_BLOCK_SIZE				512
+
+// SCSI operation codes
+#define SCSI_TEST_UNIT_READY		0x00
+#define SCSI_REQUEST_SENSE			0x03
+#define SCSI_INQUIRY				0x12
+#define SCSI_MODE_SENSE6			0x1A
+#define SCSI_START_STOP_UNIT		0x1B
+#define SCSI_PREVENT_ALLOW			0x1E
+#define SCSI_READ_FORMAT_CAPACITIES	0x23
+#define SCSI_READ_CAPACITY10		0x25
+#define SCSI_READ10					0x28
+#define SCSI_WRITE10				0x2A
+#define SCSI_VERIFY10				0x2F
+#define SCSI_SYNCHRONIZE_CACHE10	0x35
+#define SCSI_MODE_SENSE10			0x5A
+
+// sense keys
+#define SCSI_NO_SENSE				0x00
+#define SCSI_NOT_READY				0x02
+#define SCSI_MEDIUM_ERROR			0x03
+#define SCSI_ILLEGAL_REQUEST		0x05
+#define SCSI_UNIT_ATTENTION			0x06
+
+// additional sense codes
+#define SCSI_ASC_WRITE_FAULT		0x03
+#define SCSI_ASC_READ_ERROR			0x11
+#define SCSI_ASC_INVALID_COMMAND	0x20
+#define SCSI_ASC_LBA_OUT_OF_RANGE	0x21
+#define SCSI_ASC_INVALID_FIELD		0x24
+#define SCSI_ASC_MEDIUM_CHANGED		0x28
+#define SCSI_ASC_MEDIUM_NOT_PRESENT	0x3A
+
+// data phase of a command, returned by SCSI_command()
+enum {
+	SCSI_FAIL = -1,		// command failed, sense data is set
+	SCSI_NO_DATA = 0,	// no data phase
+	SCSI_DATA_IN,		// response in the data buffer
+	SCSI_READ,			// blocks to the host, see SCSI_read()
+	SCSI_WRITE			// blocks from the host, see SCSI_write()
+};
+
+// block device, the functions return 0 on success
+typedef struct {
+	int (*read)(uint8_t *buffer, uint32_t lba, uint32_t count);
+	int (*write)(const uint8_t *buffer, uint32_t lba, uint32_t count);
+	uint32_t (*blocks)(void);	// 0 = no medium
+} SCSI_DeviceTypeDef;
+
+typedef struct {
+	const SCSI_DeviceTypeDef *device;
+	uint8_t sense_key;
+	uint8_t asc;
+	uint8_t unit_attention;
+	uint32_t lba;		// next block of a READ/WRITE
+	uint32_t count;		// remaining blocks of a READ/WRITE
+} SCSI_HandleTypeDef;
+
+void SCSI_init(SCSI_HandleTypeDef *hscsi, const SCSI_DeviceTypeDef *device);
+int  SCSI_command(SCSI_HandleTypeDef *hscsi, const uint8_t *cb, int length,
+		uint8_t *data, uint32_t *data_length);
+int  SCSI_read(SCSI_HandleTypeDef *hscsi, uint8_t *buffer, uint32_t max_blocks);
+int  SCSI_write(SCSI_HandleTypeDef *hscsi, const uint8_t *buffer, uint32_t blocks);
+void SCSI_mediumChanged(SCSI_HandleTypeDef *hscsi);
+
+#endif /* USBD_SCSI_H_ */
@@ -0,0 +1,310 @@
+/**
+ *  @brief
+ *      Host test of the SCSI block commands (usbd_scsi.c).
+ *
+ *      The SCSI layer runs against a RAM disk, the command blocks are the
+ *      ones a host sends over the bulk-only transport. Checks INQUIRY,
+ *      READ CAPACITY, READ(10)/WRITE(10), the sense data of an illegal LBA
+ *      and the UNIT ATTENTION after a medium change.
+ *
+ *          make -C USB_Device/Test
+ *  @file
+ *      scsi_test.c
+ *  @author
+ *      Peter Schmid, peter@spyr.ch
+ *  @date
+ *      2026-10-18
+ *  @remark
+ *      Language: C, GCC (host)
+ *  @copyright
+ *      Peter Schmid, Switzerland
+ *
+ *      This project Mecrsip-Cube is free software: you can redistribute it
+ *      and/or modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation, either version 3 of
+ *      the License, or (at your option) any later version.
+ *
+ *      Mecrsip-Cube is distributed in the hope that it will be useful, but
+ *      WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ *      General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with Mecrsip-Cube. If not, see http://www.gnu.org/licenses/.
+ */
+
+// System include files
+// ********************
+#include <stdio.h>
+#include <string.h>
+
+// Application include files
+// *************************
+#include "usbd_scsi.h"
+
+#define RAMDISK_BLOCKS		64
+#define CHUNK_BLOCKS		4		// like the double buffer of usbd_msc.c
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+
+// Private Variables
+// *****************
+static uint8_t ramdisk[RAMDISK_BLOCKS * SCSI_BLOCK_SIZE];
+static uint32_t ramdisk_blocks = RAMDISK_BLOCKS;
+static int failures = 0;
+
+
+// RAM disk
+// ********
+
+static int ramdisk_read(uint8_t *buffer, uint32_t lba, uint32_t count) {
+	memcpy(buffer, &ramdisk[lba * SCSI_BLOCK_SIZE], count * SCSI_BLOCK_SIZE);
+	return 0;
+}
+
+
+static int ramdisk_write(const uint8_t *buffer, uint32_t lba, uint32_t count) {
+	memcpy(&ramdisk[lba * SCSI_BLOCK_SIZE], buffer, count * SCSI_BLOCK_SIZE);
+	return 0;
+}
+
+
+static uint32_t ramdisk_size(void) {
+	return ramdisk_blocks;
+}
+
+
+static const SCSI_DeviceTypeDef ramdisk_device = {
+		ramdisk_read,
+		ramdisk_write,
+		ramdisk_size
+};
+
+
+// Helpers
+// *******
+
+static void check(int cond, const char *text, int line) {
+	if (! cond) {
+		printf("FAIL line %d: %s\n", line, text);
+		failures++;
+	}
+}
+
+
+static uint32_t get32(const uint8_t *p) {
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+
+static void rw10(uint8_t *cb, uint8_t opcode, uint32_t lba, uint16_t count) {
+	memset(cb, 0, 10);
+	cb[0] = opcode;
+	cb[2] = lba >> 24;
+	cb[3] = lba >> 16;
+	cb[4] = lba >> 8;
+	cb[5] = lba;
+	cb[7] = count >> 8;
+	cb[8] = count;
+}
+
+
+static void request_sense(SCSI_HandleTypeDef *hscsi, uint8_t *key, uint8_t *asc) {
+	uint8_t cb[6] = { SCSI_REQUEST_SENSE, 0, 0, 0, 18, 0 };
+	uint8_t data[64];
+	uint32_t length;
+
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_DATA_IN);
+	CHECK(length == 18);
+	CHECK(data[0] == 0x70);
+	*key = data[2];
+	*asc = data[12];
+}
+
+
+// Tests
+// *****
+
+static void test_unit_attention(SCSI_HandleTypeDef *hscsi) {
+	uint8_t cb[6] = { SCSI_TEST_UNIT_READY, 0, 0, 0, 0, 0 };
+	uint8_t data[64];
+	uint32_t length;
+	uint8_t key, asc;
+
+	// the first command after the init reports the new medium
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_FAIL);
+	request_sense(hscsi, &key, &asc);
+	CHECK(key == SCSI_UNIT_ATTENTION);
+	CHECK(asc == SCSI_ASC_MEDIUM_CHANGED);
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_NO_DATA);
+}
+
+
+static void test_inquiry(SCSI_HandleTypeDef *hscsi) {
+	uint8_t cb[6] = { SCSI_INQUIRY, 0, 0, 0, 36, 0 };
+	uint8_t data[64];
+	uint32_t length;
+
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_DATA_IN);
+	CHECK(length == 36);
+	CHECK(data[0] == 0x00);				// direct access block device
+	CHECK(data[1] == 0x80);				// removable
+	CHECK(memcmp(&data[8], "spyr.ch ", 8) == 0);
+
+	// allocation length shorter than the data
+	cb[4] = 5;
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_DATA_IN);
+	CHECK(length == 5);
+
+	// no vital product data pages
+	cb[1] = 0x01;
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_FAIL);
+}
+
+
+static void test_read_capacity(SCSI_HandleTypeDef *hscsi) {
+	uint8_t cb[10] = { SCSI_READ_CAPACITY10 };
+	uint8_t data[64];
+	uint32_t length;
+
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_DATA_IN);
+	CHECK(length == 8);
+	CHECK(get32(&data[0]) == RAMDISK_BLOCKS - 1);	// last LBA
+	CHECK(get32(&data[4]) == SCSI_BLOCK_SIZE);
+}
+
+
+static void test_write_read(SCSI_HandleTypeDef *hscsi) {
+	static uint8_t out[10 * SCSI_BLOCK_SIZE];
+	static uint8_t in[10 * SCSI_BLOCK_SIZE];
+	uint8_t cb[10];
+	uint8_t data[64];
+	uint32_t length;
+	uint32_t done;
+	int i, n;
+
+	for (i=0; i<(int)sizeof(out); i++) {
+		out[i] = (uint8_t)(i * 7 + 3);
+	}
+
+	// WRITE(10) of 10 blocks at LBA 20, in chunks
+	rw10(cb, SCSI_WRITE10, 20, 10);
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_WRITE);
+	CHECK(length == 10 * SCSI_BLOCK_SIZE);
+	for (done=0; done<10; done+=n) {
+		n = SCSI_write(hscsi, &out[done * SCSI_BLOCK_SIZE], CHUNK_BLOCKS);
+		CHECK(n > 0);
+		if (n <= 0) {
+			return;
+		}
+	}
+	CHECK(memcmp(&ramdisk[20 * SCSI_BLOCK_SIZE], out, sizeof(out)) == 0);
+
+	// READ(10) back, in chunks, 0 at the end of the command
+	rw10(cb, SCSI_READ10, 20, 10);
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_READ);
+	CHECK(length == 10 * SCSI_BLOCK_SIZE);
+	done = 0;
+	while ((n = SCSI_read(hscsi, &in[done * SCSI_BLOCK_SIZE], CHUNK_BLOCKS)) > 0) {
+		done += n;
+	}
+	CHECK(n == 0);
+	CHECK(done == 10);
+	CHECK(memcmp(in, out, sizeof(in)) == 0);
+
+	// the last block
+	rw10(cb, SCSI_READ10, RAMDISK_BLOCKS - 1, 1);
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_READ);
+	CHECK(SCSI_read(hscsi, in, CHUNK_BLOCKS) == 1);
+
+	// zero blocks is no data phase
+	rw10(cb, SCSI_READ10, 0, 0);
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_NO_DATA);
+}
+
+
+static void test_illegal_lba(SCSI_HandleTypeDef *hscsi) {
+	uint8_t cb[10];
+	uint8_t data[64];
+	uint32_t length;
+	uint8_t key, asc;
+
+	// beyond the end
+	rw10(cb, SCSI_READ10, RAMDISK_BLOCKS, 1);
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_FAIL);
+	request_sense(hscsi, &key, &asc);
+	CHECK(key == SCSI_ILLEGAL_REQUEST);
+	CHECK(asc == SCSI_ASC_LBA_OUT_OF_RANGE);
+
+	// crosses the end
+	rw10(cb, SCSI_WRITE10, RAMDISK_BLOCKS - 2, 3);
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_FAIL);
+	request_sense(hscsi, &key, &asc);
+	CHECK(key == SCSI_ILLEGAL_REQUEST);
+	CHECK(asc == SCSI_ASC_LBA_OUT_OF_RANGE);
+
+	// count wraps around
+	rw10(cb, SCSI_READ10, 0xFFFFFFFF, 2);
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_FAIL);
+
+	// the sense is cleared by REQUEST SENSE
+	request_sense(hscsi, &key, &asc);
+	request_sense(hscsi, &key, &asc);
+	CHECK(key == SCSI_NO_SENSE);
+	CHECK(asc == 0);
+}
+
+
+static void test_no_medium(SCSI_HandleTypeDef *hscsi) {
+	uint8_t cb[10] = { SCSI_READ_CAPACITY10 };
+	uint8_t data[64];
+	uint32_t length;
+	uint8_t key, asc;
+
+	ramdisk_blocks = 0;
+	SCSI_mediumChanged(hscsi);
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_FAIL);
+	request_sense(hscsi, &key, &asc);
+	CHECK(key == SCSI_UNIT_ATTENTION);
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_FAIL);
+	request_sense(hscsi, &key, &asc);
+	CHECK(key == SCSI_NOT_READY);
+	CHECK(asc == SCSI_ASC_MEDIUM_NOT_PRESENT);
+	ramdisk_blocks = RAMDISK_BLOCKS;
+}
+
+
+static void test_unknown_command(SCSI_HandleTypeDef *hscsi) {
+	uint8_t cb[6] = { 0xFF, 0, 0, 0, 0, 0 };
+	uint8_t data[64];
+	uint32_t length;
+	uint8_t key, asc;
+
+	CHECK(SCSI_command(hscsi, cb, sizeof(cb), data, &length) == SCSI_FAIL);
+	request_sense(hscsi, &key, &asc);
+	CHECK(key == SCSI_ILLEGAL_REQUEST);
+	CHECK(asc == SCSI_ASC_INVALID_COMMAND);
+}
+
+
+int main(void) {
+	SCSI_HandleTypeDef hscsi;
+
+	SCSI_init(&hscsi, &ramdisk_device);
+
+	test_unit_attention(&hscsi);
+	test_inquiry(&hscsi);
+	test_read_capacity(&hscsi);
+	test_write_read(&hscsi);
+	test_illegal_lba(&hscsi);
+	test_unknown_command(&hscsi);
+	test_no_medium(&hscsi);
+
+	if (failures) {
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+	printf("SCSI test passed\n");
+	return 0;
+}
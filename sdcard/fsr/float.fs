@@ -1,5 +1,5 @@
 \ -----------------------------------------------------------------------------
-\  Floating point routines - not for interrupt usage
+\  Floating point routines with v-prefix, the core float words are f+ f- ...
 \ -----------------------------------------------------------------------------
 CR .( float.fs loading ... )
 